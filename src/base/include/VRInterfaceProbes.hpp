@@ -0,0 +1,48 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                            VRInterfaceProbes
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool.
+/**
+ * Static tracepoints (SDT/USDT) for the VRInterface plugin.
+ *
+ * On Linux, if <sys/sdt.h> is available (systemtap-sdt-dev), each probe
+ * becomes a single nop plus an ELF note. It costs nothing until perf or
+ * bpftrace attaches to it. On other platforms the probes compile away.
+ * Define VRINTERFACE_NO_SDT to switch them off explicitly.
+ *
+ * List the probes:  readelf -n libVRInterface.so | grep -A2 stapsdt
+ * Attach a probe:   bpftrace -e 'usdt:libVRInterface.so:vrinterface:writejson_return
+ *                                 { printf("%d bytes\n", arg0); }'
+ *
+ * Probes (provider "vrinterface"):
+ *    distribute_entry   (epoch, len, runstate)
+ *    datacontrol_entry  (epoch, len)
+ *    datacontrol_return (epoch, kept)
+ *    addtobuffer        (epoch, objectCount, samplesKept)
+ *    writejson_entry    (objectCount, samplesKept)
+ *    writejson_return   (bytesWritten, samplesKept)
+ */
+//------------------------------------------------------------------------------
+
+#ifndef VRInterfaceProbes_hpp
+#define VRInterfaceProbes_hpp
+
+#if !defined(VRINTERFACE_NO_SDT) && defined(__linux__) && defined(__has_include)
+   #if __has_include(<sys/sdt.h>)
+      #include <sys/sdt.h>
+      #define VRINTERFACE_HAVE_SDT
+   #endif
+#endif
+
+#ifdef VRINTERFACE_HAVE_SDT
+   #define VRINTERFACE_PROBE2(name, a1, a2) \
+      STAP_PROBE2(vrinterface, name, a1, a2)
+   #define VRINTERFACE_PROBE3(name, a1, a2, a3) \
+      STAP_PROBE3(vrinterface, name, a1, a2, a3)
+#else
+   #define VRINTERFACE_PROBE2(name, a1, a2)
+   #define VRINTERFACE_PROBE3(name, a1, a2, a3)
+#endif
+
+#endif /* VRInterfaceProbes_hpp */
@@ -0,0 +1,425 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ArrowFileWriter
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements ArrowFileWriter class
+//
+// File layout (Arrow columnar format, IPC file):
+//    8 bytes    "ARROW1", padded
+//    messages   schema, object dictionary, then one record batch per object;
+//               each is 0xFFFFFFFF, the metadata length, the flatbuffer
+//               metadata and the body
+//    8 bytes    end of stream marker
+//    footer     flatbuffer listing the dictionary and batch messages
+//    4 bytes    footer length
+//    6 bytes    "ARROW1"
+//
+// Flatbuffers are built front to back: each table is preceded by its
+// vtable, and everything a table refers to is written after it, so that
+// every offset points forward as the format requires.
+
+#include "ArrowFileWriter.hpp"
+
+#include <algorithm>		// for max()
+
+namespace
+{
+	const char MAGIC[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+	const Integer VERSION_V5 = 4;
+
+	// Type and MessageHeader union members
+	enum { TYPE_INT = 2, TYPE_FLOATING_POINT = 3, TYPE_UTF8 = 5 };
+	enum { HEADER_SCHEMA = 1, HEADER_DICTIONARY_BATCH = 2, HEADER_RECORD_BATCH = 3 };
+	const Integer PRECISION_DOUBLE = 2;
+
+	size_t Padded(const size_t length) {
+		return (length + 7) / 8 * 8;
+	}
+
+	// one scalar or offset field of a flatbuffer table
+	struct FlatField
+	{
+		FlatField(const Integer id, const size_t size, const long long value = 0) :
+			id(id), size(size), value(value) {}
+		Integer id;				// index in the vtable
+		size_t size;			// bytes; offsets take 4 and are linked later
+		long long value;
+	};
+
+	class FlatBuilder
+	{
+	public:
+		// the root offset comes first
+		FlatBuilder() : mBuffer(4, '\0') {}
+
+		void Put(const long long value, const size_t size) {
+			for (size_t k = 0; k < size; k++)
+				mBuffer.push_back((char)((value >> (8 * k)) & 0xFF));
+		}
+
+		void PutAt(const size_t position, const long long value, const size_t size) {
+			for (size_t k = 0; k < size; k++)
+				mBuffer[position + k] = (char)((value >> (8 * k)) & 0xFF);
+		}
+
+		// pads until the position plus ahead is a multiple of alignment
+		void Align(const size_t alignment, const size_t ahead = 0) {
+			while ((mBuffer.size() + ahead) % alignment != 0)
+				mBuffer.push_back('\0');
+		}
+
+		// returns the table's position; positions receives each field's
+		size_t Table(const std::vector<FlatField> &fields,
+			std::vector<size_t> &positions) {
+			Integer slots = 0;
+			std::vector<size_t> offsets(fields.size());
+			size_t end = 4;
+			for (size_t k = 0; k < fields.size(); k++) {
+				slots = std::max(slots, fields[k].id + 1);
+				end = (end + fields[k].size - 1) / fields[k].size * fields[k].size;
+				offsets[k] = end;
+				end += fields[k].size;
+			}
+
+			Align(2);
+			size_t vtable = mBuffer.size();
+			std::vector<size_t> slotOffset(slots, 0);
+			for (size_t k = 0; k < fields.size(); k++)
+				slotOffset[fields[k].id] = offsets[k];
+			Put(4 + 2 * slots, 2);
+			Put(end, 2);
+			for (Integer s = 0; s < slots; s++)
+				Put(slotOffset[s], 2);
+
+			// the table starts 8 aligned, so fields laid out from it are too
+			Align(8);
+			size_t table = mBuffer.size();
+			Put(table - vtable, 4);
+			positions.resize(fields.size());
+			for (size_t k = 0; k < fields.size(); k++) {
+				while (mBuffer.size() < table + offsets[k])
+					mBuffer.push_back('\0');
+				positions[k] = mBuffer.size();
+				Put(fields[k].value, fields[k].size);
+			}
+			return table;
+		}
+
+		size_t String(const std::string &text) {
+			Align(4);
+			size_t position = mBuffer.size();
+			Put(text.size(), 4);
+			mBuffer.append(text);
+			mBuffer.push_back('\0');
+			return position;
+		}
+
+		// element k is linked at the returned position + 4 + 4k
+		size_t OffsetVector(const size_t count) {
+			Align(4);
+			size_t position = mBuffer.size();
+			Put(count, 4);
+			mBuffer.append(4 * count, '\0');
+			return position;
+		}
+
+		// the structs follow with Put(), 8 aligned
+		size_t StructVector(const size_t count) {
+			Align(8, 4);
+			size_t position = mBuffer.size();
+			Put(count, 4);
+			return position;
+		}
+
+		void Link(const size_t from, const size_t to) {
+			PutAt(from, to - from, 4);
+		}
+
+		// @root table the buffer starts from
+		std::string Finish(const size_t root) {
+			Link(0, root);
+			Align(8);
+			return mBuffer;
+		}
+
+	protected:
+		std::string mBuffer;
+	};
+
+	// Field, with a dictionary encoded Utf8 type or a Float64 type
+	size_t AddField(FlatBuilder &builder, const std::string &name,
+		const bool dictionary) {
+		std::vector<FlatField> fields;
+		fields.push_back(FlatField(0, 4));
+		fields.push_back(FlatField(1, 1, 0));
+		fields.push_back(FlatField(2, 1, dictionary ? TYPE_UTF8 : TYPE_FLOATING_POINT));
+		fields.push_back(FlatField(3, 4));
+		fields.push_back(FlatField(5, 4));
+		if (dictionary)
+			fields.push_back(FlatField(4, 4));
+		std::vector<size_t> at, typeAt;
+		size_t field = builder.Table(fields, at);
+
+		builder.Link(at[0], builder.String(name));
+		std::vector<FlatField> type;
+		if (!dictionary)
+			type.push_back(FlatField(0, 2, PRECISION_DOUBLE));
+		builder.Link(at[3], builder.Table(type, typeAt));
+		builder.Link(at[4], builder.OffsetVector(0));
+
+		if (dictionary) {
+			// DictionaryEncoding of id 0 with Int32 indices
+			std::vector<FlatField> encoding, index;
+			std::vector<size_t> encodingAt;
+			encoding.push_back(FlatField(0, 8, 0));
+			encoding.push_back(FlatField(1, 4));
+			encoding.push_back(FlatField(2, 1, 0));
+			builder.Link(at[5], builder.Table(encoding, encodingAt));
+			index.push_back(FlatField(0, 4, 32));
+			index.push_back(FlatField(1, 1, 1));
+			builder.Link(encodingAt[1], builder.Table(index, typeAt));
+		}
+		return field;
+	}
+
+	size_t AddSchema(FlatBuilder &builder, const StringArray &columns) {
+		const unsigned short probe = 1;
+		bool littleEndian = *(const unsigned char*)&probe == 1;
+
+		std::vector<FlatField> fields;
+		std::vector<size_t> at;
+		fields.push_back(FlatField(0, 2, littleEndian ? 0 : 1));
+		fields.push_back(FlatField(1, 4));
+		size_t schema = builder.Table(fields, at);
+
+		size_t vector = builder.OffsetVector(1 + columns.size());
+		builder.Link(vector + 4, AddField(builder, "object", true));
+		for (size_t k = 0; k < columns.size(); k++)
+			builder.Link(vector + 8 + 4 * k, AddField(builder, columns[k], false));
+		builder.Link(at[1], vector);
+		return schema;
+	}
+
+	// @nodes, @buffers two values each: length and null count, offset and
+	// length
+	size_t AddRecordBatch(FlatBuilder &builder, const size_t length,
+		const std::vector<size_t> &nodes, const std::vector<size_t> &buffers) {
+		std::vector<FlatField> fields;
+		std::vector<size_t> at;
+		fields.push_back(FlatField(0, 8, length));
+		fields.push_back(FlatField(1, 4));
+		fields.push_back(FlatField(2, 4));
+		size_t batch = builder.Table(fields, at);
+
+		builder.Link(at[1], builder.StructVector(nodes.size() / 2));
+		for (size_t k = 0; k < nodes.size(); k++)
+			builder.Put(nodes[k], 8);
+		builder.Link(at[2], builder.StructVector(buffers.size() / 2));
+		for (size_t k = 0; k < buffers.size(); k++)
+			builder.Put(buffers[k], 8);
+		return batch;
+	}
+
+	// Message, returning its position; the header table follows and is
+	// linked at headerLink
+	size_t AddMessage(FlatBuilder &builder, const Integer headerType,
+		const size_t bodyLength, size_t &headerLink) {
+		std::vector<FlatField> fields;
+		std::vector<size_t> at;
+		fields.push_back(FlatField(0, 2, VERSION_V5));
+		fields.push_back(FlatField(1, 1, headerType));
+		fields.push_back(FlatField(2, 4));
+		fields.push_back(FlatField(3, 8, bodyLength));
+		size_t message = builder.Table(fields, at);
+		headerLink = at[2];
+		return message;
+	}
+}
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+ArrowFileWriter::ArrowFileWriter(std::ostream &out, const StringArray &objects,
+	const StringArray &columns) :
+	mOut(out),
+	mColumns(columns),
+	mPosition(0),
+	mRowCount(0),
+	mColumn(columns.size()),
+	mColumnValues(0),
+	mFinished(false) {
+
+	WriteBytes(MAGIC, 8);
+
+	FlatBuilder schema;
+	size_t header;
+	size_t message = AddMessage(schema, HEADER_SCHEMA, 0, header);
+	schema.Link(header, AddSchema(schema, columns));
+	WriteMessage(schema.Finish(message));
+
+	// object names as a Utf8 array: offsets, then the text
+	std::string text;
+	std::vector<int> offsets(1, 0);
+	for (size_t k = 0; k < objects.size(); k++) {
+		text += objects[k];
+		offsets.push_back((int)text.size());
+	}
+	size_t offsetsLength = offsets.size() * sizeof(int);
+	std::vector<size_t> nodes, buffers;
+	nodes.push_back(objects.size());
+	nodes.push_back(0);
+	buffers.push_back(0);
+	buffers.push_back(0);
+	buffers.push_back(0);
+	buffers.push_back(offsetsLength);
+	buffers.push_back(Padded(offsetsLength));
+	buffers.push_back(text.size());
+	size_t bodyLength = Padded(offsetsLength) + Padded(text.size());
+
+	FlatBuilder dictionary;
+	message = AddMessage(dictionary, HEADER_DICTIONARY_BATCH, bodyLength, header);
+	std::vector<FlatField> fields;
+	std::vector<size_t> at;
+	fields.push_back(FlatField(0, 8, 0));
+	fields.push_back(FlatField(1, 4));
+	fields.push_back(FlatField(2, 1, 0));
+	dictionary.Link(header, dictionary.Table(fields, at));
+	dictionary.Link(at[1], AddRecordBatch(dictionary, objects.size(), nodes, buffers));
+
+	Block block;
+	block.offset = mPosition;
+	WriteMessage(dictionary.Finish(message));
+	block.metaDataLength = mPosition - block.offset;
+	block.bodyLength = bodyLength;
+	mDictionaries.push_back(block);
+
+	WriteBytes(&offsets[0], offsetsLength);
+	WritePadding();
+	WriteBytes(text.data(), text.size());
+	WritePadding();
+}
+
+//------------------------------------------------------------
+// Record batches
+//------------------------------------------------------------
+/*
+* The body holds the object's dictionary index for every row, then each
+* column in turn. No value is ever null, so validity buffers are empty.
+*/
+void ArrowFileWriter::BeginBatch(const Integer object, const size_t rowCount) {
+	std::vector<size_t> nodes, buffers;
+	size_t bodyLength = 0;
+	for (size_t c = 0; c <= mColumns.size(); c++) {
+		size_t length = rowCount * (c == 0 ? sizeof(int) : sizeof(Real));
+		nodes.push_back(rowCount);
+		nodes.push_back(0);
+		buffers.push_back(bodyLength);
+		buffers.push_back(0);
+		buffers.push_back(bodyLength);
+		buffers.push_back(length);
+		bodyLength += Padded(length);
+	}
+
+	FlatBuilder batch;
+	size_t header;
+	size_t message = AddMessage(batch, HEADER_RECORD_BATCH, bodyLength, header);
+	batch.Link(header, AddRecordBatch(batch, rowCount, nodes, buffers));
+
+	Block block;
+	block.offset = mPosition;
+	WriteMessage(batch.Finish(message));
+	block.metaDataLength = mPosition - block.offset;
+	block.bodyLength = bodyLength;
+	mBatches.push_back(block);
+
+	const size_t CHUNK = 1024;
+	std::vector<int> index(std::min(rowCount, CHUNK), (int)object);
+	for (size_t row = 0; row < rowCount; row += CHUNK)
+		WriteBytes(&index[0], std::min(CHUNK, rowCount - row) * sizeof(int));
+	WritePadding();
+
+	mRowCount = rowCount;
+	mColumn = 0;
+	mColumnValues = 0;
+}
+
+void ArrowFileWriter::AddValues(const Real *values, const size_t count) {
+	if (mColumn >= mColumns.size())
+		return;
+	size_t taken = std::min(count, mRowCount - mColumnValues);
+	WriteBytes(values, taken * sizeof(Real));
+	mColumnValues += taken;
+	if (mColumnValues == mRowCount) {
+		mColumn++;
+		mColumnValues = 0;
+	}
+}
+
+//------------------------------------------------------------
+// Footer
+//------------------------------------------------------------
+size_t ArrowFileWriter::Finish() {
+	if (mFinished)
+		return mPosition;
+
+	const unsigned int endOfStream[2] = { 0xFFFFFFFF, 0 };
+	WriteBytes(endOfStream, sizeof(endOfStream));
+
+	FlatBuilder footer;
+	std::vector<FlatField> fields;
+	std::vector<size_t> at;
+	fields.push_back(FlatField(0, 2, VERSION_V5));
+	fields.push_back(FlatField(1, 4));
+	fields.push_back(FlatField(2, 4));
+	fields.push_back(FlatField(3, 4));
+	size_t root = footer.Table(fields, at);
+	footer.Link(at[1], AddSchema(footer, mColumns));
+
+	const std::vector<Block> *lists[2] = { &mDictionaries, &mBatches };
+	for (size_t list = 0; list < 2; list++) {
+		footer.Link(at[2 + list], footer.StructVector(lists[list]->size()));
+		for (size_t k = 0; k < lists[list]->size(); k++) {
+			const Block &block = (*lists[list])[k];
+			footer.Put(block.offset, 8);
+			footer.Put(block.metaDataLength, 4);
+			footer.Put(0, 4);
+			footer.Put(block.bodyLength, 8);
+		}
+	}
+
+	const std::string footerText = footer.Finish(root);
+	const unsigned int footerLength = (unsigned int)footerText.size();
+	WriteBytes(footerText.data(), footerText.size());
+	WriteBytes(&footerLength, sizeof(footerLength));
+	WriteBytes(MAGIC, 6);
+	mOut.flush();
+
+	mFinished = true;
+	return mPosition;
+}
+
+//------------------------------------------------------------
+// Output
+//------------------------------------------------------------
+/*
+* Metadata is framed by a continuation marker and its length, and padded
+* to 8 bytes, as is every body buffer
+*/
+void ArrowFileWriter::WriteMessage(const std::string &metadata) {
+	const unsigned int prefix[2] = { 0xFFFFFFFF, (unsigned int)metadata.size() };
+	WriteBytes(prefix, sizeof(prefix));
+	WriteBytes(metadata.data(), metadata.size());
+}
+
+void ArrowFileWriter::WriteBytes(const void *data, const size_t length) {
+	mOut.write((const char*)data, length);
+	mPosition += length;
+}
+
+void ArrowFileWriter::WritePadding() {
+	const char zeros[8] = { 0 };
+	WriteBytes(zeros, Padded(mPosition) - mPosition);
+}
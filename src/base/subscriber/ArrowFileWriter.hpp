@@ -0,0 +1,69 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ArrowFileWriter
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares ArrowFileWriter class, which writes an Apache Arrow IPC file
+// (Feather version 2) without the Arrow library. The table has a
+// dictionary encoded "object" column followed by Float64 columns, and is
+// written as one record batch per object. Values are streamed into each
+// batch's body as the caller hands them over, so no copy of the table is
+// held. Analysis tools such as pyarrow and pandas memory map the file and
+// read the columns in place.
+//
+// The flatbuffer metadata is encoded here directly; only the few tables
+// the format needs are written.
+
+#ifndef ArrowFileWriter_hpp
+#define ArrowFileWriter_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <ostream>
+#include <vector>
+
+class VRInterface_API ArrowFileWriter
+{
+public:
+	// writes the file header, the schema and the dictionary of objects
+	// @objects names, referred to by index in BeginBatch()
+	// @columns names of the Float64 columns, in the order they are added
+	ArrowFileWriter(std::ostream &out, const StringArray &objects,
+		const StringArray &columns);
+
+	// starts the record batch of one object
+	void BeginBatch(const Integer object, const size_t rowCount);
+	// values of the batch's current column; each column takes rowCount
+	// values, over as many calls as needed, before the next one starts
+	void AddValues(const Real *values, const size_t count);
+
+	// writes the footer; returns the number of bytes written
+	size_t Finish();
+
+protected:
+	struct Block
+	{
+		size_t offset;			// of the message, from the start of the file
+		size_t metaDataLength;
+		size_t bodyLength;
+	};
+
+	void WriteMessage(const std::string &metadata);
+	void WriteBytes(const void *data, const size_t length);
+	void WritePadding();
+
+	std::ostream &mOut;
+	StringArray mColumns;
+	size_t mPosition;
+
+	std::vector<Block> mDictionaries;
+	std::vector<Block> mBatches;
+
+	size_t mRowCount;				// of the open batch
+	size_t mColumn;				// being filled
+	size_t mColumnValues;		// added to it so far
+	bool mFinished;
+};
+
+#endif
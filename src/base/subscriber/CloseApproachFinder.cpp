@@ -0,0 +1,424 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  CloseApproachFinder
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements CloseApproachFinder class
+
+#include "CloseApproachFinder.hpp"
+
+#include <algorithm>
+#include <cmath>			// for sqrt(), floor()
+#include <fstream>
+#include <iomanip>		// for setprecision()
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <utility>		// for pair
+
+namespace
+{
+	// blocks per worker, so that busy stretches of the run are shared out
+	const Integer BLOCKS_PER_WORKER = 8;
+	// fewest samples, over all objects, worth a block of their own
+	const size_t SAMPLES_PER_BLOCK = 64;
+	// most samples, over all objects, a block should copy from the source
+	const size_t MAX_BLOCK_SAMPLES = 1 << 16;
+	// an object whose box covers more cells is compared with every other
+	const long long CELL_LIMIT = 512;
+	// bisection steps on the range rate; 2^-50 of a sample interval
+	const Integer BISECTION_STEPS = 50;
+
+	// orders approaches by epoch, then by pair
+	struct ApproachLess
+	{
+		bool operator()(const CloseApproachFinder::Approach &a,
+			const CloseApproachFinder::Approach &b) const {
+			if (a.epoch != b.epoch)
+				return a.epoch < b.epoch;
+			if (a.first != b.first)
+				return a.first < b.first;
+			return a.second < b.second;
+		}
+	};
+
+	long long CellKey(const long long x, const long long y, const long long z) {
+		// 21 bits per axis is ample for the cells of one block
+		return ((x & 0x1FFFFF) << 42) | ((y & 0x1FFFFF) << 21) | (z & 0x1FFFFF);
+	}
+}
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+CloseApproachFinder::CloseApproachFinder() :
+	mThreshold(0.0) {
+}
+
+//------------------------------------------------------------
+// Find every approach under the threshold
+//------------------------------------------------------------
+/*
+* There are enough blocks to share out between the workers, and at most
+* about MAX_BLOCK_SAMPLES samples in each, so that what a worker copies
+* for one block stays small however long the run
+*/
+void CloseApproachFinder::Find(SampleSource &source, const Real threshold,
+	const Integer workerCount) {
+	mThreshold = threshold;
+	mApproaches.clear();
+	mBlockEdge.clear();
+
+	Integer objectCount = source.GetObjectCount();
+	mSampled.assign(objectCount, false);
+	Real firstEpoch = 0.0, lastEpoch = 0.0;
+	size_t sampleCount = 0;
+	bool any = false;
+	for (Integer i = 0; i < objectCount; i++) {
+		Real first, last;
+		size_t count = source.GetSpan(i, first, last);
+		if (count < 2)
+			continue;
+		firstEpoch = any ? std::min(firstEpoch, first) : first;
+		lastEpoch = any ? std::max(lastEpoch, last) : last;
+		sampleCount += count;
+		mSampled[i] = true;
+		any = true;
+	}
+	if (!any || objectCount < 2 || lastEpoch <= firstEpoch)
+		return;
+
+	Integer workers = std::max(1, workerCount);
+	size_t blockCount = std::max((size_t)(workers * BLOCKS_PER_WORKER),
+		sampleCount / MAX_BLOCK_SAMPLES);
+	blockCount = std::max((size_t)1, std::min(blockCount,
+		sampleCount / SAMPLES_PER_BLOCK));
+	for (size_t k = 0; k <= blockCount; k++)
+		mBlockEdge.push_back(firstEpoch + (lastEpoch - firstEpoch) * k / blockCount);
+	workers = (Integer)std::min((size_t)workers, blockCount);
+
+	std::vector<std::vector<Approach> > found(workers);
+	std::vector<std::thread> threads;
+	for (Integer w = 1; w < workers; w++)
+		threads.push_back(std::thread(&CloseApproachFinder::FindInBlocks, this,
+			&source, w, workers, &found[w]));
+	FindInBlocks(&source, 0, workers, &found[0]);
+	for (size_t w = 0; w < threads.size(); w++)
+		threads[w].join();
+
+	for (Integer w = 0; w < workers; w++)
+		mApproaches.insert(mApproaches.end(), found[w].begin(), found[w].end());
+	std::sort(mApproaches.begin(), mApproaches.end(), ApproachLess());
+}
+
+//------------------------------------------------------------
+// Search some blocks
+//------------------------------------------------------------
+/*
+* @firstBlock, @blockStride blocks searched by this call. Each block reads
+* its stretch of every object into the same arrays, which keep their
+* memory from block to block.
+*/
+void CloseApproachFinder::FindInBlocks(SampleSource *source,
+	const Integer firstBlock, const Integer blockStride,
+	std::vector<Approach> *found) const {
+	Integer blockCount = (Integer)mBlockEdge.size() - 1;
+	std::vector<Object> objects(mSampled.size());
+	for (Integer k = firstBlock; k < blockCount; k += blockStride) {
+		for (size_t i = 0; i < objects.size(); i++) {
+			Object &object = objects[i];
+			if (mSampled[i])
+				source->Read((Integer)i, mBlockEdge[k], mBlockEdge[k + 1],
+					object.epoch, object.state, object.gapAfter);
+		}
+		FindInBlock(objects, mBlockEdge[k], mBlockEdge[k + 1],
+			k == blockCount - 1, *found);
+	}
+}
+
+//------------------------------------------------------------
+// Search one block
+//------------------------------------------------------------
+/*
+* Each object's path over the block is boxed, widened by the threshold and
+* by how far the Hermite curve may bulge past its samples. Boxes are hashed
+* onto a grid with cells about the size of an average box; pairs sharing a
+* cell whose boxes overlap are refined.
+*/
+void CloseApproachFinder::FindInBlock(const std::vector<Object> &objects,
+	const Real start, const Real stop, const bool lastBlock,
+	std::vector<Approach> &found) const {
+
+	Integer objectCount = (Integer)objects.size();
+	RealArray box(6 * objectCount);
+	BooleanArray present(objectCount, false);
+	Real extent = 0.0;
+	Integer presentCount = 0;
+
+	for (Integer i = 0; i < objectCount; i++) {
+		const Object &object = objects[i];
+		size_t count = object.epoch.size();
+		if (count < 2 || object.epoch.back() < start || object.epoch.front() > stop)
+			continue;
+
+		// samples of the intervals that reach into the block
+		size_t first = std::upper_bound(object.epoch.begin(), object.epoch.end(),
+			start) - object.epoch.begin();
+		first = first > 0 ? first - 1 : 0;
+		size_t last = std::lower_bound(object.epoch.begin(), object.epoch.end(),
+			stop) - object.epoch.begin();
+		last = std::min(last, count - 1);
+
+		Real *objectBox = &box[6 * i];
+		Real bulge = 0.0;
+		for (size_t c = 0; c < 3; c++)
+			objectBox[c] = objectBox[3 + c] = object.state[6 * first + c];
+		for (size_t j = first; j <= last; j++) {
+			const Real *state = &object.state[6 * j];
+			for (size_t c = 0; c < 3; c++) {
+				objectBox[c] = std::min(objectBox[c], state[c]);
+				objectBox[3 + c] = std::max(objectBox[3 + c], state[c]);
+			}
+			// the Hermite curve strays from its chord by at most 4/27 of h
+			// times how far each end velocity is from the chord's
+			if (j < last && object.epoch[j + 1] > object.epoch[j]) {
+				const Real *next = &object.state[6 * (j + 1)];
+				Real h = (object.epoch[j + 1] - object.epoch[j]) * 86400.0;
+				Real off0 = 0.0, off1 = 0.0;
+				for (size_t c = 0; c < 3; c++) {
+					Real chord = (next[c] - state[c]) / h;
+					off0 += (state[3 + c] - chord) * (state[3 + c] - chord);
+					off1 += (next[3 + c] - chord) * (next[3 + c] - chord);
+				}
+				bulge = std::max(bulge, h * (std::sqrt(off0) + std::sqrt(off1)) * 4.0 / 27.0);
+			}
+		}
+		for (size_t c = 0; c < 3; c++) {
+			objectBox[c] -= mThreshold + bulge;
+			objectBox[3 + c] += mThreshold + bulge;
+		}
+		extent += std::max(objectBox[3] - objectBox[0], std::max(
+			objectBox[4] - objectBox[1], objectBox[5] - objectBox[2]));
+		present[i] = true;
+		presentCount++;
+	}
+	if (presentCount < 2)
+		return;
+
+	Real cell = std::max(mThreshold, extent / presentCount);
+	if (cell <= 0.0)
+		cell = 1.0;
+
+	std::unordered_map<long long, IntegerArray> grid;
+	IntegerArray oversized;
+	for (Integer i = 0; i < objectCount; i++) {
+		if (!present[i])
+			continue;
+		const Real *objectBox = &box[6 * i];
+		long long low[3], high[3];
+		long long cells = 1;
+		for (size_t c = 0; c < 3; c++) {
+			low[c] = (long long)std::floor(objectBox[c] / cell);
+			high[c] = (long long)std::floor(objectBox[3 + c] / cell);
+			cells *= high[c] - low[c] + 1;
+		}
+		if (cells > CELL_LIMIT) {
+			oversized.push_back(i);
+			continue;
+		}
+		for (long long x = low[0]; x <= high[0]; x++)
+			for (long long y = low[1]; y <= high[1]; y++)
+				for (long long z = low[2]; z <= high[2]; z++)
+					grid[CellKey(x, y, z)].push_back(i);
+	}
+
+	std::vector<std::pair<Integer, Integer> > pairs;
+	for (std::unordered_map<long long, IntegerArray>::const_iterator it = grid.begin();
+		it != grid.end(); ++it) {
+		const IntegerArray &members = it->second;
+		for (size_t p = 0; p < members.size(); p++)
+			for (size_t q = p + 1; q < members.size(); q++)
+				pairs.push_back(std::make_pair(members[p], members[q]));
+	}
+	for (size_t p = 0; p < oversized.size(); p++) {
+		for (Integer i = 0; i < objectCount; i++) {
+			if (present[i] && i != oversized[p])
+				pairs.push_back(std::make_pair(std::min(i, oversized[p]),
+					std::max(i, oversized[p])));
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+	for (size_t p = 0; p < pairs.size(); p++) {
+		const Real *boxA = &box[6 * pairs[p].first];
+		const Real *boxB = &box[6 * pairs[p].second];
+		bool overlap = true;
+		for (size_t c = 0; c < 3 && overlap; c++)
+			overlap = boxA[c] <= boxB[3 + c] && boxB[c] <= boxA[3 + c];
+		if (overlap)
+			RefinePair(objects[pairs[p].first], objects[pairs[p].second],
+				pairs[p].first, pairs[p].second, start, stop, lastBlock, found);
+	}
+}
+
+//------------------------------------------------------------
+// Closest approaches of one pair within a block
+//------------------------------------------------------------
+/*
+* The block is cut at every sample of either object, so that each piece
+* lies on one Hermite segment of both. A piece over which the range rate
+* turns from closing to opening holds a closest approach, found by
+* bisection. Approaches are kept in the block they fall in; the last block
+* also keeps its stop epoch.
+*/
+void CloseApproachFinder::RefinePair(const Object &objectA,
+	const Object &objectB, const Integer a, const Integer b,
+	const Real start, const Real stop, const bool lastBlock,
+	std::vector<Approach> &found) const {
+
+	RealArray cuts;
+	cuts.push_back(start);
+	cuts.push_back(stop);
+	const Object *pair[2] = { &objectA, &objectB };
+	for (size_t k = 0; k < 2; k++) {
+		const RealArray &epoch = pair[k]->epoch;
+		RealArray::const_iterator from = std::upper_bound(epoch.begin(), epoch.end(), start);
+		RealArray::const_iterator to = std::lower_bound(epoch.begin(), epoch.end(), stop);
+		cuts.insert(cuts.end(), from, to);
+	}
+	std::sort(cuts.begin(), cuts.end());
+	cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+	for (size_t k = 0; k + 1 < cuts.size(); k++) {
+		Real low = cuts[k], high = cuts[k + 1];
+		Real middle = 0.5 * (low + high);
+		Integer ja = Interval(objectA, middle);
+		Integer jb = Interval(objectB, middle);
+		if (ja < 0 || jb < 0)
+			continue;
+
+		Real distance, speed;
+		if (RangeRate(objectA, ja, objectB, jb, low, &distance, &speed) >= 0.0 ||
+			RangeRate(objectA, ja, objectB, jb, high, &distance, &speed) < 0.0)
+			continue;
+
+		for (Integer step = 0; step < BISECTION_STEPS; step++) {
+			middle = 0.5 * (low + high);
+			if (RangeRate(objectA, ja, objectB, jb, middle, &distance, &speed) < 0.0)
+				low = middle;
+			else
+				high = middle;
+		}
+		middle = 0.5 * (low + high);
+		RangeRate(objectA, ja, objectB, jb, middle, &distance, &speed);
+
+		if (distance < mThreshold && middle >= start &&
+			(middle < stop || (lastBlock && middle <= stop))) {
+			Approach approach;
+			approach.epoch = middle;
+			approach.distance = distance;
+			approach.speed = speed;
+			approach.first = a;
+			approach.second = b;
+			found.push_back(approach);
+		}
+	}
+}
+
+//------------------------------------------------------------
+// Sample interval holding an epoch
+//------------------------------------------------------------
+/*
+* Returns j such that the object's segment from sample j to j + 1 covers
+* the epoch, or -1 if it is outside the samples or in a gap
+*/
+Integer CloseApproachFinder::Interval(const Object &object, const Real epoch) const {
+	const RealArray &times = object.epoch;
+	Integer j = (Integer)(std::upper_bound(times.begin(), times.end(), epoch) -
+		times.begin()) - 1;
+	if (j < 0 || j + 1 >= (Integer)times.size() || object.gapAfter[j] ||
+		times[j + 1] <= times[j])
+		return -1;
+	return j;
+}
+
+//------------------------------------------------------------
+// Hermite position and velocity on one segment
+//------------------------------------------------------------
+void CloseApproachFinder::Evaluate(const Object &object, const Integer j,
+	const Real epoch, Real *position, Real *velocity) const {
+	const Real *p0 = &object.state[6 * j];
+	const Real *p1 = &object.state[6 * (j + 1)];
+	Real h = (object.epoch[j + 1] - object.epoch[j]) * 86400.0;
+	Real s = (epoch - object.epoch[j]) * 86400.0 / h;
+	Real s2 = s * s, s3 = s2 * s;
+
+	Real h00 = 2.0 * s3 - 3.0 * s2 + 1.0, h10 = s3 - 2.0 * s2 + s;
+	Real h01 = -2.0 * s3 + 3.0 * s2, h11 = s3 - s2;
+	Real d00 = 6.0 * s2 - 6.0 * s, d10 = 3.0 * s2 - 4.0 * s + 1.0;
+	Real d01 = -6.0 * s2 + 6.0 * s, d11 = 3.0 * s2 - 2.0 * s;
+	for (size_t c = 0; c < 3; c++) {
+		position[c] = h00 * p0[c] + h10 * h * p0[3 + c] +
+			h01 * p1[c] + h11 * h * p1[3 + c];
+		velocity[c] = (d00 * p0[c] + d01 * p1[c]) / h +
+			d10 * p0[3 + c] + d11 * p1[3 + c];
+	}
+}
+
+//------------------------------------------------------------
+// Range rate of a pair
+//------------------------------------------------------------
+/*
+* Returns the dot product of relative position and velocity, negative
+* while closing. Also gives the distance and the relative speed.
+*/
+Real CloseApproachFinder::RangeRate(const Object &objectA, const Integer ja,
+	const Object &objectB, const Integer jb, const Real epoch,
+	Real *distance, Real *speed) const {
+	Real posA[3], velA[3], posB[3], velB[3];
+	Evaluate(objectA, ja, epoch, posA, velA);
+	Evaluate(objectB, jb, epoch, posB, velB);
+
+	Real rate = 0.0, range2 = 0.0, speed2 = 0.0;
+	for (size_t c = 0; c < 3; c++) {
+		Real dp = posB[c] - posA[c], dv = velB[c] - velA[c];
+		rate += dp * dv;
+		range2 += dp * dp;
+		speed2 += dv * dv;
+	}
+	*distance = std::sqrt(range2);
+	*speed = std::sqrt(speed2);
+	return rate;
+}
+
+//------------------------------------------------------------
+// Write the approaches as json
+//------------------------------------------------------------
+/*
+* @names of the objects, in the order added
+*/
+size_t CloseApproachFinder::WriteJson(const std::string &fileName,
+	const StringArray &names) const {
+	std::ostringstream jsonBuilder;
+	jsonBuilder << "{\t\"threshold\": " << std::setprecision(10) << mThreshold << ",\n";
+	jsonBuilder << "\t\"approaches\": [\n";
+	for (size_t k = 0; k < mApproaches.size(); k++) {
+		const Approach &approach = mApproaches[k];
+		jsonBuilder << "\t\t{\"time\": " << std::setprecision(15) << approach.epoch
+			<< ", \"distance\": " << std::setprecision(10) << approach.distance
+			<< ", \"speed\": " << approach.speed
+			<< ", \"objects\": [\"" << names[approach.first] << "\", \""
+			<< names[approach.second] << "\"]},\n";
+	}
+	jsonBuilder << "\t]\n";
+	jsonBuilder << "}";
+
+	const std::string jsonText = jsonBuilder.str();
+	std::ofstream jstream(fileName.c_str(), std::ofstream::out | std::ofstream::trunc);
+	jstream << jsonText;
+	jstream.close();
+	return jsonText.size();
+}
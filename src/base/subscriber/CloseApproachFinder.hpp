@@ -0,0 +1,96 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  CloseApproachFinder
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares CloseApproachFinder class, which finds the close approaches of
+// pairs of objects over a run from their buffered states. The run is cut
+// into time blocks, searched on separate threads. Each block reads only
+// its own stretch of every object from a SampleSource, so the run is never
+// copied whole. Within a block, objects
+// are hashed by the box around their path onto a grid, so only pairs that
+// share a cell are compared. The path between samples is the cubic Hermite
+// curve through the stored positions and velocities, and the closest
+// approach is where the range rate changes sign from closing to opening.
+
+#ifndef CloseApproachFinder_hpp
+#define CloseApproachFinder_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <vector>
+
+class VRInterface_API CloseApproachFinder
+{
+public:
+	struct Approach
+	{
+		Real epoch;			// A1ModJulian
+		Real distance;		// km
+		Real speed;			// relative speed, km/s
+		Integer first, second;	// objects, in the order added
+	};
+
+	// the samples of the objects; called from every worker at once
+	class VRInterface_API SampleSource
+	{
+	public:
+		virtual ~SampleSource() {}
+		virtual Integer GetObjectCount() = 0;
+		// @first, @last epochs of the object's samples
+		// Returns the number of samples
+		virtual size_t GetSpan(const Integer object, Real &first, Real &last) = 0;
+		// the samples from the last one at or before start to the first one
+		// at or after stop
+		// @epoch A1ModJulian, ascending
+		// @state position and velocity, 6 per sample
+		// @gapAfter true where the object is not defined up to the next sample
+		virtual void Read(const Integer object, const Real start, const Real stop,
+			RealArray &epoch, RealArray &state, BooleanArray &gapAfter) = 0;
+	};
+
+	CloseApproachFinder();
+
+	// @threshold approaches closer than this are kept, in km
+	// @source is only used during the call
+	void Find(SampleSource &source, const Real threshold,
+		const Integer workerCount);
+
+	// in epoch order
+	const std::vector<Approach>& GetApproaches() const { return mApproaches; }
+
+	// returns the number of bytes written
+	size_t WriteJson(const std::string &fileName, const StringArray &names) const;
+
+protected:
+	// the samples of one object that reach into a block
+	struct Object
+	{
+		RealArray epoch;
+		RealArray state;
+		BooleanArray gapAfter;
+	};
+
+	void FindInBlocks(SampleSource *source, const Integer firstBlock,
+		const Integer blockStride, std::vector<Approach> *found) const;
+	void FindInBlock(const std::vector<Object> &objects, const Real start,
+		const Real stop, const bool lastBlock, std::vector<Approach> &found) const;
+	void RefinePair(const Object &objectA, const Object &objectB,
+		const Integer a, const Integer b, const Real start, const Real stop,
+		const bool lastBlock, std::vector<Approach> &found) const;
+
+	Integer Interval(const Object &object, const Real epoch) const;
+	void Evaluate(const Object &object, const Integer j, const Real epoch,
+		Real *position, Real *velocity) const;
+	Real RangeRate(const Object &objectA, const Integer ja,
+		const Object &objectB, const Integer jb, const Real epoch,
+		Real *distance, Real *speed) const;
+
+	Real mThreshold;
+	RealArray mBlockEdge;			// block k runs from edge k to edge k + 1
+	BooleanArray mSampled;			// [object] at least two samples
+	std::vector<Approach> mApproaches;
+};
+
+#endif
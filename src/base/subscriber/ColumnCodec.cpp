@@ -0,0 +1,204 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ColumnCodec
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements ColumnCodec class
+//
+// Block layout:
+//    1 byte     predictor order p (0 to 4)
+//    p x 64 bit first p values, verbatim
+//    residuals  '0' for zero, else '1', 6 bits of (n - 1), then the low n - 1
+//               bits of the zigzagged residual, whose top bit is always set
+
+#include "ColumnCodec.hpp"
+
+#include <cstring>		// for memcpy()
+
+typedef unsigned long long Bits;
+
+// bound by reference in std::min(), so it needs a definition
+const size_t ColumnCodec::BLOCK_SIZE;
+
+
+//------------------------------------------------------------
+// Bit stream helpers
+//------------------------------------------------------------
+namespace
+{
+	class BitWriter
+	{
+	public:
+		BitWriter(std::vector<unsigned char> &out) : mOut(out), mAcc(0), mCount(0) {}
+
+		void Write(Bits value, Integer bits) {
+			while (bits > 0) {
+				Integer take = bits < 8 - mCount ? bits : 8 - mCount;
+				bits -= take;
+				mAcc = (unsigned char)((mAcc << take) | ((value >> bits) & ((1u << take) - 1)));
+				mCount += take;
+				if (mCount == 8) {
+					mOut.push_back(mAcc);
+					mAcc = 0;
+					mCount = 0;
+				}
+			}
+		}
+
+		void Flush() {
+			if (mCount > 0)
+				mOut.push_back((unsigned char)(mAcc << (8 - mCount)));
+			mAcc = 0;
+			mCount = 0;
+		}
+
+	private:
+		std::vector<unsigned char> &mOut;
+		unsigned char mAcc;
+		Integer mCount;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const unsigned char *in) : mIn(in), mPos(0) {}
+
+		Bits Read(Integer bits) {
+			Bits value = 0;
+			while (bits > 0) {
+				Integer offset = (Integer)(mPos & 7);
+				Integer take = bits < 8 - offset ? bits : 8 - offset;
+				Bits byte = mIn[mPos >> 3];
+				value = (value << take) | ((byte >> (8 - offset - take)) & ((1u << take) - 1));
+				mPos += take;
+				bits -= take;
+			}
+			return value;
+		}
+
+	private:
+		const unsigned char *mIn;
+		size_t mPos;
+	};
+
+	inline Bits ToBits(const Real value) {
+		Bits bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline Real FromBits(const Bits bits) {
+		Real value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// binomial extrapolation from the last order values, wrapping modulo 2^64
+	inline Bits Predict(const Bits *b, const size_t k, const Integer order) {
+		switch (order) {
+			case 1: return b[k - 1];
+			case 2: return 2 * b[k - 1] - b[k - 2];
+			case 3: return 3 * b[k - 1] - 3 * b[k - 2] + b[k - 3];
+			case 4: return 4 * b[k - 1] - 6 * b[k - 2] + 4 * b[k - 3] - b[k - 4];
+			default: return 0;
+		}
+	}
+
+	inline Bits ZigZag(const Bits residual) {
+		return (residual << 1) ^ (0 - (residual >> 63));
+	}
+
+	inline Bits UnZigZag(const Bits z) {
+		return (z >> 1) ^ (0 - (z & 1));
+	}
+
+	inline Integer SignificantBits(Bits z) {
+		Integer n = 0;
+		while (z != 0) {
+			z >>= 1;
+			n++;
+		}
+		return n;
+	}
+}
+
+
+//------------------------------------------------------------
+// Encode one block
+//------------------------------------------------------------
+/*
+* @values samples to encode, count at most BLOCK_SIZE
+* @encoded the block is appended here
+*/
+void ColumnCodec::EncodeBlock(const Real *values, const size_t count,
+	std::vector<unsigned char> &encoded) {
+	std::vector<Bits> bits(count);
+	for (size_t k = 0; k < count; k++)
+		bits[k] = ToBits(values[k]);
+
+	// smooth states favour high orders, noisy ones low orders
+	Integer order = 0;
+	size_t best = EncodedBits(bits, 0);
+	for (Integer p = 1; p <= MAX_ORDER && (size_t)p < count; p++) {
+		size_t size = EncodedBits(bits, p);
+		if (size < best) {
+			best = size;
+			order = p;
+		}
+	}
+
+	encoded.push_back((unsigned char)order);
+	BitWriter writer(encoded);
+	for (size_t k = 0; k < (size_t)order; k++)
+		writer.Write(bits[k], 64);
+	for (size_t k = order; k < count; k++) {
+		Bits z = ZigZag(bits[k] - Predict(&bits[0], k, order));
+		if (z == 0)
+			writer.Write(0, 1);
+		else {
+			Integer n = SignificantBits(z);
+			writer.Write(1, 1);
+			writer.Write((Bits)(n - 1), 6);
+			writer.Write(z, n - 1);
+		}
+	}
+	writer.Flush();
+}
+
+//------------------------------------------------------------
+// Decode one block
+//------------------------------------------------------------
+void ColumnCodec::DecodeBlock(const unsigned char *encoded, const size_t count,
+	Real *values) {
+	Integer order = encoded[0];
+	BitReader reader(encoded + 1);
+	std::vector<Bits> bits(count);
+
+	for (size_t k = 0; k < (size_t)order && k < count; k++)
+		bits[k] = reader.Read(64);
+	for (size_t k = order; k < count; k++) {
+		Bits z = 0;
+		if (reader.Read(1) != 0) {
+			Integer n = (Integer)reader.Read(6) + 1;
+			z = ((Bits)1 << (n - 1)) | reader.Read(n - 1);
+		}
+		bits[k] = UnZigZag(z) + Predict(&bits[0], k, order);
+	}
+
+	for (size_t k = 0; k < count; k++)
+		values[k] = FromBits(bits[k]);
+}
+
+//------------------------------------------------------------
+// Size of a block coded with one predictor order
+//------------------------------------------------------------
+size_t ColumnCodec::EncodedBits(const std::vector<Bits> &bits,
+	const Integer order) {
+	size_t size = 64 * (size_t)order;
+	for (size_t k = order; k < bits.size(); k++) {
+		Bits z = ZigZag(bits[k] - Predict(&bits[0], k, order));
+		size += (z == 0) ? 1 : 6 + SignificantBits(z);
+	}
+	return size;
+}
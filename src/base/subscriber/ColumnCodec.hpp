@@ -0,0 +1,43 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ColumnCodec
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares ColumnCodec class, the lossless block coder used by SampleColumn
+// for compressed buffers. Each value is predicted from the ones before it,
+// working on the IEEE-754 bit patterns as 64-bit integers. Order 1 is plain
+// delta coding and order 2 is delta-of-delta, as time-series databases use
+// for time stamps. Orders 3 and 4 follow smooth states more closely. The
+// residuals are zigzag coded and stored with their significant bits only.
+// All arithmetic is on integers, so decoding is bit-exact.
+
+#ifndef ColumnCodec_hpp
+#define ColumnCodec_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <vector>
+
+class VRInterface_API ColumnCodec
+{
+public:
+	// samples per sealed block; each block decodes on its own
+	static const size_t BLOCK_SIZE = 1024;
+
+	// appends one encoded block, using the predictor order that codes it
+	// smallest
+	static void EncodeBlock(const Real *values, const size_t count,
+		std::vector<unsigned char> &encoded);
+	// decodes count values starting at the given block
+	static void DecodeBlock(const unsigned char *encoded, const size_t count,
+		Real *values);
+
+protected:
+	static const Integer MAX_ORDER = 4;
+
+	static size_t EncodedBits(const std::vector<unsigned long long> &bits,
+		const Integer order);
+};
+
+#endif
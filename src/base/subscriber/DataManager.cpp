@@ -1,81 +1,187 @@
 #include "DataManager.hpp"
+#include "ArrowFileWriter.hpp"
+#include "GzipStreamBuffer.hpp"
 #include "MessageInterface.hpp"
 #include "RgbColor.hpp"
+#include "VRInterfaceProbes.hpp"
+
+#include <algorithm>
+#include <cmath>			// for floor()
+#include <iterator>		// for back_inserter()
+#include <limits>
+#include <thread>
 
 // #define DEBUG_ADDTOBUFFER
 
 
-// static data
-// bool DataManager::maxDataExceeded = false;
+// largest position offset from a float32 origin, in km. Rounding errors
+// stay below 8192 km * 2^-24 = 0.49 m.
+#define POSITION_ORIGIN_RANGE 8192.0
+
+
+namespace
+{
+	// orders sample indices by epoch
+	struct EpochLess
+	{
+		EpochLess(const RealArray &epochs) : epochs(epochs) {}
+		bool operator()(const size_t a, const size_t b) const {
+			return epochs[a] < epochs[b];
+		}
+		const RealArray &epochs;
+	};
+
+	// notes where one row of an epoch index block was written
+	// @row sample, from the object's first written
+	// @start, @end builder positions around the row
+	void MarkBlockRow(std::vector<DataManager::EpochBlock> &blocks,
+		const size_t blockSize, const size_t row, const size_t part,
+		const size_t start, const size_t end) {
+		DataManager::EpochBlock &block = blocks[row / blockSize];
+		if (row % blockSize == 0)
+			block.offset[part] = start;
+		block.length[part] = end - block.offset[part];
+	}
+
+	// gives the close approach search one stretch of a track at a time,
+	// read under the track's lock; states are as published
+	class TrackSampleSource : public CloseApproachFinder::SampleSource
+	{
+	public:
+		TrackSampleSource(const SampleTrackArray &tracks, const Integer count) :
+			tracks(tracks), count(count) {}
 
-RealArray2D DataManager::storedSpPosX;
-RealArray2D DataManager::storedSpPosY;
-RealArray2D DataManager::storedSpPosZ;
-RealArray2D DataManager::storedSpVelX;
-RealArray2D DataManager::storedSpVelY;
-RealArray2D DataManager::storedSpVelZ;
+		Integer GetObjectCount() {
+			return count;
+		}
 
+		size_t GetSpan(const Integer object, Real &first, Real &last) {
+			SampleTrack &track = *tracks[object];
+			std::lock_guard<std::mutex> lock(track.mutex);
+			size_t size = track.time.size();
+			if (size > 0) {
+				first = track.time[0];
+				last = track.time[size - 1];
+			}
+			return size;
+		}
 
-RealArray2D DataManager::storedSpQ1;
-RealArray2D DataManager::storedSpQ2;
-RealArray2D DataManager::storedSpQ3;
-RealArray2D DataManager::storedSpQ4;
+		void Read(const Integer object, const Real start, const Real stop,
+			RealArray &epoch, RealArray &state, BooleanArray &gapAfter) {
+			SampleTrack &track = *tracks[object];
+			std::lock_guard<std::mutex> lock(track.mutex);
+			const SampleColumn &spTime = track.time;
+			size_t size = spTime.size();
+			size_t first = spTime.UpperBound(start);
+			first = first > 0 ? first - 1 : 0;
+			size_t last = std::min(spTime.LowerBound(stop) + 1, size);
+			size_t n = last > first ? last - first : 0;
 
-RealArray DataManager::storedTime;
+			epoch.resize(n);
+			state.resize(6 * n);
+			gapAfter.assign(n, false);
+			for (size_t j = 0; j < n; j++) {
+				size_t k = first + j;
+				epoch[j] = spTime[k];
+				state[6 * j] = track.posX[k];
+				state[6 * j + 1] = track.posY[k];
+				state[6 * j + 2] = track.posZ[k];
+				state[6 * j + 3] = track.velX[k];
+				state[6 * j + 4] = track.velY[k];
+				state[6 * j + 5] = track.velZ[k];
+				if (k + 1 < size)
+					gapAfter[j] = track.resumed[k + 1];
+			}
+		}
 
-bool DataManager::areBuffersCleared = false;
+	protected:
+		const SampleTrackArray &tracks;
+		const Integer count;
+	};
+}
 
 
 //------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------
-DataManager::DataManager() {
-	// nothing to do here
+DataManager::DataManager() :
+	areBuffersCleared(false),
+	storedSampleCount(0),
+	lastBytesWritten(0),
+	storedIndexBlock(0),
+	storedTileDuration(0.0),
+	storedLodLevels(0),
+	storedLodTolerance(1.0),
+	storedBoundsChunk(0),
+	storedCompressionLevel(0),
+	storedArrowExport(false) {
+	// buffers are built per run by BuildDynamicBuffers
 }
 
 //------------------------------------------------------------
 // Destructor
 //------------------------------------------------------------
 DataManager::~DataManager() {
-	// clear up, nothing atm
+	// leaves shared tracks, so that another member buffers them
+	ReleaseDynamicBuffers();
 }
 
 //------------------------------------------------------------
 // Copy constructor
 //------------------------------------------------------------
-DataManager::DataManager(const DataManager &dm) {
-	storedSpPosX = dm.storedSpPosX;
-	storedSpPosY = dm.storedSpPosY;
-	storedSpPosZ = dm.storedSpPosZ;
-	storedSpVelX = dm.storedSpVelX;
-	storedSpVelY = dm.storedSpVelY;
-	storedSpVelZ = dm.storedSpVelZ;
-
-	storedSpQ1 = dm.storedSpQ1;
-	storedSpQ2 = dm.storedSpQ2;
-	storedSpQ3 = dm.storedSpQ3;
-	storedSpQ4 = dm.storedSpQ4;
-
-	storedTime = dm.storedTime;
+/*
+* The copy holds private copies of the tracks, buffered by itself
+*/
+DataManager::DataManager(const DataManager &dm) :
+	areBuffersCleared(false),
+	storedSampleCount(0),
+	lastBytesWritten(0),
+	storedIndexBlock(0),
+	storedTileDuration(0.0),
+	storedLodLevels(0),
+	storedLodTolerance(1.0),
+	storedBoundsChunk(0),
+	storedCompressionLevel(0),
+	storedArrowExport(false) {
+	operator=(dm);
 }
 
 //------------------------------------------------------------
 // Assignment Operator
 //------------------------------------------------------------
 DataManager& DataManager::operator=(const DataManager& dm) {
-	storedSpPosX = dm.storedSpPosX;
-	storedSpPosY = dm.storedSpPosY;
-	storedSpPosZ = dm.storedSpPosZ;
-	storedSpVelX = dm.storedSpVelX;
-	storedSpVelY = dm.storedSpVelY;
-	storedSpVelZ = dm.storedSpVelZ;
+	if (this == &dm)
+		return *this;
 
-	storedSpQ1 = dm.storedSpQ1;
-	storedSpQ2 = dm.storedSpQ2;
-	storedSpQ3 = dm.storedSpQ3;
-	storedSpQ4 = dm.storedSpQ4;
+	ReleaseDynamicBuffers();
+	for (size_t i = 0; i < dm.storedSpTrack.size(); i++) {
+		bool created;
+		std::shared_ptr<SampleTrack> track = SampleTrack::Acquire("", this, created);
+		const SampleTrack &source = *dm.storedSpTrack[i];
+		std::lock_guard<std::mutex> lock(dm.storedSpTrack[i]->mutex);
+		for (size_t c = 0; c < SampleTrack::CHANNEL_COUNT; c++)
+			track->Channel(c) = source.Channel(c);
+		track->anchor = source.anchor;
+		track->resumed = source.resumed;
+		track->level = source.level;
+		track->anchorLimit = source.anchorLimit;
+		track->inOrder = source.inOrder;
+		storedSpTrack.push_back(track);
+		storedTrackKeys.push_back("");
+	}
+	storedSampleCount = dm.storedSampleCount.load();
+	storedPasses = dm.storedPasses;
+	storedIndexBlock = dm.storedIndexBlock;
+	storedTileDuration = dm.storedTileDuration;
+	storedLodLevels = dm.storedLodLevels;
+	storedLodTolerance = dm.storedLodTolerance;
+	storedBoundsChunk = dm.storedBoundsChunk;
+	storedCompressionLevel = dm.storedCompressionLevel;
+	storedArrowExport = dm.storedArrowExport;
 
-	storedTime = dm.storedTime;
+	areBuffersCleared = dm.areBuffersCleared;
+	lastBytesWritten = dm.lastBytesWritten;
+	storedWriteFailures = dm.storedWriteFailures;
 
 	return *this;
 }
@@ -84,46 +190,104 @@ DataManager& DataManager::operator=(const DataManager& dm) {
 // Initialise dynamic buffer arrays 
 //------------------------------------------------------------
 /*
-* @maxData -- sets upper size of arrays
-* @numSp -- number of Objects
+* Tracks left by the last run are reused, with their capacity, if the
+* objects and storage options are unchanged. Otherwise they are released
+* and acquired again.
+* @objectNames -- Objects in buffer order, spacecraft first
+* @spillDirectory -- scratch directory for columns that outgrow memory,
+* "" to keep all samples in memory
+* @compress -- seal samples into lossless compressed blocks; these stay in
+* memory, so the spill directory is then unused
+* @singlePrecision -- store states as float32, overriding the two above.
+* Positions are offsets from origins at most POSITION_ORIGIN_RANGE away;
+* epochs stay in double precision.
+* @sampleKeys -- per object, the settings that decide which samples are
+* stored. Instances giving an object the same key share its track. Empty,
+* or "" for an object, keeps the track private.
 */
-void DataManager::BuildDynamicBuffers(const Integer numSp) {
-	// RealArray numSpCol (numSp);
-	for (int i = 0; i < (numSp); i++) {
-		storedSpPosX.push_back(RealArray());
-		storedSpPosY.push_back(RealArray());
-		storedSpPosZ.push_back(RealArray());
-		storedSpVelX.push_back(RealArray());
-		storedSpVelY.push_back(RealArray());
-		storedSpVelZ.push_back(RealArray());
+void DataManager::BuildDynamicBuffers(const StringArray &objectNames,
+	const std::string &spillDirectory, const bool compress,
+	const bool singlePrecision, const StringArray &sampleKeys) {
+	std::ostringstream storage;
+	storage << "|" << spillDirectory << "|" << compress << "|" << singlePrecision;
+
+	StringArray trackKeys;
+	for (size_t i = 0; i < objectNames.size(); i++) {
+		if (i < sampleKeys.size() && sampleKeys[i] != "")
+			trackKeys.push_back(objectNames[i] + "|" + sampleKeys[i] + storage.str());
+		else
+			trackKeys.push_back("");
+	}
+
+	// a private track is only reused for the same object and storage
+	StringArray reuseKeys = trackKeys;
+	for (size_t i = 0; i < objectNames.size(); i++) {
+		if (reuseKeys[i] == "")
+			reuseKeys[i] = "private|" + objectNames[i] + storage.str();
+	}
+
+	if (reuseKeys != storedTrackKeys || storedSpTrack.size() != objectNames.size()) {
+		ReleaseDynamicBuffers();
+		storedTrackKeys = reuseKeys;
 
-		storedSpQ1.push_back(RealArray());
-		storedSpQ2.push_back(RealArray());
-		storedSpQ3.push_back(RealArray());
-		storedSpQ4.push_back(RealArray());
+		for (size_t i = 0; i < trackKeys.size(); i++) {
+			bool created;
+			std::shared_ptr<SampleTrack> track =
+				SampleTrack::Acquire(trackKeys[i], this, created);
+			if (created) {
+				for (size_t c = 0; c < SampleTrack::CHANNEL_COUNT; c++) {
+					SampleColumn &column = track->Channel(c);
+					column.SetSpillDirectory(spillDirectory);
+					column.SetCompressed(compress);
+					if (singlePrecision && c != SampleTrack::EPOCH)
+						column.SetSinglePrecision(true,
+							(c <= SampleTrack::POS_Z) ? POSITION_ORIGIN_RANGE : 0.0);
+				}
+			}
+			storedSpTrack.push_back(track);
+		}
 	}
+
+	// empty the tracks, keeping the memory and making room for as many
+	// samples as last time
+	for (size_t i = 0; i < storedSpTrack.size(); i++)
+		storedSpTrack[i]->Reset();
+	storedSampleCount = 0;
+	areBuffersCleared = false;
 }
 
 //------------------------------------------------------------
 // Clear buffers
 //------------------------------------------------------------
 /*
-* Deallocation of memory
+* Called after export. Each track is emptied once its last member has
+* exported it, keeping its memory for the next run of the same objects.
 */
 void DataManager::ClearDynamicBuffers() {
-	storedSpPosX.clear();
-	storedSpPosY.clear();
-	storedSpPosZ.clear();
-	storedSpVelX.clear();
-	storedSpVelY.clear();
-	storedSpVelZ.clear();
-	
-	storedSpQ1.clear();
-	storedSpQ2.clear();
-	storedSpQ3.clear();
-	storedSpQ4.clear();
+	for (size_t i = 0; i < storedSpTrack.size(); i++)
+		storedSpTrack[i]->ExportDone();
+	storedSampleCount = 0;
+	storedPasses.Clear();
 
-	storedTime.clear();
+	areBuffersCleared = true;
+}
+
+//------------------------------------------------------------
+// Release buffers
+//------------------------------------------------------------
+/*
+* Leaves every track. Private tracks are deallocated, with their scratch
+* files; shared ones once their last member leaves. The next
+* BuildDynamicBuffers starts from empty.
+*/
+void DataManager::ReleaseDynamicBuffers() {
+	for (size_t i = 0; i < storedSpTrack.size(); i++)
+		SampleTrack::Leave(storedSpTrack[i], this);
+
+	storedSpTrack.clear();
+	storedTrackKeys.clear();
+	storedSampleCount = 0;
+	storedPasses.Release();
 
 	areBuffersCleared = true;
 }
@@ -134,7 +298,9 @@ void DataManager::ClearDynamicBuffers() {
 /*
 * Called instead of UpdateGlPlot. Miror logic flow in here
 * Consider renaming and implementing in other .cpp file
-
+* @spSampled objects due for a sample this step; others are left untouched
+* @spAnchor objects whose sample this step marks a discontinuity
+* @maxData point budget per object. An object reaching it is halved in place
 */
 void DataManager::AddToBuffer(
 	const Real time,
@@ -146,6 +312,7 @@ void DataManager::AddToBuffer(
 	const RealArray cbPosX, const RealArray cbPosY, const RealArray cbPosZ,
 	const RealArray cbVelX, const RealArray cbVelY, const RealArray cbVelZ,
 	const RealArray2D cbQ,
+	const BooleanArray &spSampled, const BooleanArray &spAnchor,
 	bool solving, Integer solverOption,
 	bool drawing, const Integer maxData, bool inFunction)
 {
@@ -178,38 +345,139 @@ void DataManager::AddToBuffer(
 		"\nupdateCanvas=%d, drawing=%d, inFunction=%d\n", updateCanvas, drawing, inFunction);
 	#endif
 
+	Integer sampledCount = 0;
+
 	// push back buffers with current sc state
+	// objects not due for a sample this step are skipped, as are objects
+	// another instance buffers
 	for (int i = 0; i < scCount; i++) {
-		storedSpPosX[i].push_back(scPosX[i]);
-		storedSpPosY[i].push_back(scPosY[i]);
-		storedSpPosZ[i].push_back(scPosZ[i]);
-		storedSpVelX[i].push_back(scVelX[i]);
-		storedSpVelY[i].push_back(scVelY[i]);
-		storedSpVelZ[i].push_back(scVelZ[i]);
-
-		storedSpQ1[i].push_back(scQ[Q1][i]);
-		storedSpQ2[i].push_back(scQ[Q2][i]);
-		storedSpQ3[i].push_back(scQ[Q3][i]);
-		storedSpQ4[i].push_back(scQ[Q4][i]);
+		if (!spSampled[i] || !BuffersObject(i))
+			continue;
+		sampledCount++;
+
+		// another member's export may be reading the track
+		SampleTrack &track = *storedSpTrack[i];
+		std::lock_guard<std::mutex> lock(track.mutex);
+		track.posX.push_back(scPosX[i]);
+		track.posY.push_back(scPosY[i]);
+		track.posZ.push_back(scPosZ[i]);
+		track.velX.push_back(scVelX[i]);
+		track.velY.push_back(scVelY[i]);
+		track.velZ.push_back(scVelZ[i]);
+
+		track.q1.push_back(scQ[Q1][i]);
+		track.q2.push_back(scQ[Q2][i]);
+		track.q3.push_back(scQ[Q3][i]);
+		track.q4.push_back(scQ[Q4][i]);
+
+		// rows of several providers may interleave; the track is put back
+		// in epoch order before it is decimated or written
+		if (!track.time.empty() && time < track.time.back())
+			track.inOrder = false;
+		track.time.push_back(time);
+		track.anchor.push_back(spAnchor[i]);
+		track.resumed.push_back(false);
+		if (track.IsFull(maxData)) {
+			// extremes are only found along the trajectory in epoch order
+			if (!track.inOrder)
+				OrderBuffer(i, false);
+			DecimateBuffer(i);
+		}
 	}
 		
 	// push back buffers with current cb state
 	// maintaining indexing by starting from last sc
 	for (int i = 0; i < cbCount; i++) {
-		storedSpPosX[scCount + i].push_back(cbPosX[i]);
-		storedSpPosY[scCount + i].push_back(cbPosY[i]);
-		storedSpPosZ[scCount + i].push_back(cbPosZ[i]);
-		storedSpVelX[scCount + i].push_back(cbVelX[i]);
-		storedSpVelY[scCount + i].push_back(cbVelY[i]);
-		storedSpVelZ[scCount + i].push_back(cbVelZ[i]);
+		if (!spSampled[scCount + i] || !BuffersObject(scCount + i))
+			continue;
+
+		// bodies are sampled on every provider's rows; a second row at the
+		// same epoch adds nothing
+		SampleTrack &track = *storedSpTrack[scCount + i];
+		std::lock_guard<std::mutex> lock(track.mutex);
+		if (!track.time.empty() && time == track.time.back()) {
+			if (spAnchor[scCount + i])
+				track.anchor.back() = true;
+			continue;
+		}
+		sampledCount++;
+
+		track.posX.push_back(cbPosX[i]);
+		track.posY.push_back(cbPosY[i]);
+		track.posZ.push_back(cbPosZ[i]);
+		track.velX.push_back(cbVelX[i]);
+		track.velY.push_back(cbVelY[i]);
+		track.velZ.push_back(cbVelZ[i]);
+
+		track.q1.push_back(cbQ[Q1][i]);
+		track.q2.push_back(cbQ[Q2][i]);
+		track.q3.push_back(cbQ[Q3][i]);
+		track.q4.push_back(cbQ[Q4][i]);
 
-		storedSpQ1[scCount + i].push_back(cbQ[Q1][i]);
-		storedSpQ2[scCount + i].push_back(cbQ[Q2][i]);
-		storedSpQ3[scCount + i].push_back(cbQ[Q3][i]);
-		storedSpQ4[scCount + i].push_back(cbQ[Q4][i]);
+		if (!track.time.empty() && time < track.time.back())
+			track.inOrder = false;
+		track.time.push_back(time);
+		track.anchor.push_back(spAnchor[scCount + i]);
+		track.resumed.push_back(false);
+		if (track.IsFull(maxData)) {
+			if (!track.inOrder)
+				OrderBuffer(scCount + i, true);
+			DecimateBuffer(scCount + i);
+		}
 	}
 
-	storedTime.push_back(time);
+	storedSampleCount += sampledCount;
+
+	VRINTERFACE_PROBE3(addtobuffer, time, sampledCount,
+		storedSampleCount.load());
+}
+
+//------------------------------------------------------------
+// buffer samples of one object
+//------------------------------------------------------------
+/*
+* Used by the offline converter, which reads each object of an existing
+* export on its own. Objects may be loaded on separate threads between
+* BuildDynamicBuffers and PrepareExport, each by one thread only.
+* @anchor, @resumed flags per sample; a resumed sample is also an anchor
+* @maxData point budget per object, enforced as in AddToBuffer
+*/
+void DataManager::AddObjectSamples(const Integer spIndex,
+	const RealArray &time, const RealArray &state, const RealArray &quat,
+	const BooleanArray &anchor, const BooleanArray &resumed,
+	const Integer maxData) {
+	if (!BuffersObject(spIndex))
+		return;
+
+	// counted ahead, so that a halving below never takes the count under 0
+	storedSampleCount += time.size();
+
+	SampleTrack &track = *storedSpTrack[spIndex];
+	std::lock_guard<std::mutex> lock(track.mutex);
+	for (size_t j = 0; j < time.size(); j++) {
+		track.posX.push_back(state[6 * j]);
+		track.posY.push_back(state[6 * j + 1]);
+		track.posZ.push_back(state[6 * j + 2]);
+		track.velX.push_back(state[6 * j + 3]);
+		track.velY.push_back(state[6 * j + 4]);
+		track.velZ.push_back(state[6 * j + 5]);
+
+		track.q1.push_back(quat[4 * j]);
+		track.q2.push_back(quat[4 * j + 1]);
+		track.q3.push_back(quat[4 * j + 2]);
+		track.q4.push_back(quat[4 * j + 3]);
+
+		if (!track.time.empty() && time[j] < track.time.back())
+			track.inOrder = false;
+		track.time.push_back(time[j]);
+		track.anchor.push_back(anchor[j] || resumed[j]);
+		track.resumed.push_back(resumed[j]);
+		if (track.IsFull(maxData)) {
+			if (!track.inOrder)
+				OrderBuffer(spIndex, false);
+			DecimateBuffer(spIndex);
+		}
+	}
 }
 
 //------------------------------------------------------------
@@ -217,6 +485,8 @@ void DataManager::AddToBuffer(
 //------------------------------------------------------------
 /*
 * @maxData passed onto here for final data control
+* @windowStart, @windowStop export windows (A1ModJulian); with more than one
+* window, each is written to its own file
 * Writes buffers from mission to json file
 * Triggers at end of mission run
 */
@@ -228,7 +498,28 @@ bool DataManager::WriteToJson(
 	const RealArray spRadii,
 	const ColorMap &orbitColourMap, const Integer& maxData,
 	const bool exportAttitude, const bool exportColours,
-	const BooleanArray orbitsToDraw) {
+	const BooleanArray orbitsToDraw,
+	const RealArray &windowStart, const RealArray &windowStop) {
+
+	if (!PrepareExport(scCount, cbCount, scNames, cbNames, maxData))
+		return false;
+
+	WriteBuffers(jsonFileName, jstream, scCount, cbCount, scNames, cbNames,
+		spRadii, orbitColourMap, exportAttitude, exportColours,
+		windowStart, windowStop);
+	return true;
+}
+
+//------------------------------------------------------------
+// Check buffers before export
+//------------------------------------------------------------
+/*
+* Runs on the caller's thread, as it may show messages
+* @maxData point budget per object, for the decimation report
+*/
+bool DataManager::PrepareExport(const Integer& scCount, const Integer& cbCount,
+	const StringArray &scNames, const StringArray &cbNames,
+	const Integer& maxData) {
 
 	if (scCount == 0 && cbCount == -842150451) {
 		// last resort error handling. cbCount not guaranteed to be this value
@@ -239,185 +530,1611 @@ bool DataManager::WriteToJson(
 		return false;
 	}
 
-	if (areBuffersCleared == false) {	
 	// prevents out-of-bounds exception, as func called twice at end of run
-		bool maxDataExceeded = false;
-
-		// max data check
-		// * this should check if the TOTOL size of ALL arrays
-		// * exceeds data limit, not just first spacepoint
-		if (storedSpPosX[0].size() >= maxData) {
-			maxDataExceeded = true;
-			MessageInterface::PopupMessage(Gmat::INFO_, "Max Data exceeded. \n Handling stationary objects.\n"
-																		"THIS IS NOT YET IMPLEMENTED");
-			// HandeStationary();
-				// something similar to Unity's LineUtility algo
-				// WARNING -- array checker in Unity must be updated. Or append flag to JSON
-		}
-		if (storedSpPosX[0].size() >= maxData) {
-			maxDataExceeded = true;
-			MessageInterface::PopupMessage(Gmat::INFO_, "Max Data exceeded again. \n Thinning out the data set.\n"
-																	"THIS IS NOT YET IMPLEMENTED");
-			// ThinOut();
-				// Take out every nth point 
-				// OR implement dimensionality reduction algos
-				// e.g. https://www.analyticsvidhya.com/blog/2018/08/dimensionality-reduction-techniques-python/
+	if (areBuffersCleared)
+		return false;
+
+	// tracks fed by several providers are merged into epoch order. Every
+	// member does this, as any of them may export first.
+	for (size_t i = 0; i < storedSpTrack.size(); i++) {
+		std::lock_guard<std::mutex> lock(storedSpTrack[i]->mutex);
+		if (!storedSpTrack[i]->inOrder)
+			OrderBuffer(i, i >= (size_t)scCount);
+	}
+
+	// MaxDataPoints is enforced while buffering; report any halving here
+	for (size_t i = 0; i < storedSpTrack.size(); i++) {
+		if (BuffersObject(i) && storedSpTrack[i]->level > 0) {
+			MessageInterface::ShowMessage("VRInterface: %s was decimated %d "
+				"time(s) to stay within MaxDataPoints = %d\n",
+				(i < (size_t)scCount ? scNames[i] : cbNames[i - scCount]).c_str(),
+				storedSpTrack[i]->level, maxData);
 		}
-		else {
-			maxDataExceeded = false;
+		if (BuffersObject(i) && storedSpTrack[i]->anchorLimit > 0) {
+			MessageInterface::ShowMessage("*** WARNING *** VRInterface: anchors "
+				"alone fill the point budget of %s, which keeps all %lu of them "
+				"and grows past the budget\n",
+				(i < (size_t)scCount ? scNames[i] : cbNames[i - scCount]).c_str(),
+				(unsigned long)std::count(storedSpTrack[i]->anchor.begin(),
+					storedSpTrack[i]->anchor.end(), true));
 		}
+	}
+	return true;
+}
 
-	// initialise JSON file
+//------------------------------------------------------------
+// Write and empty buffers
+//------------------------------------------------------------
+/*
+* Only call after PrepareExport returned true. Returns the number of bytes
+* written over all files.
+*/
+size_t DataManager::WriteBuffers(
+	const std::string& jsonFileName,
+	std::ofstream& jstream,
+	const Integer& scCount, const Integer& cbCount,
+	const StringArray &scNames, const StringArray &cbNames,
+	const RealArray &spRadii, const ColorMap &orbitColourMap,
+	const bool exportAttitude, const bool exportColours,
+	const RealArray &windowStart, const RealArray &windowStop,
+	SampleTransform *transform, const bool appendRun) {
+
+	VRINTERFACE_PROBE2(writejson_entry, scCount + cbCount,
+		storedSampleCount.load());
+
+	storedWriteFailures.clear();
 
-	// open file and clear contents
-	// OR flag used as out overridden by trunc
-		if (!jstream.is_open()) {
-			jstream.open(jsonFileName, std::ofstream::out | std::ofstream::trunc);
+	// one file per export window, or a single file for the whole run
+	size_t windowCount = windowStart.size() > 1 ? windowStart.size() : 1;
+	size_t bytesWritten = 0;
+
+	for (size_t w = 0; w < windowCount; w++) {
+		Real startEpoch = -std::numeric_limits<Real>::max();
+		Real stopEpoch = std::numeric_limits<Real>::max();
+		std::string fileName = jsonFileName;
+
+		if (windowStart.size() > 1) {
+			// each window takes its own slice of the buffered samples
+			startEpoch = windowStart[w];
+			stopEpoch = windowStop[w];
+			fileName = WindowFileName(jsonFileName, w + 1);
 		}
-		
-		// Close the stream 
-		if (jstream.is_open()) {
-			jstream.close();
+
+		if (storedArrowExport)
+			bytesWritten += WriteArrow(fileName, scCount, cbCount, scNames,
+				cbNames, exportAttitude, startEpoch, stopEpoch, transform);
+
+		if (appendRun) {
+			bytesWritten += AppendRunToContainer(fileName, jstream, scCount,
+				cbCount, scNames, cbNames, spRadii, orbitColourMap, exportAttitude,
+				exportColours, startEpoch, stopEpoch, transform);
+			continue;
 		}
 
-		if (!jstream.is_open()) {
-			// open in append mode. Fine as only one io event takes place
-			jstream.open(jsonFileName, std::ofstream::app);
+		if (storedTileDuration > 0.0) {
+			bytesWritten += WriteTiles(fileName, scCount, cbCount, scNames,
+				cbNames, spRadii, orbitColourMap, exportAttitude, exportColours,
+				startEpoch, stopEpoch, transform);
+			continue;
 		}
 
-		std::ostringstream jsonBuilder;
-		jsonBuilder << "{";
-		jsonBuilder << "\t" << "\"info\": {\n";
-		jsonBuilder << "\t\t" << "\"coordinates\": \"cartesian\",\n";
-		jsonBuilder << "\t\t" << "\"units\": \"km\"\n";
-		jsonBuilder << "\t" << "},\n";
+		if (storedCompressionLevel > 0) {
+			// blocks are compressed on every core while the next objects
+			// are written
+			std::ofstream fileStream((fileName + ".gz").c_str(), std::ofstream::out |
+				std::ofstream::binary | std::ofstream::trunc);
+			GzipStreamBuffer gzipBuffer(fileStream, storedCompressionLevel,
+				std::max(1, (Integer)std::thread::hardware_concurrency()));
+			std::ostream gzipStream(&gzipBuffer);
+			WriteRangeToJson(gzipStream, scCount, cbCount, scNames, cbNames,
+				spRadii, orbitColourMap, exportAttitude, exportColours,
+				startEpoch, stopEpoch, transform, 0, scCount + cbCount, true, true);
+			bytesWritten += gzipBuffer.Finish();
+			fileStream.close();
+			CheckWritten(fileStream, fileName + ".gz");
+		}
+		else {
+			// open file and clear contents
+			// OR flag used as out overridden by trunc
+			if (!jstream.is_open()) {
+				jstream.open(fileName, std::ofstream::out | std::ofstream::trunc);
+			}
 
-		jsonBuilder << "\t" << "\"orbits\": [\n";
-		for (int i = 0; i < scCount; i++) {	// spacecraft done first
+			bytesWritten += WriteRangeToJson(jstream, scCount, cbCount,
+				scNames, cbNames, spRadii, orbitColourMap, exportAttitude,
+				exportColours, startEpoch, stopEpoch, transform,
+				0, scCount + cbCount, true, true);
 
-			jsonBuilder << "\t\t" << "{\n";
-			jsonBuilder << "\t\t\t" << "\"name\": \"" << scNames[i] << "\",\n";
-			// for now, just draw all objects as line,display
-			// and default colour schemes
-			jsonBuilder << "\t\t\t" << "\"display\": \"" << "line,point" << "\",\n";
-			jsonBuilder << "\t\t\t" << "\"radius\": " << spRadii[i] << ",\n";
+			// Close the stream 
+			if (jstream.is_open()) {
+				jstream.close();
+			}
+			CheckWritten(jstream, fileName);
+		}
 
-			//// this one outputs Int colour
-			//jsonBuilder << "\t\t\t" << "\"color\": \"" << orbitColourMap.find(scNames[i])->second << "\",\n";
+		if (storedIndexBlock > 0) {
+			StringArray indexLines;
+			AddEpochIndexLines(indexLines, 0, 0, scCount + cbCount, scCount,
+				scNames, cbNames, 0);
+			WriteEpochIndex(fileName, indexLines, storedCompressionLevel > 0);
+		}
+	}
 
-			//// this one outputs [250 0 0]
-			//jsonBuilder << "\t\t\t" << "\"color\": \"" << 
-			//	RgbColor::ToRgbString(orbitColourMap.find(scNames[i])->second) << "\",\n";
+	lastBytesWritten = bytesWritten;
+	VRINTERFACE_PROBE2(writejson_return, bytesWritten,
+		storedSampleCount.load());
 
-			if (exportColours == true) {
-				// this one ouputs rrr,ggg,bbb
-				RgbColor tempColor = orbitColourMap.find(scNames[i])->second;
-				char colorBuffer[20];	// array size can be reduced to 13, as outputs rrr,ggg,bbb
-				sprintf(colorBuffer, "%d,%d,%d", tempColor.Red(), tempColor.Green(), tempColor.Blue());		// tempColor.Alpha()
+	ClearDynamicBuffers();
+	return bytesWritten;
+}
 
-				jsonBuilder << "\t\t\t" << "\"color\": \"" << colorBuffer << "\",\n";
-			}
+//------------------------------------------------------------
+// Halve one object's buffers
+//------------------------------------------------------------
+/*
+* Called when an object reaches its point budget. Drops every other
+* sample, but keeps the first and last samples, the anchors and the local
+* extremes of the distance from origin (periapsis, apoapsis), so the full
+* time span stays covered at lower resolution. The caller doubles the object's
+* collect interval from here on through GetDecimationLevel().
+* Anchors are never dropped: when they crowd the budget, only the samples
+* between them are thinned, and when they alone fill it, the track is let
+* grow past it and PrepareExport warns.
+*/
+void DataManager::DecimateBuffer(const Integer spIndex) {
+	SampleTrack &track = *storedSpTrack[spIndex];
+	const SampleColumn &x = track.posX;
+	const SampleColumn &y = track.posY;
+	const SampleColumn &z = track.posZ;
+	const BooleanArray &anchor = track.anchor;
+	size_t count = x.size();
+	if (count < 4)
+		return;
+
+	RealArray radius(count);
+	for (size_t j = 0; j < count; j++)
+		radius[j] = x[j] * x[j] + y[j] * y[j] + z[j] * z[j];
+
+	std::vector<size_t> keep;
+	keep.reserve(count / 2 + 2);
+	for (size_t j = 0; j < count; j++) {
+		bool extreme = (j > 0 && j < count - 1) &&
+			((radius[j] > radius[j - 1] && radius[j] >= radius[j + 1]) ||
+			 (radius[j] < radius[j - 1] && radius[j] <= radius[j + 1]));
+		if (j % 2 == 0 || j == count - 1 || anchor[j] || extreme)
+			keep.push_back(j);
+	}
+
+	// if protected samples alone fill the budget, stop protecting extremes
+	if (keep.size() > count * 3 / 4) {
+		keep.clear();
+		for (size_t j = 0; j < count; j++) {
+			if (j % 2 == 0 || j == count - 1 || anchor[j])
+				keep.push_back(j);
+		}
+	}
+
+	// if anchors crowd the budget even so, every other sample between them
+	// goes, and anchors alone decide the size
+	if (keep.size() > count * 3 / 4) {
+		keep.clear();
+		size_t between = 0;
+		for (size_t j = 0; j < count; j++) {
+			if (anchor[j] || j == count - 1 || between++ % 2 == 0)
+				keep.push_back(j);
+		}
+	}
+
+	// if anchors fill the budget, the next halving waits until the track has
+	// doubled, so that each sample still costs O(1) on average
+	track.anchorLimit = keep.size() > count * 3 / 4 ? 2 * keep.size() : 0;
+
+	storedSampleCount -= count - keep.size();
+	CompactBuffer(spIndex, keep);
+	if (track.level < SampleTrack::MAX_LEVEL)
+		track.level++;
+}
+
+//------------------------------------------------------------
+// Put the samples of one object in epoch order
+//------------------------------------------------------------
+/*
+* Samples of equal epoch keep their arrival order, so a spacecraft keeps
+* both states either side of an impulsive burn.
+* @dropRepeats keep only the first sample of each epoch; used for bodies,
+* whose state at an epoch is the same whichever provider sampled it
+*/
+void DataManager::OrderBuffer(const Integer spIndex, const bool dropRepeats) {
+	SampleTrack &track = *storedSpTrack[spIndex];
+	size_t count = track.time.size();
+
+	RealArray epochs(count);
+	std::vector<size_t> order(count);
+	for (size_t j = 0; j < count; j++) {
+		epochs[j] = track.time[j];
+		order[j] = j;
+	}
+	std::stable_sort(order.begin(), order.end(), EpochLess(epochs));
+
+	if (dropRepeats) {
+		std::vector<size_t> kept;
+		kept.reserve(count);
+		for (size_t k = 0; k < count; k++) {
+			if (kept.empty() || epochs[order[k]] != epochs[kept.back()])
+				kept.push_back(order[k]);
 			else {
-				jsonBuilder << "\t\t\t" << "\"color\":,\n";	// either this, or nothing at all
+				if (track.anchor[order[k]])
+					track.anchor[kept.back()] = true;
+				if (track.resumed[order[k]])
+					track.resumed[kept.back()] = true;
 			}
+		}
+		order.swap(kept);
+	}
 
-			jsonBuilder << "\t\t\t" << "\"eph\": [\n";
-			for (int j = 0; j < storedSpPosX[0].size(); j++) {
-				jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
-					<< std::setw(14) << storedSpPosX[i][j] << ","
-					<< std::setw(14) << storedSpPosY[i][j] << ","
-					<< std::setw(14) << storedSpPosZ[i][j] << ","
-					<< std::setw(14) << storedSpVelX[i][j] << ","
-					<< std::setw(14) << storedSpVelY[i][j] << ","
-					<< std::setw(14) << storedSpVelZ[i][j] << "],\n";
-			}
-			jsonBuilder << "\t\t\t" << "],\n";
-
-			if (exportAttitude == true) {
-				jsonBuilder << "\t\t\t" << "\"att\": [\n";
-				for (int j = 0; j < storedSpQ1[0].size(); j++) {
-					jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
-						<< std::setw(14) << storedSpQ1[i][j] << ","
-						<< std::setw(14) << storedSpQ2[i][j] << ","
-						<< std::setw(14) << storedSpQ3[i][j] << ","
-						<< std::setw(14) << storedSpQ4[i][j] << "],\n";
+	if (BuffersObject(spIndex))
+		storedSampleCount -= count - order.size();
+	CompactBuffer(spIndex, order);
+	track.inOrder = true;
+}
+
+//------------------------------------------------------------
+// Keep only the listed samples of one object
+//------------------------------------------------------------
+/*
+* @keep ascending sample indices to retain
+*/
+void DataManager::CompactBuffer(const Integer spIndex,
+	const std::vector<size_t> &keep) {
+	SampleTrack &track = *storedSpTrack[spIndex];
+	for (size_t c = 0; c < SampleTrack::CHANNEL_COUNT; c++)
+		track.Channel(c).Compact(keep);
+
+	BooleanArray anchor(keep.size()), resumed(keep.size());
+	for (size_t k = 0; k < keep.size(); k++) {
+		anchor[k] = track.anchor[keep[k]];
+		resumed[k] = track.resumed[keep[k]];
+	}
+	track.anchor.swap(anchor);
+	track.resumed.swap(resumed);
+}
+
+//------------------------------------------------------------
+// Solver pass capture
+//------------------------------------------------------------
+/*
+* @passLimit passes kept, 0 to capture none
+* @passInterval capture every Nth pass
+* @pointLimit samples per spacecraft and pass
+*/
+void DataManager::BuildSolverPasses(const Integer scCount,
+	const Integer passLimit, const Integer passInterval,
+	const Integer pointLimit) {
+	storedPasses.Configure(scCount, passLimit, passInterval, pointLimit);
+}
+
+/*
+* Returns false if the new pass is not captured
+*/
+bool DataManager::BeginSolverPass() {
+	return storedPasses.BeginPass();
+}
+
+/*
+* @scSampled spacecraft due for a sample in this row
+*/
+void DataManager::AddSolverRow(const Real time, const Integer scCount,
+	const BooleanArray &scSampled,
+	const RealArray &scPosX, const RealArray &scPosY, const RealArray &scPosZ,
+	const RealArray &scVelX, const RealArray &scVelY, const RealArray &scVelZ) {
+	areBuffersCleared = false;
+	for (Integer i = 0; i < scCount; i++) {
+		if (!scSampled[i])
+			continue;
+		Real state[6] = { scPosX[i], scPosY[i], scPosZ[i],
+			scVelX[i], scVelY[i], scVelZ[i] };
+		storedPasses.Add(i, time, state);
+	}
+}
+
+//------------------------------------------------------------
+// Epoch index
+//------------------------------------------------------------
+void DataManager::SetEpochIndexBlock(const Integer blockSize) {
+	storedIndexBlock = blockSize > 0 ? blockSize : 0;
+}
+
+//------------------------------------------------------------
+// Temporal tiling
+//------------------------------------------------------------
+void DataManager::SetTileDuration(const Real days) {
+	storedTileDuration = days > 0.0 ? days : 0.0;
+}
+
+//------------------------------------------------------------
+// Level of detail pyramid
+//------------------------------------------------------------
+void DataManager::SetLodPyramid(const Integer levels, const Real tolerance) {
+	storedLodLevels = levels > 0 ? levels : 0;
+	storedLodTolerance = tolerance;
+}
+
+//------------------------------------------------------------
+// Spatial index
+//------------------------------------------------------------
+void DataManager::SetBoundsChunk(const Integer chunkSize) {
+	storedBoundsChunk = chunkSize > 0 ? chunkSize : 0;
+}
+
+//------------------------------------------------------------
+// Compressed output
+//------------------------------------------------------------
+void DataManager::SetCompressionLevel(const Integer level) {
+	storedCompressionLevel = level > 0 ? std::min(level, 9) : 0;
+}
+
+//------------------------------------------------------------
+// Arrow export
+//------------------------------------------------------------
+void DataManager::SetArrowExport(const bool arrow) {
+	storedArrowExport = arrow;
+}
+
+//------------------------------------------------------------
+// Flag the last buffered sample as an anchor
+//------------------------------------------------------------
+/*
+* Used when a boundary is detected after the sample was stored,
+* e.g. at the end of a solver pass
+*/
+void DataManager::AnchorLastSample(const Integer spIndex) {
+	if (!BuffersObject(spIndex))
+		return;
+	std::lock_guard<std::mutex> lock(storedSpTrack[spIndex]->mutex);
+	BooleanArray &anchor = storedSpTrack[spIndex]->anchor;
+	if (!anchor.empty())
+		anchor.back() = true;
+}
+
+//------------------------------------------------------------
+// Flag the last buffered sample as the end of a gap
+//------------------------------------------------------------
+/*
+* Used when an object returns to the published rows after missing from
+* some. The writer reports the gap, so that nothing is drawn across it.
+*/
+void DataManager::ResumeLastSample(const Integer spIndex) {
+	if (!BuffersObject(spIndex))
+		return;
+	SampleTrack &track = *storedSpTrack[spIndex];
+	std::lock_guard<std::mutex> lock(track.mutex);
+	if (!track.resumed.empty())
+		track.resumed.back() = track.anchor.back() = true;
+}
+
+//------------------------------------------------------------
+// Whether this instance buffers an object
+//------------------------------------------------------------
+/*
+* False for objects whose shared track another instance buffers; the
+* caller need not compute their samples. Asked again on every row, as
+* buffering moves when members are toggled.
+*/
+bool DataManager::BuffersObject(const Integer spIndex) const {
+	if (spIndex < 0 || spIndex >= (Integer)storedSpTrack.size())
+		return false;
+	return storedSpTrack[spIndex]->IsBufferedBy(this);
+}
+
+//------------------------------------------------------------
+// Turn this instance on or off
+//------------------------------------------------------------
+void DataManager::SetActive(const bool active) {
+	for (size_t i = 0; i < storedSpTrack.size(); i++)
+		storedSpTrack[i]->SetActive(this, active);
+}
+
+//------------------------------------------------------------
+// Write one range of samples to a json document
+//------------------------------------------------------------
+/*
+* @jstream open stream the document is written to
+* @startEpoch, @stopEpoch epoch range written to file, inclusive
+* @firstObject, @lastObject objects written, in buffer order, last excluded
+* @writePasses whether the solver passes are written too
+* Returns the number of bytes written
+*/
+size_t DataManager::WriteRangeToJson(
+	std::ostream& jstream,
+	const Integer& scCount, const Integer& cbCount,
+	const StringArray &scNames, const StringArray &cbNames,
+	const RealArray &spRadii, const ColorMap &orbitColourMap,
+	const bool exportAttitude, const bool exportColours,
+	const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform,
+	const Integer firstObject, const Integer lastObject,
+	const bool writePasses, const bool writeIndex) {
+
+	// the document is streamed one object at a time, so that only one
+	// object's text is held in memory however long the mission
+	std::ostringstream jsonBuilder;
+	size_t bytesWritten = 0;
+	jsonBuilder << "{";
+	jsonBuilder << "\t" << "\"info\": {\n";
+	jsonBuilder << "\t\t" << "\"coordinates\": \"cartesian\",\n";
+	if (storedSpTrack.empty() || !storedSpTrack[0]->posX.IsSinglePrecision())
+		jsonBuilder << "\t\t" << "\"units\": \"km\"\n";
+	else {
+		// largest rounding error of any stored sample, in km, km/s and
+		// quaternion units
+		jsonBuilder << "\t\t" << "\"units\": \"km\",\n";
+		jsonBuilder << "\t\t" << "\"precision\": \"float32\",\n";
+		jsonBuilder << "\t\t" << "\"positionErrorBound\": " << std::setprecision(3) <<
+			MaxError(SampleTrack::POS_X, SampleTrack::POS_Z) << ",\n";
+		jsonBuilder << "\t\t" << "\"velocityErrorBound\": " <<
+			MaxError(SampleTrack::VEL_X, SampleTrack::VEL_Z) << ",\n";
+		jsonBuilder << "\t\t" << "\"attitudeErrorBound\": " <<
+			MaxError(SampleTrack::ATT_Q1, SampleTrack::ATT_Q4) << "\n";
+		jsonBuilder << std::setprecision(6);
+	}
+	jsonBuilder << "\t" << "},\n";
+
+	// spatial index of every object, built ahead of writing. Tiles, the
+	// only documents written without an epoch index, are already written
+	// in parallel.
+	std::vector<TrajectoryBounds> bounds;
+	if (storedBoundsChunk > 0 && lastObject > firstObject) {
+		bounds.resize(lastObject - firstObject);
+		Integer workerCount = 1;
+		if (writeIndex)
+			workerCount = std::max(1, std::min(lastObject - firstObject,
+				(Integer)std::thread::hardware_concurrency()));
+
+		std::vector<std::thread> workers;
+		for (Integer w = 1; w < workerCount; w++)
+			workers.push_back(std::thread(&DataManager::BuildBoundsRange, this,
+				&bounds, firstObject, w, workerCount, startEpoch, stopEpoch, transform));
+		BuildBoundsRange(&bounds, firstObject, 0, workerCount, startEpoch,
+			stopEpoch, transform);
+		for (size_t w = 0; w < workers.size(); w++)
+			workers[w].join();
+	}
+
+	jsonBuilder << "\t" << "\"orbits\": [\n";
+	for (int i = firstObject; i < lastObject; i++) {
+		// spacecraft done first, then celestial bodies
+		// maintaining indexing by starting from last sc
+		const std::string &name = i < scCount ? scNames[i] : cbNames[i - scCount];
+		std::vector<EpochBlock> *blocks = NULL;
+		if (writeIndex && storedIndexBlock > 0) {
+			storedEpochBlocks.resize(storedSpTrack.size());
+			blocks = &storedEpochBlocks[i];
+		}
+		WriteObjectToJson(jsonBuilder, i, name, spRadii[i], orbitColourMap,
+			exportAttitude, exportColours, startEpoch, stopEpoch, transform,
+			blocks, bounds.empty() ? NULL : &bounds[i - firstObject]);
+
+		// index blocks were placed in the builder, which starts here
+		if (blocks != NULL) {
+			for (size_t k = 0; k < blocks->size(); k++) {
+				for (size_t part = 0; part < EpochBlock::PART_COUNT; part++) {
+					if ((*blocks)[k].length[part] > 0)
+						(*blocks)[k].offset[part] += bytesWritten;
 				}
-				jsonBuilder << "\t\t\t" << "],\n";
 			}
+		}
 
-			jsonBuilder << "\t\t\t" << "\"time\": [";
-			for (int k = 0; k < storedTime.size(); k++) {
-				jsonBuilder << std::setprecision(10) << storedTime[k] << ",";
-			}
-			jsonBuilder << "]\n";
-			jsonBuilder << "\t\t" << "},\n";
+		const std::string objectText = jsonBuilder.str();
+		jstream << objectText;
+		bytesWritten += objectText.size();
+		jsonBuilder.str("");
+	}
+
+	if (writePasses && storedPasses.GetPassCount() > 0) {
+		jsonBuilder << "\t" << "],\n";
+		WriteSolverPassesToJson(jsonBuilder, scCount, scNames,
+			startEpoch, stopEpoch, transform);
+	}
+	else
+		jsonBuilder << "\t" << "]\n";
+	jsonBuilder << "}";
+
+	const std::string jsonText = jsonBuilder.str();
+	jstream << jsonText;
+	bytesWritten += jsonText.size();
+
+	return bytesWritten;
+}
 
+//------------------------------------------------------------
+// Append one run to a container file
+//------------------------------------------------------------
+/*
+* The container holds its members back to back, each a json document
+* followed by a newline. The first member holds the celestial bodies, which
+* every run of a mission shares; each run then adds a member with its
+* spacecraft and solver passes. The
+* index file next to the container lists every member with its byte range,
+* so a client can load any subset of runs. An existing container is
+* continued, so that runs from separate sessions collect in one place.
+* Returns the number of bytes appended.
+*/
+size_t DataManager::AppendRunToContainer(
+	const std::string& containerFileName,
+	std::ofstream& jstream,
+	const Integer& scCount, const Integer& cbCount,
+	const StringArray &scNames, const StringArray &cbNames,
+	const RealArray &spRadii, const ColorMap &orbitColourMap,
+	const bool exportAttitude, const bool exportColours,
+	const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform) {
+
+	// members listed so far, one per line of the index
+	std::string indexFileName = SuffixedFileName(containerFileName, "_index");
+	std::string epochIndexFileName = SuffixedFileName(containerFileName, "_epochs");
+	StringArray members;
+	Integer lastRun = 0;
+	bool hasBodies = false;
+	std::ifstream index(indexFileName.c_str());
+	std::string line;
+	while (std::getline(index, line)) {
+		Integer run;
+		if (sscanf(line.c_str(), "\t\t{\"run\": %d,", &run) != 1)
+			continue;
+		members.push_back(line);
+		lastRun = std::max(lastRun, run);
+		hasBodies = hasBodies || line.find("\"content\": \"bodies\"") != std::string::npos;
+	}
+	index.close();
+
+	if (jstream.is_open())
+		jstream.close();
+	jstream.open(containerFileName, std::ofstream::out | std::ofstream::app);
+	jstream.seekp(0, std::ios::end);
+	size_t offset = (size_t)jstream.tellp();
+
+	// an index without its container is stale
+	if (offset == 0) {
+		members.clear();
+		lastRun = 0;
+		hasBodies = false;
+	}
+
+	// objects of the members so far, one per line of the epoch index
+	StringArray epochLines;
+	if (storedIndexBlock > 0 && offset > 0) {
+		std::ifstream epochIndex(epochIndexFileName.c_str());
+		while (std::getline(epochIndex, line)) {
+			Integer run;
+			if (sscanf(line.c_str(), "\t\t{\"run\": %d,", &run) == 1)
+				epochLines.push_back(line);
 		}
-		for (int i = 0; i < cbCount; i++) {	// celestial bodies done second
+	}
+
+	Integer run = lastRun + 1;
+	size_t bytesWritten = 0;
+	for (Integer part = 0; part < 2; part++) {
+		bool bodies = (part == 0);
+		if (bodies && (hasBodies || cbCount == 0))
+			continue;
 
-			jsonBuilder << "\t\t" << "{\n";
-			jsonBuilder << "\t\t\t" << "\"name\": \"" << cbNames[i] << "\",\n";
-			// for now, just draw all objects as line,display
-			// and default colour schemes
-			jsonBuilder << "\t\t\t" << "\"display\": \"" << "line,point" << "\",\n";
-			jsonBuilder << "\t\t\t" << "\"radius\": " << spRadii[i + scCount] << ",\n";
+		Integer firstObject = bodies ? scCount : 0;
+		Integer lastObject = bodies ? scCount + cbCount : scCount;
+		size_t length = WriteRangeToJson(jstream, scCount, cbCount, scNames,
+			cbNames, spRadii, orbitColourMap, exportAttitude, exportColours,
+			startEpoch, stopEpoch, transform, firstObject, lastObject, !bodies,
+			true);
+		jstream << "\n";
 
-			if (exportColours == true) {
-				RgbColor tempColor = orbitColourMap.find(cbNames[i])->second;
-				char colorBuffer[20];
-				sprintf(colorBuffer, "%d,%d,%d", tempColor.Red(), tempColor.Green(), tempColor.Blue());		// tempColor.Alpha()
+		if (storedIndexBlock > 0)
+			AddEpochIndexLines(epochLines, offset, firstObject, lastObject,
+				scCount, scNames, cbNames, run);
 
-				jsonBuilder << "\t\t\t" << "\"color\": \"" << colorBuffer << "\",\n";
+		std::ostringstream member;
+		member << "\t\t{\"run\": " << run << ", \"content\": \""
+			<< (bodies ? "bodies" : "spacecraft") << "\", \"offset\": " << offset
+			<< ", \"length\": " << length << ", \"objects\": [";
+		for (Integer i = firstObject; i < lastObject; i++)
+			member << "\"" << (i < scCount ? scNames[i] : cbNames[i - scCount]) << "\",";
+		member << "]},";
+		members.push_back(member.str());
+
+		offset += length + 1;
+		bytesWritten += length + 1;
+	}
+	jstream.close();
+	CheckWritten(jstream, containerFileName);
+
+	// the index is small, and rewritten whole
+	std::string containerName = containerFileName;
+	size_t slash = containerName.find_last_of("/\\");
+	if (slash != std::string::npos)
+		containerName = containerName.substr(slash + 1);
+
+	std::ofstream indexStream(indexFileName.c_str(),
+		std::ofstream::out | std::ofstream::trunc);
+	indexStream << "{\t\"container\": \"" << containerName << "\",\n";
+	indexStream << "\t\"runs\": " << run << ",\n";
+	indexStream << "\t\"members\": [\n";
+	for (size_t k = 0; k < members.size(); k++)
+		indexStream << members[k] << "\n";
+	indexStream << "\t]\n";
+	indexStream << "}";
+	indexStream.close();
+	CheckWritten(indexStream, indexFileName);
+
+	if (storedIndexBlock > 0)
+		WriteEpochIndex(containerFileName, epochLines);
+
+	return bytesWritten;
+}
+
+//------------------------------------------------------------
+// Write one object's buffers as a json orbit entry
+//------------------------------------------------------------
+/*
+* @spIndex index into the stored buffers; spacecraft first, then bodies
+* @transform maps each sample into the view frame, NULL if stored in it
+* Each object carries its own time array, as objects are sampled at
+* their own rates. The track is locked while it is written, as instances
+* sharing it may export at the same time.
+*/
+void DataManager::WriteObjectToJson(
+	std::ostringstream& jsonBuilder, const Integer spIndex,
+	const std::string &name, const Real radius,
+	const ColorMap &orbitColourMap,
+	const bool exportAttitude, const bool exportColours,
+	const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform, std::vector<EpochBlock> *blocks,
+	const TrajectoryBounds *bounds) {
+
+	SampleTrack &track = *storedSpTrack[spIndex];
+	std::lock_guard<std::mutex> lock(track.mutex);
+
+	const SampleColumn &spTime = track.time;
+	size_t first = spTime.LowerBound(startEpoch);
+	size_t last = spTime.UpperBound(stopEpoch);
+
+	// each column is read once, front to back
+	for (size_t c = 0; c < SampleTrack::CHANNEL_COUNT; c++)
+		track.Channel(c).AdviseSequential();
+
+	// epoch index blocks, at builder positions until WriteRangeToJson
+	// places them in the document
+	const size_t blockSize = storedIndexBlock;
+	if (blocks != NULL) {
+		blocks->clear();
+		for (size_t j = first; j < last; j += blockSize) {
+			EpochBlock block = EpochBlock();
+			block.first = j - first;
+			block.count = std::min(blockSize, last - j);
+			block.start = spTime[j];
+			block.stop = spTime[j + block.count - 1];
+			blocks->push_back(block);
+		}
+	}
+
+	jsonBuilder << "\t\t" << "{\n";
+	jsonBuilder << "\t\t\t" << "\"name\": \"" << name << "\",\n";
+	// for now, just draw all objects as line,display
+	// and default colour schemes
+	jsonBuilder << "\t\t\t" << "\"display\": \"" << "line,point" << "\",\n";
+	jsonBuilder << "\t\t\t" << "\"radius\": " << radius << ",\n";
+
+	if (exportColours == true) {
+		// this one ouputs rrr,ggg,bbb
+		RgbColor tempColor = orbitColourMap.find(name)->second;
+		char colorBuffer[20];	// array size can be reduced to 13, as outputs rrr,ggg,bbb
+		sprintf(colorBuffer, "%d,%d,%d", tempColor.Red(), tempColor.Green(), tempColor.Blue());		// tempColor.Alpha()
+
+		jsonBuilder << "\t\t\t" << "\"color\": \"" << colorBuffer << "\",\n";
+	}
+	else {
+		jsonBuilder << "\t\t\t" << "\"color\":,\n";	// either this, or nothing at all
+	}
+
+	// the transform gives state and attitude together, so the attitude is
+	// kept for the att block rather than transformed twice
+	RealArray viewQuat;
+	if (transform != NULL && exportAttitude)
+		viewQuat.reserve(4 * (last - first));
+
+	// positions as written, for the level of detail pyramid
+	RealArray lodPosition;
+	if (storedLodLevels > 0)
+		lodPosition.reserve(3 * (last - first));
+
+	jsonBuilder << "\t\t\t" << "\"eph\": [\n";
+	for (size_t j = first; j < last; j++) {
+		Real state[6] = { track.posX[j], track.posY[j], track.posZ[j],
+			track.velX[j], track.velY[j], track.velZ[j] };
+		if (transform != NULL) {
+			Real quat[4] = { track.q1[j], track.q2[j], track.q3[j], track.q4[j] };
+			transform->Apply(spIndex, spTime[j], state, quat);
+			if (exportAttitude)
+				viewQuat.insert(viewQuat.end(), quat, quat + 4);
+		}
+
+		if (storedLodLevels > 0)
+			lodPosition.insert(lodPosition.end(), state, state + 3);
+
+		size_t rowStart = blocks != NULL ? (size_t)jsonBuilder.tellp() : 0;
+		jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
+			<< std::setw(14) << state[0] << ","
+			<< std::setw(14) << state[1] << ","
+			<< std::setw(14) << state[2] << ","
+			<< std::setw(14) << state[3] << ","
+			<< std::setw(14) << state[4] << ","
+			<< std::setw(14) << state[5] << "],\n";
+		if (blocks != NULL)
+			MarkBlockRow(*blocks, blockSize, j - first, EpochBlock::EPH,
+				rowStart, (size_t)jsonBuilder.tellp());
+	}
+	jsonBuilder << "\t\t\t" << "],\n";
+
+	if (exportAttitude == true) {
+		jsonBuilder << "\t\t\t" << "\"att\": [\n";
+		for (size_t j = first; j < last; j++) {
+			Real quat[4] = { track.q1[j], track.q2[j], track.q3[j], track.q4[j] };
+			if (transform != NULL)
+				std::copy(&viewQuat[4 * (j - first)], &viewQuat[4 * (j - first)] + 4, quat);
+
+			size_t rowStart = blocks != NULL ? (size_t)jsonBuilder.tellp() : 0;
+			jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
+				<< std::setw(14) << quat[0] << ","
+				<< std::setw(14) << quat[1] << ","
+				<< std::setw(14) << quat[2] << ","
+				<< std::setw(14) << quat[3] << "],\n";
+			if (blocks != NULL)
+				MarkBlockRow(*blocks, blockSize, j - first, EpochBlock::ATT,
+					rowStart, (size_t)jsonBuilder.tellp());
+		}
+		jsonBuilder << "\t\t\t" << "],\n";
+	}
+
+	// epochs that must not be smoothed over, e.g. burns and segment ends
+	const BooleanArray &spAnchor = track.anchor;
+	jsonBuilder << "\t\t\t" << "\"anchors\": [";
+	for (size_t k = first; k < last; k++) {
+		if (spAnchor[k])
+			jsonBuilder << std::setprecision(10) << spTime[k] << ",";
+	}
+	jsonBuilder << "],\n";
+
+	// spans the object was not published in, from its last sample before
+	// to its first sample after. An object that resumes from the epoch it
+	// stopped at has no gap.
+	const BooleanArray &spResumed = track.resumed;
+	jsonBuilder << "\t\t\t" << "\"gaps\": [";
+	for (size_t k = first + 1; k < last; k++) {
+		if (spResumed[k] && spTime[k] > spTime[k - 1])
+			jsonBuilder << "[" << std::setprecision(10) << spTime[k - 1] << ","
+				<< spTime[k] << "],";
+	}
+	jsonBuilder << "],\n";
+
+	// coarser levels, as indices into the samples above
+	if (storedLodLevels > 0 && last - first > 2) {
+		RealArray lodEpoch(last - first);
+		BooleanArray fixed(last - first);
+		for (size_t k = first; k < last; k++) {
+			lodEpoch[k - first] = spTime[k];
+			fixed[k - first] = spAnchor[k] || spResumed[k] ||
+				(k + 1 < last && spResumed[k + 1]);
+		}
+		std::vector<std::vector<size_t> > levels;
+		RealArray errors;
+		BuildLodLevels(lodPosition, lodEpoch, fixed, levels, errors);
+
+		jsonBuilder << "\t\t\t" << "\"lod\": [\n";
+		for (size_t L = 0; L < levels.size(); L++) {
+			jsonBuilder << "\t\t\t\t" << "{\"error\": " << std::setprecision(6)
+				<< errors[L] << ", \"index\": [";
+			for (size_t k = 0; k < levels[L].size(); k++)
+				jsonBuilder << levels[L][k] << ",";
+			jsonBuilder << "]},\n";
+		}
+		jsonBuilder << "\t\t\t" << "],\n";
+	}
+
+	if (bounds != NULL)
+		bounds->WriteJson(jsonBuilder, "\t\t\t");
+
+	jsonBuilder << "\t\t\t" << "\"time\": [";
+	for (size_t k = first; k < last; k++) {
+		size_t rowStart = blocks != NULL ? (size_t)jsonBuilder.tellp() : 0;
+		jsonBuilder << std::setprecision(10) << spTime[k] << ",";
+		if (blocks != NULL)
+			MarkBlockRow(*blocks, blockSize, k - first, EpochBlock::TIME,
+				rowStart, (size_t)jsonBuilder.tellp());
+	}
+	jsonBuilder << "]\n";
+	jsonBuilder << "\t\t" << "},\n";
+}
+
+//------------------------------------------------------------
+// Spatial index of some objects
+//------------------------------------------------------------
+/*
+* Builds from the positions as they will be written
+* @bounds one per object, from @firstObject
+* @firstItem, @itemStride entries of @bounds built by this call
+*/
+void DataManager::BuildBoundsRange(std::vector<TrajectoryBounds> *bounds,
+	const Integer firstObject, const Integer firstItem,
+	const Integer itemStride, const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform) {
+
+	for (Integer k = firstItem; k < (Integer)bounds->size(); k += itemStride) {
+		Integer spIndex = firstObject + k;
+		SampleTrack &track = *storedSpTrack[spIndex];
+		std::lock_guard<std::mutex> lock(track.mutex);
+
+		const SampleColumn &spTime = track.time;
+		size_t first = spTime.LowerBound(startEpoch);
+		size_t last = spTime.UpperBound(stopEpoch);
+
+		RealArray position;
+		position.reserve(3 * (last - first));
+		for (size_t j = first; j < last; j++) {
+			Real state[6] = { track.posX[j], track.posY[j], track.posZ[j],
+				track.velX[j], track.velY[j], track.velZ[j] };
+			if (transform != NULL) {
+				Real quat[4] = { track.q1[j], track.q2[j], track.q3[j], track.q4[j] };
+				transform->Apply(spIndex, spTime[j], state, quat);
 			}
-			else {
-				jsonBuilder << "\t\t\t" << "\"color\":,\n";
+			position.insert(position.end(), state, state + 3);
+		}
+		(*bounds)[k].Build(position, storedBoundsChunk);
+	}
+}
+
+//------------------------------------------------------------
+// Level of detail pyramid of one object
+//------------------------------------------------------------
+/*
+* Each level is decimated from the one below under twice its tolerance:
+* a sample is dropped while the line between the samples kept either side
+* of it, interpolated in time, stays within the tolerance of every written
+* sample in between. The error is measured against the written samples,
+* not the level below, so each level's tolerance bounds its error. First
+* and last samples, anchors and gap ends are always kept. A tolerance that
+* drops no sample gives no level, and the next is tried.
+* @position, @epoch samples as written
+* @fixed samples every level keeps
+* @levels indices into the written samples, finest level first
+* @errors tolerance of each level, in km
+*/
+void DataManager::BuildLodLevels(const RealArray &position,
+	const RealArray &epoch, const BooleanArray &fixed,
+	std::vector<std::vector<size_t> > &levels, RealArray &errors) const {
+
+	// samples of the level below that one segment may span, which bounds
+	// the cost of testing a segment
+	const size_t LOD_WINDOW = 32;
+	// doublings tried, in all; 2^40 times any sensible tolerance is past
+	// the size of the solar system
+	const Integer LOD_DOUBLINGS = 40;
+
+	size_t count = epoch.size();
+	std::vector<size_t> below(count);
+	for (size_t j = 0; j < count; j++)
+		below[j] = j;
+
+	Real tolerance = storedLodTolerance;
+	for (Integer d = 0; d < LOD_DOUBLINGS && (Integer)levels.size() < storedLodLevels &&
+		below.size() > 2; d++, tolerance *= 2.0) {
+		std::vector<size_t> level;
+		level.reserve(below.size() / 2 + 2);
+		level.push_back(below[0]);
+
+		size_t a = 0;
+		while (a + 1 < below.size()) {
+			size_t b = a + 1;
+			while (b + 1 < below.size() && b - a < LOD_WINDOW && !fixed[below[b]]) {
+				// does the segment from below[a] to below[b + 1] fit?
+				size_t from = below[a], to = below[b + 1];
+				Real span = epoch[to] - epoch[from];
+				bool fits = span > 0.0;
+				for (size_t j = from + 1; j < to && fits; j++) {
+					Real f = (epoch[j] - epoch[from]) / span;
+					Real error = 0.0;
+					for (size_t c = 0; c < 3; c++) {
+						Real delta = position[3 * from + c] +
+							f * (position[3 * to + c] - position[3 * from + c]) -
+							position[3 * j + c];
+						error += delta * delta;
+					}
+					fits = error <= tolerance * tolerance;
+				}
+				if (!fits)
+					break;
+				b++;
 			}
+			level.push_back(below[b]);
+			a = b;
+		}
 
-			jsonBuilder << "\t\t\t" << "\"eph\": [\n";
-			for (int j = 0; j < storedSpPosX[0].size(); j++) {
-				jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
-					<< std::setw(12) << storedSpPosX[i + scCount][j] << ","
-					<< std::setw(12) << storedSpPosY[i + scCount][j] << ","
-					<< std::setw(12) << storedSpPosZ[i + scCount][j] << ","
-					<< std::setw(12) << storedSpVelX[i + scCount][j] << ","
-					<< std::setw(12) << storedSpVelY[i + scCount][j] << ","
-					<< std::setw(12) << storedSpVelZ[i + scCount][j] << "],\n";
+		if (level.size() == below.size())
+			continue;
+		levels.push_back(level);
+		errors.push_back(tolerance);
+		below.swap(level);
+	}
+}
+
+//------------------------------------------------------------
+// Write the captured solver passes
+//------------------------------------------------------------
+/*
+* Each pass is a set of spacecraft trajectories of its own, tagged with its
+* number in the run. Passes or spacecraft without samples in the epoch
+* range are left out.
+*/
+void DataManager::WriteSolverPassesToJson(
+	std::ostringstream& jsonBuilder,
+	const Integer scCount, const StringArray &scNames,
+	const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform) {
+
+	jsonBuilder << "\t" << "\"solverPasses\": [\n";
+	for (size_t k = 0; k < storedPasses.GetPassCount(); k++) {
+		const SolverPassStore::Pass &pass = storedPasses.GetPass(k);
+		std::ostringstream passBuilder;
+
+		for (Integer i = 0; i < scCount; i++) {
+			const RealArray &spTime =
+				storedPasses.Channel(pass, i, SolverPassStore::EPOCH);
+			size_t first = std::lower_bound(spTime.begin(), spTime.end(),
+				startEpoch) - spTime.begin();
+			size_t last = std::upper_bound(spTime.begin(), spTime.end(),
+				stopEpoch) - spTime.begin();
+			if (first >= last)
+				continue;
+
+			passBuilder << "\t\t\t\t" << "{\n";
+			passBuilder << "\t\t\t\t\t" << "\"name\": \"" << scNames[i] << "\",\n";
+			passBuilder << "\t\t\t\t\t" << "\"eph\": [\n";
+			for (size_t j = first; j < last; j++) {
+				Real state[6];
+				for (size_t c = 0; c < 6; c++)
+					state[c] = storedPasses.Channel(pass, i, c)[j];
+				if (transform != NULL) {
+					Real quat[4] = { 0.0, 0.0, 0.0, 1.0 };
+					transform->Apply(i, spTime[j], state, quat);
+				}
+
+				passBuilder << "\t\t\t\t\t\t" << "[" << std::setprecision(10)
+					<< std::setw(14) << state[0] << ","
+					<< std::setw(14) << state[1] << ","
+					<< std::setw(14) << state[2] << ","
+					<< std::setw(14) << state[3] << ","
+					<< std::setw(14) << state[4] << ","
+					<< std::setw(14) << state[5] << "],\n";
 			}
-			jsonBuilder << "\t\t\t" << "],\n";
-
-			if (exportAttitude == true) {
-				jsonBuilder << "\t\t\t" << "\"att\": [\n";
-				for (int j = 0; j < storedSpQ1[0].size(); j++) {
-					jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
-						<< std::setw(14) << storedSpQ1[i + scCount][j] << ","
-						<< std::setw(14) << storedSpQ2[i + scCount][j] << ","
-						<< std::setw(14) << storedSpQ3[i + scCount][j] << ","
-						<< std::setw(14) << storedSpQ4[i + scCount][j] << "],\n";
+			passBuilder << "\t\t\t\t\t" << "],\n";
+
+			passBuilder << "\t\t\t\t\t" << "\"time\": [";
+			for (size_t j = first; j < last; j++)
+				passBuilder << std::setprecision(10) << spTime[j] << ",";
+			passBuilder << "]\n";
+			passBuilder << "\t\t\t\t" << "},\n";
+		}
+
+		if (passBuilder.str().empty())
+			continue;
+
+		jsonBuilder << "\t\t" << "{\n";
+		jsonBuilder << "\t\t\t" << "\"pass\": " << pass.number << ",\n";
+		jsonBuilder << "\t\t\t" << "\"orbits\": [\n";
+		jsonBuilder << passBuilder.str();
+		jsonBuilder << "\t\t\t" << "]\n";
+		jsonBuilder << "\t\t" << "},\n";
+	}
+	jsonBuilder << "\t" << "]\n";
+}
+
+//------------------------------------------------------------
+// Write one export window as tiles
+//------------------------------------------------------------
+/*
+* Splits the window's samples into tiles of storedTileDuration days, each
+* a complete json document <name>_tile<k>.json, and lists them in the
+* manifest <name>_tiles.json. A sample on a tile boundary is written to
+* both tiles, so that lines join. Tiles are written on separate threads,
+* which share the transform. Returns the bytes written.
+*/
+size_t DataManager::WriteTiles(
+	const std::string& fileName,
+	const Integer& scCount, const Integer& cbCount,
+	const StringArray &scNames, const StringArray &cbNames,
+	const RealArray &spRadii, const ColorMap &orbitColourMap,
+	const bool exportAttitude, const bool exportColours,
+	const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform) {
+
+	// span of the samples in the window
+	Real firstEpoch = std::numeric_limits<Real>::max();
+	Real lastEpoch = -std::numeric_limits<Real>::max();
+	for (size_t i = 0; i < storedSpTrack.size(); i++) {
+		std::lock_guard<std::mutex> lock(storedSpTrack[i]->mutex);
+		const SampleColumn &spTime = storedSpTrack[i]->time;
+		size_t first = spTime.LowerBound(startEpoch);
+		size_t last = spTime.UpperBound(stopEpoch);
+		if (first < last) {
+			firstEpoch = std::min(firstEpoch, (Real)spTime[first]);
+			lastEpoch = std::max(lastEpoch, (Real)spTime[last - 1]);
+		}
+	}
+
+	TileJob job;
+	job.scCount = scCount;
+	job.cbCount = cbCount;
+	job.scNames = &scNames;
+	job.cbNames = &cbNames;
+	job.spRadii = &spRadii;
+	job.orbitColourMap = &orbitColourMap;
+	job.exportAttitude = exportAttitude;
+	job.exportColours = exportColours;
+	job.transform = transform;
+
+	Integer tileCount = 0;
+	if (firstEpoch <= lastEpoch)
+		tileCount = (Integer)std::floor((lastEpoch - firstEpoch) / storedTileDuration) + 1;
+	for (Integer k = 0; k < tileCount; k++) {
+		std::ostringstream suffix;
+		suffix << "_tile" << k + 1;
+		job.fileNames.push_back(SuffixedFileName(fileName, suffix.str()) +
+			(storedCompressionLevel > 0 ? ".gz" : ""));
+		// the last tile ends with the window, not on the grid
+		job.start.push_back(std::max(firstEpoch + k * storedTileDuration, startEpoch));
+		job.stop.push_back(std::min(firstEpoch + (k + 1) * storedTileDuration, stopEpoch));
+	}
+	job.bytes.assign(tileCount, 0);
+	job.failed.assign(tileCount, 0);
+
+	Integer workerCount = std::max(1, std::min(tileCount,
+		(Integer)std::thread::hardware_concurrency()));
+
+	std::vector<std::thread> workers;
+	for (Integer w = 1; w < workerCount; w++)
+		workers.push_back(std::thread(&DataManager::WriteTileRange, this,
+			&job, w, workerCount));
+	WriteTileRange(&job, 0, workerCount);
+	for (size_t w = 0; w < workers.size(); w++)
+		workers[w].join();
+
+	// the manifest names tiles relative to itself
+	std::ostringstream manifest;
+	size_t bytesWritten = 0;
+	manifest << "{\t\"tileDuration\": " << std::setprecision(10) << storedTileDuration << ",\n";
+	manifest << "\t\"tiles\": [\n";
+	for (Integer k = 0; k < tileCount; k++) {
+		if (job.failed[k])
+			storedWriteFailures.push_back(job.fileNames[k]);
+		if (job.bytes[k] == 0 || job.failed[k])
+			continue;
+		std::string tileName = job.fileNames[k];
+		size_t slash = tileName.find_last_of("/\\");
+		if (slash != std::string::npos)
+			tileName = tileName.substr(slash + 1);
+
+		manifest << "\t\t{\"file\": \"" << tileName << "\", \"start\": "
+			<< job.start[k] << ", \"stop\": " << job.stop[k]
+			<< ", \"bytes\": " << job.bytes[k] << "},\n";
+		bytesWritten += job.bytes[k];
+	}
+	manifest << "\t]\n";
+	manifest << "}";
+
+	const std::string manifestText = manifest.str();
+	std::ofstream manifestStream(SuffixedFileName(fileName, "_tiles").c_str(),
+		std::ofstream::out | std::ofstream::trunc);
+	manifestStream << manifestText;
+	manifestStream.close();
+	CheckWritten(manifestStream, SuffixedFileName(fileName, "_tiles"));
+
+	return bytesWritten + manifestText.size();
+}
+
+//------------------------------------------------------------
+// Write some tiles
+//------------------------------------------------------------
+/*
+* @firstTile, @tileStride tiles written by this call. A tile without
+* samples is not written.
+*/
+void DataManager::WriteTileRange(TileJob *job, const Integer firstTile,
+	const Integer tileStride) {
+
+	for (Integer k = firstTile; k < (Integer)job->fileNames.size(); k += tileStride) {
+		bool hasSamples = false;
+		for (size_t i = 0; i < storedSpTrack.size() && !hasSamples; i++) {
+			std::lock_guard<std::mutex> lock(storedSpTrack[i]->mutex);
+			const SampleColumn &spTime = storedSpTrack[i]->time;
+			hasSamples = spTime.LowerBound(job->start[k]) < spTime.UpperBound(job->stop[k]);
+		}
+		if (!hasSamples)
+			continue;
+
+		std::ios::openmode mode = std::ofstream::out | std::ofstream::trunc;
+		if (storedCompressionLevel > 0)
+			mode |= std::ofstream::binary;
+		std::ofstream tileStream(job->fileNames[k].c_str(), mode);
+		if (storedCompressionLevel > 0) {
+			// tiles are already written in parallel, so each compresses on
+			// its own thread
+			GzipStreamBuffer gzipBuffer(tileStream, storedCompressionLevel, 1);
+			std::ostream gzipStream(&gzipBuffer);
+			WriteRangeToJson(gzipStream, job->scCount, job->cbCount,
+				*job->scNames, *job->cbNames, *job->spRadii, *job->orbitColourMap,
+				job->exportAttitude, job->exportColours, job->start[k], job->stop[k],
+				job->transform, 0, job->scCount + job->cbCount, true, false);
+			job->bytes[k] = gzipBuffer.Finish();
+		}
+		else
+			job->bytes[k] = WriteRangeToJson(tileStream, job->scCount, job->cbCount,
+				*job->scNames, *job->cbNames, *job->spRadii, *job->orbitColourMap,
+				job->exportAttitude, job->exportColours, job->start[k], job->stop[k],
+				job->transform, 0, job->scCount + job->cbCount, true, false);
+		tileStream.close();
+		job->failed[k] = tileStream.fail() ? 1 : 0;
+	}
+}
+
+//------------------------------------------------------------
+// Epoch index lines of some objects
+//------------------------------------------------------------
+/*
+* One line per object, from the blocks of the document just written
+* @documentOffset where the document starts in its file
+* @run member run number in a container, 0 for a plain file
+*/
+void DataManager::AddEpochIndexLines(StringArray &lines,
+	const size_t documentOffset,
+	const Integer firstObject, const Integer lastObject,
+	const Integer scCount, const StringArray &scNames,
+	const StringArray &cbNames, const Integer run) const {
+
+	for (Integer i = firstObject; i < lastObject; i++) {
+		std::ostringstream line;
+		line << "\t\t{";
+		if (run > 0)
+			line << "\"run\": " << run << ", ";
+		line << "\"name\": \"" << (i < scCount ? scNames[i] : cbNames[i - scCount])
+			<< "\", \"blocks\": [";
+
+		if (i < (Integer)storedEpochBlocks.size()) {
+			const std::vector<EpochBlock> &blocks = storedEpochBlocks[i];
+			for (size_t k = 0; k < blocks.size(); k++) {
+				const EpochBlock &block = blocks[k];
+				line << "[" << std::setprecision(10) << block.start << ","
+					<< block.stop << "," << block.first << "," << block.count;
+				for (size_t part = 0; part < EpochBlock::PART_COUNT; part++) {
+					size_t offset = block.length[part] > 0 ?
+						documentOffset + block.offset[part] : 0;
+					line << "," << offset << "," << block.length[part];
 				}
-				jsonBuilder << "\t\t\t" << "],\n";
+				line << "],";
+			}
+		}
+		line << "]},";
+		lines.push_back(line.str());
+	}
+}
+
+//------------------------------------------------------------
+// Write the epoch index of a file
+//------------------------------------------------------------
+/*
+* <name>_epochs.json lists, per object, blocks of a fixed number of
+* samples with their epoch span and the byte range of their eph, att and
+* time entries, so a client can seek to an epoch and parse only the blocks
+* it needs. A part that was not written has offset and length 0.
+* @compressed the file was written as <fileName>.gz; offsets are then
+* within its decompressed text, and the index says so
+*/
+void DataManager::WriteEpochIndex(const std::string &fileName,
+	const StringArray &lines, const bool compressed) {
+
+	std::string dataName = compressed ? fileName + ".gz" : fileName;
+	size_t slash = dataName.find_last_of("/\\");
+	if (slash != std::string::npos)
+		dataName = dataName.substr(slash + 1);
+
+	std::ofstream indexStream(SuffixedFileName(fileName, "_epochs").c_str(),
+		std::ofstream::out | std::ofstream::trunc);
+	indexStream << "{\t\"file\": \"" << dataName << "\",\n";
+	if (compressed)
+		indexStream << "\t\"offsets\": \"decompressed\",\n";
+	indexStream << "\t\"blockSize\": " << storedIndexBlock << ",\n";
+	indexStream << "\t\"fields\": [\"start\", \"stop\", \"first\", \"count\", "
+		"\"eph\", \"ephLength\", \"att\", \"attLength\", \"time\", \"timeLength\"],\n";
+	indexStream << "\t\"objects\": [\n";
+	for (size_t k = 0; k < lines.size(); k++)
+		indexStream << lines[k] << "\n";
+	indexStream << "\t]\n";
+	indexStream << "}";
+	indexStream.close();
+	CheckWritten(indexStream, SuffixedFileName(fileName, "_epochs"));
+}
+
+//------------------------------------------------------------
+// Note a file that could not be written
+//------------------------------------------------------------
+/*
+* @stream closed stream of the file; its state tells whether opening,
+* writing or closing it failed
+*/
+void DataManager::CheckWritten(const std::ofstream &stream,
+	const std::string &fileName) {
+	if (stream.fail())
+		storedWriteFailures.push_back(fileName);
+}
+
+//------------------------------------------------------------
+// Fold the run into the dispersion envelope
+//------------------------------------------------------------
+/*
+* The envelope of the runs so far is read from <name>_envelope.bin, this
+* run is folded in, and both the state and <name>_envelope.json are
+* rewritten. Spacecraft are folded on separate threads, which share the
+* transform.
+*/
+size_t DataManager::WriteEnvelope(const std::string &jsonFileName,
+	const Integer scCount, const StringArray &scNames, const Real step,
+	SampleTransform *transform) {
+
+	if (areBuffersCleared || step <= 0.0 || scCount <= 0)
+		return 0;
+
+	const std::string envelopeFileName = SuffixedFileName(jsonFileName, "_envelope");
+	const std::string stateFileName = ExtensionFileName(envelopeFileName, ".bin");
+
+	// a missing state, or one of another step, starts a new ensemble
+	EnsembleEnvelope envelope(step);
+	envelope.Load(stateFileName);
+
+	std::vector<EnsembleEnvelope::Track*> tracks(scCount);
+	for (Integer i = 0; i < scCount; i++)
+		tracks[i] = &envelope.GetTrack(scNames[i]);
+
+	Integer workerCount = std::max(1, std::min(scCount,
+		(Integer)std::thread::hardware_concurrency()));
+
+	std::vector<std::thread> workers;
+	for (Integer w = 1; w < workerCount; w++)
+		workers.push_back(std::thread(&DataManager::FoldIntoEnvelope, this,
+			&envelope, &tracks, w, workerCount, transform));
+	FoldIntoEnvelope(&envelope, &tracks, 0, workerCount, transform);
+	for (size_t w = 0; w < workers.size(); w++)
+		workers[w].join();
+
+	envelope.EndRun();
+	envelope.Save(stateFileName);
+	return envelope.WriteJson(envelopeFileName);
+}
+
+//------------------------------------------------------------
+// Fold some spacecraft into the envelope
+//------------------------------------------------------------
+/*
+* Each spacecraft is interpolated linearly at every envelope epoch within
+* its samples, except across a gap.
+* @firstObject, @objectStride spacecraft folded by this call
+*/
+void DataManager::FoldIntoEnvelope(EnsembleEnvelope *envelope,
+	std::vector<EnsembleEnvelope::Track*> *tracks,
+	const Integer firstObject, const Integer objectStride,
+	SampleTransform *transform) {
+
+	for (Integer i = firstObject; i < (Integer)tracks->size(); i += objectStride) {
+		SampleTrack &track = *storedSpTrack[i];
+		std::lock_guard<std::mutex> lock(track.mutex);
+
+		const SampleColumn &spTime = track.time;
+		size_t count = spTime.size();
+		if (count == 0)
+			continue;
+
+		RealArray position(3 * count);
+		for (size_t j = 0; j < count; j++) {
+			Real state[6] = { track.posX[j], track.posY[j], track.posZ[j],
+				track.velX[j], track.velY[j], track.velZ[j] };
+			if (transform != NULL) {
+				Real quat[4] = { track.q1[j], track.q2[j], track.q3[j], track.q4[j] };
+				transform->Apply(i, spTime[j], state, quat);
 			}
+			std::copy(state, state + 3, &position[3 * j]);
+		}
 
-			jsonBuilder << "\t\t\t" << "\"time\": [";
-			for (int k = 0; k < storedTime.size(); k++) {
-				jsonBuilder << std::setprecision(10) << storedTime[k] << ",";
+		size_t j = 0;
+		for (long long bin = envelope->FirstBin(spTime[0]); ; bin++) {
+			Real epoch = envelope->BinEpoch(bin);
+			if (epoch > spTime[count - 1])
+				break;
+			while (j + 1 < count && spTime[j + 1] < epoch)
+				j++;
+
+			Real sample[3];
+			if (spTime[j] == epoch)
+				std::copy(&position[3 * j], &position[3 * j] + 3, sample);
+			else if (spTime[j + 1] == epoch)
+				std::copy(&position[3 * (j + 1)], &position[3 * (j + 1)] + 3, sample);
+			else if (track.resumed[j + 1])
+				continue;
+			else {
+				Real fraction = (epoch - spTime[j]) / (spTime[j + 1] - spTime[j]);
+				for (size_t k = 0; k < 3; k++)
+					sample[k] = position[3 * j + k] +
+						fraction * (position[3 * (j + 1) + k] - position[3 * j + k]);
 			}
-			jsonBuilder << "]\n";
-			jsonBuilder << "\t\t" << "},\n";
+			envelope->AddSample(*(*tracks)[i], bin, sample);
+		}
+	}
+}
+
+//------------------------------------------------------------
+// Find the close approaches of the run
+//------------------------------------------------------------
+/*
+* Distances at one epoch do not depend on the frame, so the stored states
+* are used as published, and the search always runs on several threads.
+* The finder reads the tracks a block at a time, so spilled, compressed
+* and single precision buffers are never copied whole. Window gaps and
+* other presence gaps end the path at their resumed samples.
+*/
+size_t DataManager::WriteCloseApproaches(const std::string &jsonFileName,
+	const Integer scCount, const StringArray &scNames, const Real threshold) {
 
+	if (areBuffersCleared || threshold <= 0.0 || scCount < 2)
+		return 0;
+
+	CloseApproachFinder finder;
+	TrackSampleSource source(storedSpTrack, scCount);
+	finder.Find(source, threshold,
+		std::max(1, (Integer)std::thread::hardware_concurrency()));
+	return finder.WriteJson(SuffixedFileName(jsonFileName, "_approaches"), scNames);
+}
+
+//------------------------------------------------------------
+// Write the window's samples as an Arrow IPC file
+//------------------------------------------------------------
+/*
+* One record batch per object with samples in the window, in buffer order.
+* Columns are streamed from the buffers a stretch at a time, so the table
+* is never held whole. When states must be transformed, each stretch is
+* transformed into a scratch buffer as its column is written, so memory
+* stays fixed at the cost of transforming each sample once per column.
+*/
+size_t DataManager::WriteArrow(const std::string &jsonFileName,
+	const Integer scCount, const Integer cbCount,
+	const StringArray &scNames, const StringArray &cbNames,
+	const bool exportAttitude, const Real startEpoch, const Real stopEpoch,
+	SampleTransform *transform) {
+
+	const size_t STRETCH = 4096;
+	size_t channelCount = exportAttitude ? SampleTrack::ATT_Q4 + 1 : SampleTrack::VEL_Z + 1;
+
+	StringArray objects, columns;
+	for (Integer i = 0; i < scCount + cbCount; i++)
+		objects.push_back(i < scCount ? scNames[i] : cbNames[i - scCount]);
+	const char *channelNames[] = { "x", "y", "z", "vx", "vy", "vz",
+		"q1", "q2", "q3", "q4" };
+	columns.push_back("epoch");
+	columns.insert(columns.end(), channelNames, channelNames + channelCount);
+
+	std::ofstream arrowStream(ExtensionFileName(jsonFileName, ".arrow").c_str(),
+		std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	ArrowFileWriter writer(arrowStream, objects, columns);
+
+	RealArray values(STRETCH), states(transform != NULL ? 10 * STRETCH : 0);
+	for (Integer i = 0; i < scCount + cbCount; i++) {
+		SampleTrack &track = *storedSpTrack[i];
+		std::lock_guard<std::mutex> lock(track.mutex);
+		const SampleColumn &spTime = track.time;
+		size_t first = spTime.LowerBound(startEpoch);
+		size_t last = spTime.UpperBound(stopEpoch);
+		if (first >= last)
+			continue;
+		size_t count = last - first;
+
+		writer.BeginBatch(i, count);
+		for (size_t row = 0; row < count; row += STRETCH) {
+			size_t stretch = std::min(STRETCH, count - row);
+			for (size_t j = 0; j < stretch; j++)
+				values[j] = spTime[first + row + j];
+			writer.AddValues(&values[0], stretch);
+		}
+		for (size_t c = 0; c < channelCount; c++) {
+			const SampleColumn &channel = track.Channel(c);
+			for (size_t row = 0; row < count; row += STRETCH) {
+				size_t stretch = std::min(STRETCH, count - row);
+				if (transform != NULL) {
+					for (size_t j = 0; j < stretch; j++) {
+						Real *state = &states[10 * j];
+						for (size_t k = 0; k < 10; k++)
+							state[k] = track.Channel(k)[first + row + j];
+						transform->Apply(i, spTime[first + row + j], state, state + 6);
+						values[j] = state[c];
+					}
+				}
+				else {
+					for (size_t j = 0; j < stretch; j++)
+						values[j] = channel[first + row + j];
+				}
+				writer.AddValues(&values[0], stretch);
+			}
 		}
+	}
 
-		jsonBuilder << "\t" << "]\n";
-		jsonBuilder << "}";
+	size_t bytesWritten = writer.Finish();
+	arrowStream.close();
+	CheckWritten(arrowStream, ExtensionFileName(jsonFileName, ".arrow"));
+	return bytesWritten;
+}
+
+//------------------------------------------------------------
+// Largest float32 rounding error over all objects of some channels
+//------------------------------------------------------------
+/*
+* @firstChannel, @lastChannel SampleTrack channels, inclusive
+*/
+Real DataManager::MaxError(const size_t firstChannel,
+	const size_t lastChannel) const {
+	Real maxError = 0.0;
+	for (size_t i = 0; i < storedSpTrack.size(); i++) {
+		for (size_t c = firstChannel; c <= lastChannel; c++)
+			maxError = std::max(maxError, storedSpTrack[i]->Channel(c).GetMaxError());
+	}
+	return maxError;
+}
+
+//------------------------------------------------------------
+// File name for one of several export windows
+//------------------------------------------------------------
+/*
+* Inserts _window<n> ahead of the extension, e.g. mission_window2.json
+*/
+std::string DataManager::WindowFileName(const std::string &jsonFileName,
+	const size_t windowNumber) {
+	std::ostringstream suffix;
+	suffix << "_window" << windowNumber;
+	return SuffixedFileName(jsonFileName, suffix.str());
+}
+
+//------------------------------------------------------------
+// File name with a suffix ahead of the extension
+//------------------------------------------------------------
+std::string DataManager::SuffixedFileName(const std::string &jsonFileName,
+	const std::string &suffix) {
+	std::string fileName = jsonFileName;
+	size_t dot = fileName.find_last_of('.');
+	size_t slash = fileName.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return fileName + suffix;
+	return fileName.insert(dot, suffix);
+}
+
+//------------------------------------------------------------
+// File name with another extension
+//------------------------------------------------------------
+/*
+* @extension including the dot, e.g. mission.arrow for mission.json
+*/
+std::string DataManager::ExtensionFileName(const std::string &jsonFileName,
+	const std::string &extension) {
+	std::string fileName = jsonFileName;
+	size_t dot = fileName.find_last_of('.');
+	size_t slash = fileName.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		fileName.erase(dot);
+	return fileName + extension;
+}
+
+//------------------------------------------------------------
+// Decimation level of one object
+//------------------------------------------------------------
+/*
+* Number of times the object's buffers were halved. Its collect interval
+* is the configured one times 2^level.
+*/
+Integer DataManager::GetDecimationLevel(const Integer spIndex) const {
+	if (spIndex < 0 || spIndex >= (Integer)storedSpTrack.size())
+		return 0;
+	std::lock_guard<std::mutex> lock(storedSpTrack[spIndex]->mutex);
+	return storedSpTrack[spIndex]->level;
+}
+
+/*
+* @frequency the object's configured collect interval, in rows
+* Returns the interval doubled once per halving, without overflow
+*/
+Integer DataManager::GetSampleInterval(const Integer spIndex,
+	const Integer frequency) const {
+	Integer level = std::min(GetDecimationLevel(spIndex), SampleTrack::MAX_LEVEL);
+	if (frequency > (std::numeric_limits<Integer>::max() >> level))
+		return std::numeric_limits<Integer>::max();
+	return frequency << level;
+}
 
-		jstream << jsonBuilder.str();
+//------------------------------------------------------------
+// Epochs of an export
+//------------------------------------------------------------
+/*
+* @epochs every epoch of a buffered sample or solver pass, ascending and
+* without repeats. Objects sampled on the same rows share their epochs, so
+* the list is about as long as the longest track.
+*/
+void DataManager::GetSampleEpochs(RealArray &epochs) const {
+	epochs.clear();
+	RealArray trackEpochs, merged;
+	for (size_t i = 0; i < storedSpTrack.size(); i++) {
+		SampleTrack &track = *storedSpTrack[i];
+		std::lock_guard<std::mutex> lock(track.mutex);
+		trackEpochs.resize(track.time.size());
+		for (size_t j = 0; j < track.time.size(); j++)
+			trackEpochs[j] = track.time[j];
+		if (!track.inOrder)
+			std::sort(trackEpochs.begin(), trackEpochs.end());
+		merged.clear();
+		std::set_union(epochs.begin(), epochs.end(),
+			trackEpochs.begin(), trackEpochs.end(), std::back_inserter(merged));
+		merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+		epochs.swap(merged);
+	}
 
-		// Close the stream 
-		if (jstream.is_open()) {
-			jstream.close();
+	for (size_t k = 0; k < storedPasses.GetPassCount(); k++) {
+		const SolverPassStore::Pass &pass = storedPasses.GetPass(k);
+		Integer passObjects = (Integer)(pass.data.size() / SolverPassStore::CHANNEL_COUNT);
+		for (Integer i = 0; i < passObjects; i++) {
+			const RealArray &passEpochs =
+				storedPasses.Channel(pass, i, SolverPassStore::EPOCH);
+			merged.clear();
+			std::set_union(epochs.begin(), epochs.end(),
+				passEpochs.begin(), passEpochs.end(), std::back_inserter(merged));
+			merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+			epochs.swap(merged);
 		}
-		ClearDynamicBuffers();
-		return true;
 	}
-	else if (areBuffersCleared == true)
-		return false;
+}
+
+//------------------------------------------------------------
+// Buffer and export statistics
+//------------------------------------------------------------
+/*
+* Number of samples buffered, summed over all objects
+*/
+size_t DataManager::GetSampleCount() const {
+	return storedSampleCount;
+}
+
+/*
+* Bytes reserved by the sample buffers, including spare capacity.
+* Compressed columns count their encoded size. Shared tracks are counted
+* by the instance that buffers them.
+*/
+size_t DataManager::GetBufferBytes() const {
+	size_t bytes = 0;
+	for (size_t i = 0; i < storedSpTrack.size(); i++) {
+		if (BuffersObject(i)) {
+			std::lock_guard<std::mutex> lock(storedSpTrack[i]->mutex);
+			bytes += storedSpTrack[i]->GetBytes();
+		}
+	}
+	return bytes + storedPasses.GetBytes();
+}
+
+/*
+* Size of the last json file written by WriteToJson
+*/
+size_t DataManager::GetBytesWritten() const {
+	return lastBytesWritten;
+}
+
+/*
+* Files of the last WriteBuffers that could not be opened or written
+*/
+const StringArray& DataManager::GetWriteFailures() const {
+	return storedWriteFailures;
 }
\ No newline at end of file
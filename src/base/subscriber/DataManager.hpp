@@ -1,3 +1,6 @@
+#ifndef DataManager_hpp
+#define DataManager_hpp
+
 #define JSON_DLL
 //#define	SP	0
 //#define	X	1
@@ -8,7 +11,13 @@
 //#define	VZ	6
 
 #include "VRInterfaceDefs.hpp"
+#include "SampleTrack.hpp"
+#include "SolverPassStore.hpp"
+#include "EnsembleEnvelope.hpp"
+#include "TrajectoryBounds.hpp"
+#include "CloseApproachFinder.hpp"
 
+#include <atomic>
 #include <fstream>
 #include <iostream>		// for string stream
 #include <sstream>		// for string stream
@@ -17,6 +26,17 @@
 // #include <json/json.h>
 
 
+// Maps stored samples into an exporter's view frame as they are written
+class VRInterface_API SampleTransform
+{
+public:
+	virtual ~SampleTransform() {}
+	// @state position and velocity, @quat attitude; both changed in place.
+	// Export threads call it at once, so it must only read shared state.
+	virtual void Apply(const Integer spIndex, const Real epoch,
+		Real *state, Real *quat) = 0;
+};
+
 class VRInterface_API DataManager // : public VRInterface
 {
 public:
@@ -29,8 +49,12 @@ public:
 	DataManager(const DataManager &source);
 	DataManager& operator=(const DataManager &rhs);
 
-	void BuildDynamicBuffers(const Integer numSp);
+	void BuildDynamicBuffers(const StringArray &objectNames,
+		const std::string &spillDirectory = "", const bool compress = false,
+		const bool singlePrecision = false,
+		const StringArray &sampleKeys = StringArray());
 	void ClearDynamicBuffers();
+	void ReleaseDynamicBuffers();
 
 	void AddToBuffer(
 		const Real time,
@@ -42,9 +66,18 @@ public:
 		const RealArray cbPosX, const RealArray cbPosY, const RealArray cbPosZ,
 		const RealArray cbVelX, const RealArray cbVelY, const RealArray cbVelZ,
 		const RealArray2D cbQ,
+		const BooleanArray &spSampled, const BooleanArray &spAnchor,
 		bool solving, Integer solverOption,
 		bool drawing, const Integer maxData, bool inFunction = false);
+	// appends samples of one object, for callers that load each object on
+	// its own; different objects may be loaded on separate threads
+	// @state six values per sample, @quat four
+	void AddObjectSamples(const Integer spIndex, const RealArray &time,
+		const RealArray &state, const RealArray &quat,
+		const BooleanArray &anchor, const BooleanArray &resumed,
+		const Integer maxData);
 
+	// PrepareExport and WriteBuffers in turn
 	bool WriteToJson(
 		const std::string& jsonFileName, 
 		std::ofstream& jstream,
@@ -53,30 +86,268 @@ public:
 		const RealArray spRadii,
 		const ColorMap &orbitColourMap, const Integer& maxData,
 		const bool exportAttitude, const bool exportColours,
-		const BooleanArray orbitsToDraw);
+		const BooleanArray orbitsToDraw,
+		const RealArray &windowStart, const RealArray &windowStop);
+
+	// every epoch the next export applies a SampleTransform at, ascending
+	// and without repeats
+	void GetSampleEpochs(RealArray &epochs) const;
+
+	// checks the buffers and reports their decimation; false if there is
+	// nothing to write
+	bool PrepareExport(const Integer& scCount, const Integer& cbCount,
+		const StringArray &scNames, const StringArray &cbNames,
+		const Integer& maxData);
+	// writes the buffers, then empties them. Uses no state outside this
+	// instance and shows no messages, so it may run on a worker thread.
+	// @appendRun add the run to a container instead of replacing the file
+	size_t WriteBuffers(
+		const std::string& jsonFileName,
+		std::ofstream& jstream,
+		const Integer& scCount, const Integer& cbCount,
+		const StringArray &scNames, const StringArray &cbNames,
+		const RealArray &spRadii, const ColorMap &orbitColourMap,
+		const bool exportAttitude, const bool exportColours,
+		const RealArray &windowStart, const RealArray &windowStop,
+		SampleTransform *transform = NULL, const bool appendRun = false);
+
+	// folds the run's spacecraft into the dispersion envelope kept next to
+	// the json file; see EnsembleEnvelope. Call ahead of WriteBuffers, which
+	// empties the buffers. Returns the number of bytes written.
+	// @step seconds between envelope epochs
+	size_t WriteEnvelope(const std::string &jsonFileName,
+		const Integer scCount, const StringArray &scNames, const Real step,
+		SampleTransform *transform = NULL);
+	// finds the spacecraft's close approaches over the run and writes them
+	// next to the json file; see CloseApproachFinder. Call ahead of
+	// WriteBuffers. Returns the number of bytes written.
+	// @threshold km
+	size_t WriteCloseApproaches(const std::string &jsonFileName,
+		const Integer scCount, const StringArray &scNames, const Real threshold);
+
+	// one block of an object's samples as written, for the epoch index
+	struct EpochBlock
+	{
+		enum { EPH, ATT, TIME, PART_COUNT };
+
+		Real start, stop;				// epochs of its first and last sample
+		size_t first, count;			// samples, from the object's first written
+		size_t offset[PART_COUNT];	// bytes from the start of the file
+		size_t length[PART_COUNT];
+	};
+
+	// @blockSize samples per block of the epoch index written next to each
+	// file; 0 writes no index
+	void SetEpochIndexBlock(const Integer blockSize);
+	// @days duration of the tiles each export is split into; 0 writes
+	// single files
+	void SetTileDuration(const Real days);
+	// @levels coarser levels written per object; 0 writes no pyramid
+	// @tolerance position error of the first level, in km; each level
+	// doubles it
+	void SetLodPyramid(const Integer levels, const Real tolerance);
+	// @chunkSize samples per chunk of the spatial index written per object;
+	// 0 writes no index
+	void SetBoundsChunk(const Integer chunkSize);
+	// @level zlib level of the gzipped documents written in place of plain
+	// json, 1 to 9; 0 writes plain json. See GzipStreamBuffer.
+	void SetCompressionLevel(const Integer level);
+	// @arrow whether each export also writes an Arrow IPC file with the
+	// json file's name and the extension .arrow. See ArrowFileWriter.
+	void SetArrowExport(const bool arrow);
+
+	// whether this instance buffers an object, or only shares its track
+	bool BuffersObject(const Integer spIndex) const;
+	// toggles this instance; its shared tracks are handed to another member
+	void SetActive(const bool active);
+
+	// solver passes are kept apart from the mission trajectory; see
+	// SolverPassStore for the limits
+	void BuildSolverPasses(const Integer scCount, const Integer passLimit,
+		const Integer passInterval, const Integer pointLimit);
+	bool BeginSolverPass();
+	void AddSolverRow(const Real time, const Integer scCount,
+		const BooleanArray &scSampled,
+		const RealArray &scPosX, const RealArray &scPosY, const RealArray &scPosZ,
+		const RealArray &scVelX, const RealArray &scVelY, const RealArray &scVelZ);
+
+	// flags the last buffered sample of an object as a discontinuity
+	void AnchorLastSample(const Integer spIndex);
+	// flags the last buffered sample of an object as the first after a gap
+	void ResumeLastSample(const Integer spIndex);
+
+	// progressive decimation: each halving doubles the object's interval
+	Integer GetDecimationLevel(const Integer spIndex) const;
+	// rows between samples of an object collected every @frequency rows
+	Integer GetSampleInterval(const Integer spIndex,
+		const Integer frequency) const;
+
+	// buffer and export statistics, for performance logging
+	size_t GetSampleCount() const;
+	size_t GetBufferBytes() const;
+	size_t GetBytesWritten() const;
+	// files the last WriteBuffers could not write, empty if all were written
+	const StringArray& GetWriteFailures() const;
 
 protected:
 
+	size_t WriteRangeToJson(
+		std::ostream& jstream,
+		const Integer& scCount, const Integer& cbCount,
+		const StringArray &scNames, const StringArray &cbNames,
+		const RealArray &spRadii, const ColorMap &orbitColourMap,
+		const bool exportAttitude, const bool exportColours,
+		const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform,
+		const Integer firstObject, const Integer lastObject,
+		const bool writePasses, const bool writeIndex);
+
+	size_t AppendRunToContainer(
+		const std::string& containerFileName,
+		std::ofstream& jstream,
+		const Integer& scCount, const Integer& cbCount,
+		const StringArray &scNames, const StringArray &cbNames,
+		const RealArray &spRadii, const ColorMap &orbitColourMap,
+		const bool exportAttitude, const bool exportColours,
+		const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform);
+
+	void WriteObjectToJson(
+		std::ostringstream& jsonBuilder, const Integer spIndex,
+		const std::string &name, const Real radius,
+		const ColorMap &orbitColourMap,
+		const bool exportAttitude, const bool exportColours,
+		const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform, std::vector<EpochBlock> *blocks,
+		const TrajectoryBounds *bounds);
+
+	void WriteSolverPassesToJson(
+		std::ostringstream& jsonBuilder,
+		const Integer scCount, const StringArray &scNames,
+		const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform);
+
+	void FoldIntoEnvelope(EnsembleEnvelope *envelope,
+		std::vector<EnsembleEnvelope::Track*> *tracks,
+		const Integer firstObject, const Integer objectStride,
+		SampleTransform *transform);
+
+	// tiles of one export window, shared by the threads writing them
+	struct TileJob
+	{
+		Integer scCount, cbCount;
+		const StringArray *scNames, *cbNames;
+		const RealArray *spRadii;
+		const ColorMap *orbitColourMap;
+		bool exportAttitude, exportColours;
+		SampleTransform *transform;
+		StringArray fileNames;
+		RealArray start, stop;			// epochs, both inclusive
+		std::vector<size_t> bytes;		// 0 for a tile without samples
+		std::vector<Integer> failed;	// 1 for a tile that could not be written
+	};
+
+	size_t WriteTiles(
+		const std::string& fileName,
+		const Integer& scCount, const Integer& cbCount,
+		const StringArray &scNames, const StringArray &cbNames,
+		const RealArray &spRadii, const ColorMap &orbitColourMap,
+		const bool exportAttitude, const bool exportColours,
+		const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform);
+	void WriteTileRange(TileJob *job, const Integer firstTile,
+		const Integer tileStride);
+
+	void AddEpochIndexLines(StringArray &lines, const size_t documentOffset,
+		const Integer firstObject, const Integer lastObject,
+		const Integer scCount, const StringArray &scNames,
+		const StringArray &cbNames, const Integer run) const;
+	void WriteEpochIndex(const std::string &fileName,
+		const StringArray &lines, const bool compressed = false);
+	void CheckWritten(const std::ofstream &stream, const std::string &fileName);
+
+	void BuildBoundsRange(std::vector<TrajectoryBounds> *bounds,
+		const Integer firstObject, const Integer firstItem,
+		const Integer itemStride, const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform);
+
+	void BuildLodLevels(const RealArray &position, const RealArray &epoch,
+		const BooleanArray &fixed,
+		std::vector<std::vector<size_t> > &levels, RealArray &errors) const;
+
+	Real MaxError(const size_t firstChannel, const size_t lastChannel) const;
+
+	void DecimateBuffer(const Integer spIndex);
+	void OrderBuffer(const Integer spIndex, const bool dropRepeats);
+	void CompactBuffer(const Integer spIndex, const std::vector<size_t> &keep);
+
+	size_t WriteArrow(const std::string &jsonFileName,
+		const Integer scCount, const Integer cbCount,
+		const StringArray &scNames, const StringArray &cbNames,
+		const bool exportAttitude, const Real startEpoch, const Real stopEpoch,
+		SampleTransform *transform);
+
+	static std::string SuffixedFileName(const std::string &jsonFileName,
+		const std::string &suffix);
+	static std::string ExtensionFileName(const std::string &jsonFileName,
+		const std::string &extension);
+	static std::string WindowFileName(const std::string &jsonFileName,
+		const size_t windowNumber);
+
 	// static bool maxDataExceeded;
 
 	// prevents out-of-bounds exception due to Distribute being called twice
 	// at EndOfRun
-	static bool areBuffersCleared;
+	bool areBuffersCleared;
+
+	// one track per object, in buffer order. Tracks are shared with other
+	// instances that sample the object the same way.
+	SampleTrackArray storedSpTrack; // [numSp]
+
+	// samples buffered by this instance, over all objects; objects may be
+	// loaded on separate threads
+	std::atomic<size_t> storedSampleCount;
+
+	// track keys, kept between runs so that a rerun of the same objects
+	// reuses their memory
+	StringArray storedTrackKeys;
+
+	// size of the last json file written
+	size_t lastBytesWritten;
+
+	// files the last export failed to write
+	StringArray storedWriteFailures;
 
-	static RealArray2D storedSpPosX; // [numSp][RealArray maxData]
-	static RealArray2D storedSpPosY; 
-	static RealArray2D storedSpPosZ; 
-	static RealArray2D storedSpVelX; 
-	static RealArray2D storedSpVelY; 
-	static RealArray2D storedSpVelZ; 
+	// spacecraft trajectories of the last solver passes, private to this
+	// instance
+	SolverPassStore storedPasses;
 
-	static RealArray2D storedSpQ1;	// [numSp][RealArray maxData]
-	static RealArray2D storedSpQ2;
-	static RealArray2D storedSpQ3;
-	static RealArray2D storedSpQ4;
+	// samples per epoch index block, 0 for no index
+	Integer storedIndexBlock;
 
-	static RealArray storedTime; // [maxData]
+	// days per tile, 0 for no tiling
+	Real storedTileDuration;
+
+	// level of detail pyramid: coarser levels per object, 0 for none, and
+	// the error of the first, in km
+	Integer storedLodLevels;
+	Real storedLodTolerance;
+
+	// samples per chunk of the spatial index, 0 for no index
+	Integer storedBoundsChunk;
+
+	// zlib level of gzipped documents, 0 for plain json
+	Integer storedCompressionLevel;
+
+	// whether an Arrow IPC file is written with the json
+	bool storedArrowExport;
+
+	// blocks of each object in the last document written, with offsets
+	// from the start of the document
+	std::vector<std::vector<EpochBlock> > storedEpochBlocks; // [numSp]
 
 };
 
-// implementations for methods to prevent unresolved externals 
\ No newline at end of file
+// implementations for methods to prevent unresolved externals 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,325 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  EnsembleEnvelope
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements EnsembleEnvelope class
+//
+// State file layout, native byte order:
+//    8 bytes    "VRENV001"
+//    Real       grid step, seconds
+//    Integer    runs folded in
+//    Integer    track count, then per track:
+//       Integer    name length, then the name
+//       long long  first bin
+//       Integer    bin count, then 10 Reals per bin: count, mean, m2
+
+#include "EnsembleEnvelope.hpp"
+
+#include <algorithm>		// for min(), max()
+#include <cmath>			// for ceil()
+#include <cstring>		// for memcmp()
+#include <fstream>
+#include <iomanip>		// for setprecision()
+#include <sstream>
+
+namespace
+{
+	const char STATE_MAGIC[8] = { 'V', 'R', 'E', 'N', 'V', '0', '0', '1' };
+
+	template <typename T>
+	void WriteValue(std::ofstream &out, const T &value) {
+		out.write((const char*)&value, sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream &in, T &value) {
+		return (bool)in.read((char*)&value, sizeof(T));
+	}
+}
+
+
+//------------------------------------------------------------
+// Moments
+//------------------------------------------------------------
+EnsembleEnvelope::Moments::Moments() :
+	count(0.0) {
+	for (Integer k = 0; k < 3; k++)
+		mean[k] = 0.0;
+	for (Integer k = 0; k < 6; k++)
+		m2[k] = 0.0;
+}
+
+void EnsembleEnvelope::Moments::Add(const Real *position) {
+	Real before[3], after[3];
+	count += 1.0;
+	for (Integer k = 0; k < 3; k++) {
+		before[k] = position[k] - mean[k];
+		mean[k] += before[k] / count;
+		after[k] = position[k] - mean[k];
+	}
+	m2[0] += before[0] * after[0];
+	m2[1] += before[0] * after[1];
+	m2[2] += before[0] * after[2];
+	m2[3] += before[1] * after[1];
+	m2[4] += before[1] * after[2];
+	m2[5] += before[2] * after[2];
+}
+
+void EnsembleEnvelope::Moments::Merge(const Moments &other) {
+	if (other.count == 0.0)
+		return;
+	if (count == 0.0) {
+		*this = other;
+		return;
+	}
+
+	Real total = count + other.count;
+	Real weight = count * other.count / total;
+	Real delta[3];
+	for (Integer k = 0; k < 3; k++) {
+		delta[k] = other.mean[k] - mean[k];
+		mean[k] += delta[k] * other.count / total;
+	}
+	m2[0] += other.m2[0] + delta[0] * delta[0] * weight;
+	m2[1] += other.m2[1] + delta[0] * delta[1] * weight;
+	m2[2] += other.m2[2] + delta[0] * delta[2] * weight;
+	m2[3] += other.m2[3] + delta[1] * delta[1] * weight;
+	m2[4] += other.m2[4] + delta[1] * delta[2] * weight;
+	m2[5] += other.m2[5] + delta[2] * delta[2] * weight;
+	count = total;
+}
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+EnsembleEnvelope::EnsembleEnvelope(const Real step) :
+	mStep(step),
+	mRunCount(0) {
+}
+
+//------------------------------------------------------------
+// Epoch grid
+//------------------------------------------------------------
+/*
+* Grid epochs are whole multiples of the step from A1ModJulian 0, so runs
+* of different spans share them.
+*/
+long long EnsembleEnvelope::FirstBin(const Real epoch) const {
+	long long bin = (long long)std::ceil(epoch * 86400.0 / mStep);
+	// rounding may put the bin's epoch just before the one asked for
+	while (BinEpoch(bin) < epoch)
+		bin++;
+	return bin;
+}
+
+Real EnsembleEnvelope::BinEpoch(const long long bin) const {
+	return bin * mStep / 86400.0;
+}
+
+//------------------------------------------------------------
+// Folding runs in
+//------------------------------------------------------------
+EnsembleEnvelope::Track& EnsembleEnvelope::GetTrack(const std::string &name) {
+	for (size_t i = 0; i < mTracks.size(); i++) {
+		if (mTracks[i].name == name)
+			return mTracks[i];
+	}
+	mTracks.push_back(Track());
+	mTracks.back().name = name;
+	mTracks.back().firstBin = 0;
+	return mTracks.back();
+}
+
+void EnsembleEnvelope::AddSample(Track &track, const long long bin,
+	const Real *position) {
+	if (track.bins.empty())
+		track.firstBin = bin;
+	else if (bin < track.firstBin) {
+		track.bins.insert(track.bins.begin(), (size_t)(track.firstBin - bin), Moments());
+		track.firstBin = bin;
+	}
+
+	size_t index = (size_t)(bin - track.firstBin);
+	if (index >= track.bins.size())
+		track.bins.resize(index + 1);
+	track.bins[index].Add(position);
+}
+
+void EnsembleEnvelope::EndRun() {
+	mRunCount++;
+}
+
+/*
+* Both envelopes must use the same step
+*/
+void EnsembleEnvelope::Merge(const EnsembleEnvelope &other) {
+	for (size_t i = 0; i < other.mTracks.size(); i++) {
+		const Track &source = other.mTracks[i];
+		if (source.bins.empty())
+			continue;
+
+		Track &track = GetTrack(source.name);
+		if (track.bins.empty())
+			track.firstBin = source.firstBin;
+		long long first = std::min(track.firstBin, source.firstBin);
+		long long last = std::max(track.firstBin + (long long)track.bins.size(),
+			source.firstBin + (long long)source.bins.size());
+		if (first < track.firstBin) {
+			track.bins.insert(track.bins.begin(), (size_t)(track.firstBin - first), Moments());
+			track.firstBin = first;
+		}
+		track.bins.resize((size_t)(last - first));
+
+		for (size_t k = 0; k < source.bins.size(); k++)
+			track.bins[(size_t)(source.firstBin - first) + k].Merge(source.bins[k]);
+	}
+	mRunCount += other.mRunCount;
+}
+
+//------------------------------------------------------------
+// State file
+//------------------------------------------------------------
+bool EnsembleEnvelope::Load(const std::string &fileName) {
+	std::ifstream in(fileName.c_str(), std::ios::binary);
+	char magic[8];
+	Real step;
+	Integer runCount, trackCount;
+	if (!in.read(magic, 8) || memcmp(magic, STATE_MAGIC, 8) != 0 ||
+		!ReadValue(in, step) || step != mStep ||
+		!ReadValue(in, runCount) || !ReadValue(in, trackCount) || trackCount < 0)
+		return false;
+
+	std::deque<Track> tracks(trackCount);
+	for (Integer i = 0; i < trackCount; i++) {
+		Integer nameLength, binCount;
+		if (!ReadValue(in, nameLength) || nameLength < 0)
+			return false;
+		tracks[i].name.resize(nameLength);
+		if ((nameLength > 0 && !in.read(&tracks[i].name[0], nameLength)) ||
+			!ReadValue(in, tracks[i].firstBin) || !ReadValue(in, binCount) ||
+			binCount < 0)
+			return false;
+
+		tracks[i].bins.resize(binCount);
+		for (Integer k = 0; k < binCount; k++) {
+			Moments &moments = tracks[i].bins[k];
+			if (!ReadValue(in, moments.count) ||
+				!in.read((char*)moments.mean, sizeof(moments.mean)) ||
+				!in.read((char*)moments.m2, sizeof(moments.m2)))
+				return false;
+		}
+	}
+
+	mRunCount = runCount;
+	mTracks.swap(tracks);
+	return true;
+}
+
+bool EnsembleEnvelope::Save(const std::string &fileName) const {
+	std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+	out.write(STATE_MAGIC, 8);
+	WriteValue(out, mStep);
+	WriteValue(out, mRunCount);
+	WriteValue(out, (Integer)mTracks.size());
+	for (size_t i = 0; i < mTracks.size(); i++) {
+		const Track &track = mTracks[i];
+		WriteValue(out, (Integer)track.name.size());
+		out.write(track.name.data(), track.name.size());
+		WriteValue(out, track.firstBin);
+		WriteValue(out, (Integer)track.bins.size());
+		for (size_t k = 0; k < track.bins.size(); k++) {
+			WriteValue(out, track.bins[k].count);
+			out.write((const char*)track.bins[k].mean, sizeof(track.bins[k].mean));
+			out.write((const char*)track.bins[k].m2, sizeof(track.bins[k].m2));
+		}
+	}
+	return (bool)out;
+}
+
+//------------------------------------------------------------
+// Write the envelope as json
+//------------------------------------------------------------
+/*
+* Per object and grid epoch: the number of runs that reached it, the mean
+* position and its covariance (xx, xy, xz, yy, yz, zz), from which a client
+* draws an ellipsoid tube. Epochs no run reached are left out.
+*/
+size_t EnsembleEnvelope::WriteJson(const std::string &fileName) const {
+	std::ofstream jstream(fileName.c_str(), std::ofstream::out | std::ofstream::trunc);
+	std::ostringstream jsonBuilder;
+	size_t bytesWritten = 0;
+
+	jsonBuilder << "{";
+	jsonBuilder << "\t" << "\"info\": {\n";
+	jsonBuilder << "\t\t" << "\"coordinates\": \"cartesian\",\n";
+	jsonBuilder << "\t\t" << "\"units\": \"km\",\n";
+	jsonBuilder << "\t\t" << "\"runs\": " << mRunCount << ",\n";
+	jsonBuilder << "\t\t" << "\"step\": " << mStep << "\n";
+	jsonBuilder << "\t" << "},\n";
+	jsonBuilder << "\t" << "\"envelopes\": [\n";
+
+	for (size_t i = 0; i < mTracks.size(); i++) {
+		const Track &track = mTracks[i];
+		jsonBuilder << "\t\t" << "{\n";
+		jsonBuilder << "\t\t\t" << "\"name\": \"" << track.name << "\",\n";
+
+		jsonBuilder << "\t\t\t" << "\"time\": [";
+		for (size_t k = 0; k < track.bins.size(); k++) {
+			if (track.bins[k].count > 0.0)
+				jsonBuilder << std::setprecision(10) << BinEpoch(track.firstBin + k) << ",";
+		}
+		jsonBuilder << "],\n";
+
+		jsonBuilder << "\t\t\t" << "\"count\": [";
+		for (size_t k = 0; k < track.bins.size(); k++) {
+			if (track.bins[k].count > 0.0)
+				jsonBuilder << track.bins[k].count << ",";
+		}
+		jsonBuilder << "],\n";
+
+		jsonBuilder << "\t\t\t" << "\"mean\": [\n";
+		for (size_t k = 0; k < track.bins.size(); k++) {
+			const Moments &moments = track.bins[k];
+			if (moments.count == 0.0)
+				continue;
+			jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(10)
+				<< std::setw(14) << moments.mean[0] << ","
+				<< std::setw(14) << moments.mean[1] << ","
+				<< std::setw(14) << moments.mean[2] << "],\n";
+		}
+		jsonBuilder << "\t\t\t" << "],\n";
+
+		// sample covariance; a single run has none
+		jsonBuilder << "\t\t\t" << "\"covariance\": [\n";
+		for (size_t k = 0; k < track.bins.size(); k++) {
+			const Moments &moments = track.bins[k];
+			if (moments.count == 0.0)
+				continue;
+			Real scale = moments.count > 1.0 ? 1.0 / (moments.count - 1.0) : 0.0;
+			jsonBuilder << "\t\t\t\t" << "[" << std::setprecision(6);
+			for (Integer c = 0; c < 6; c++)
+				jsonBuilder << moments.m2[c] * scale << (c < 5 ? "," : "");
+			jsonBuilder << "],\n";
+		}
+		jsonBuilder << "\t\t\t" << "]\n";
+		jsonBuilder << "\t\t" << "},\n";
+
+		// one object at a time, as in DataManager::WriteRangeToJson
+		const std::string objectText = jsonBuilder.str();
+		jstream << objectText;
+		bytesWritten += objectText.size();
+		jsonBuilder.str("");
+	}
+
+	jsonBuilder << "\t" << "]\n";
+	jsonBuilder << "}";
+	const std::string jsonText = jsonBuilder.str();
+	jstream << jsonText;
+	bytesWritten += jsonText.size();
+	jstream.close();
+
+	return bytesWritten;
+}
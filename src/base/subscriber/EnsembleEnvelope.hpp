@@ -0,0 +1,78 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  EnsembleEnvelope
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares EnsembleEnvelope class, the running statistics of the spacecraft
+// positions over many runs of one mission, e.g. a Monte Carlo dispersion
+// study. Each run is sampled on a fixed epoch grid and folded into a mean and
+// covariance per grid epoch, so no run is kept once it has been folded in.
+// Partial results, e.g. from separate sessions, merge exactly, and the state
+// is kept in a file between runs.
+
+#ifndef EnsembleEnvelope_hpp
+#define EnsembleEnvelope_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <deque>
+#include <vector>
+
+class VRInterface_API EnsembleEnvelope
+{
+public:
+	// running moments of one position: Welford's update for one sample, and
+	// Chan's update for merging two partial results
+	struct Moments
+	{
+		Moments();
+		void Add(const Real *position);
+		void Merge(const Moments &other);
+
+		Real count;
+		Real mean[3];
+		Real m2[6];		// sums of squared deviations: xx, xy, xz, yy, yz, zz
+	};
+
+	struct Track
+	{
+		std::string name;
+		long long firstBin;				// grid index of bins[0]
+		std::vector<Moments> bins;
+	};
+
+	// @step seconds between grid epochs
+	EnsembleEnvelope(const Real step);
+
+	Real GetStep() const { return mStep; }
+	Integer GetRunCount() const { return mRunCount; }
+
+	// grid index of the first grid epoch at or after an epoch, and back
+	long long FirstBin(const Real epoch) const;
+	Real BinEpoch(const long long bin) const;
+
+	// the track of an object, created on first use. Not thread safe; get
+	// every track before folding objects on separate threads. A track
+	// stays where it is as others are created.
+	Track& GetTrack(const std::string &name);
+	// adds one run's position at a grid epoch. Tracks are independent, so
+	// different tracks may be added to at the same time.
+	void AddSample(Track &track, const long long bin, const Real *position);
+	void EndRun();
+
+	void Merge(const EnsembleEnvelope &other);
+
+	// false if the file is missing or was made with another step
+	bool Load(const std::string &fileName);
+	bool Save(const std::string &fileName) const;
+	// returns the number of bytes written
+	size_t WriteJson(const std::string &fileName) const;
+
+protected:
+	Real mStep;
+	Integer mRunCount;
+	std::deque<Track> mTracks;
+};
+
+#endif
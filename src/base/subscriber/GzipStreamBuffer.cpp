@@ -0,0 +1,247 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  GzipStreamBuffer
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements GzipStreamBuffer class
+//
+// Member layout (RFC 1952), little endian:
+//    10 bytes   1f 8b 08 04, mtime 0, xfl 0, os 255
+//    2 bytes    extra field length, 8
+//    8 bytes    subfield 'V' 'R', length 4, then the member's length
+//    raw deflate data of one block
+//    4 bytes    CRC-32 of the block
+//    4 bytes    block length
+
+#include "GzipStreamBuffer.hpp"
+
+#include <algorithm>		// for min(), max()
+#include <cstring>		// for memset()
+
+#ifdef VRINTERFACE_HAVE_ZLIB
+	#include <zlib.h>
+#endif
+
+namespace
+{
+	// large enough that blocks compress about as well as one stream
+	const size_t BLOCK_SIZE = 1 << 20;
+	const size_t HEADER_SIZE = 20;
+	const size_t TRAILER_SIZE = 8;
+
+	void PutLittleEndian(char *out, const unsigned long value) {
+		for (size_t k = 0; k < 4; k++)
+			out[k] = (char)((value >> (8 * k)) & 0xFF);
+	}
+}
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+GzipStreamBuffer::GzipStreamBuffer(std::ostream &sink, const Integer level,
+	const Integer workerCount) :
+	mSink(sink),
+	mLevel(std::max(1, std::min(9, level))),
+	mTextBytes(0),
+	mFileBytes(0),
+	mFinished(false),
+	mStopping(false) {
+	mText.reserve(BLOCK_SIZE);
+	for (Integer w = 0; w < workerCount && workerCount > 1; w++)
+		mWorkers.push_back(std::thread(&GzipStreamBuffer::Work, this));
+}
+
+//------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------
+GzipStreamBuffer::~GzipStreamBuffer() {
+	Finish();
+}
+
+//------------------------------------------------------------
+// Whether zlib was found at build time
+//------------------------------------------------------------
+bool GzipStreamBuffer::IsAvailable() {
+#ifdef VRINTERFACE_HAVE_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+//------------------------------------------------------------
+// Write out the last block
+//------------------------------------------------------------
+size_t GzipStreamBuffer::Finish() {
+	if (mFinished)
+		return mFileBytes;
+
+	Submit();
+	WriteDone(0);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWorkReady.notify_all();
+	for (size_t w = 0; w < mWorkers.size(); w++)
+		mWorkers[w].join();
+	mWorkers.clear();
+
+	mSink.flush();
+	mFinished = true;
+	return mFileBytes;
+}
+
+//------------------------------------------------------------
+// std::streambuf
+//------------------------------------------------------------
+GzipStreamBuffer::int_type GzipStreamBuffer::overflow(int_type c) {
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+	mText.push_back(traits_type::to_char_type(c));
+	if (mText.size() >= BLOCK_SIZE)
+		Submit();
+	return c;
+}
+
+std::streamsize GzipStreamBuffer::xsputn(const char *s, std::streamsize n) {
+	std::streamsize written = 0;
+	while (written < n) {
+		size_t part = std::min((size_t)(n - written), BLOCK_SIZE - mText.size());
+		mText.append(s + written, part);
+		written += part;
+		if (mText.size() >= BLOCK_SIZE)
+			Submit();
+	}
+	return n;
+}
+
+/*
+* A flush does not cut the block short, which would cost compression
+*/
+int GzipStreamBuffer::sync() {
+	return 0;
+}
+
+//------------------------------------------------------------
+// Hand the filled block to the workers
+//------------------------------------------------------------
+/*
+* Waits while too many blocks are in flight, so memory stays bounded
+* however fast the text is written
+*/
+void GzipStreamBuffer::Submit() {
+	if (mText.empty())
+		return;
+
+	Block *block = new Block();
+	block->text.swap(mText);
+	block->done = false;
+	mText.reserve(BLOCK_SIZE);
+	mTextBytes += block->text.size();
+
+	if (mWorkers.empty()) {
+		Compress(*block);
+		block->done = true;
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending.push_back(block);
+	}
+	else {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending.push_back(block);
+		mQueue.push_back(block);
+	}
+	mWorkReady.notify_one();
+	WriteDone(2 * mWorkers.size());
+}
+
+//------------------------------------------------------------
+// Write compressed members in order
+//------------------------------------------------------------
+/*
+* @pendingLimit blocks that may stay in flight on return
+*/
+void GzipStreamBuffer::WriteDone(const size_t pendingLimit) {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (!mPending.empty()) {
+		Block *block = mPending.front();
+		if (!block->done) {
+			if (mPending.size() <= pendingLimit)
+				break;
+			mBlockDone.wait(lock);
+			continue;
+		}
+		mPending.pop_front();
+		lock.unlock();
+
+		mSink.write(block->member.data(), block->member.size());
+		mFileBytes += block->member.size();
+		delete block;
+
+		lock.lock();
+	}
+}
+
+//------------------------------------------------------------
+// Worker thread
+//------------------------------------------------------------
+void GzipStreamBuffer::Work() {
+	for (;;) {
+		Block *block;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			while (mQueue.empty() && !mStopping)
+				mWorkReady.wait(lock);
+			if (mQueue.empty())
+				return;
+			block = mQueue.front();
+			mQueue.pop_front();
+		}
+
+		Compress(*block);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			block->done = true;
+		}
+		mBlockDone.notify_all();
+	}
+}
+
+//------------------------------------------------------------
+// Compress one block into a gzip member
+//------------------------------------------------------------
+void GzipStreamBuffer::Compress(Block &block) const {
+#ifdef VRINTERFACE_HAVE_ZLIB
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	deflateInit2(&stream, mLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	uLong bound = deflateBound(&stream, (uLong)block.text.size());
+	block.member.resize(HEADER_SIZE + bound + TRAILER_SIZE);
+	stream.next_in = (Bytef*)block.text.data();
+	stream.avail_in = (uInt)block.text.size();
+	stream.next_out = (Bytef*)&block.member[HEADER_SIZE];
+	stream.avail_out = (uInt)bound;
+	deflate(&stream, Z_FINISH);
+	size_t deflated = stream.total_out;
+	deflateEnd(&stream);
+
+	size_t memberSize = HEADER_SIZE + deflated + TRAILER_SIZE;
+	block.member.resize(memberSize);
+	const char header[16] = { '\x1f', '\x8b', 8, 4, 0, 0, 0, 0, 0, '\xff',
+		8, 0, 'V', 'R', 4, 0 };
+	std::copy(header, header + 16, block.member.begin());
+	PutLittleEndian(&block.member[16], (unsigned long)memberSize);
+
+	uLong crc = crc32(0L, (const Bytef*)block.text.data(), (uInt)block.text.size());
+	PutLittleEndian(&block.member[HEADER_SIZE + deflated], crc);
+	PutLittleEndian(&block.member[HEADER_SIZE + deflated + 4],
+		(unsigned long)block.text.size());
+#endif
+
+	// the text is no longer needed once compressed
+	std::string().swap(block.text);
+}
@@ -0,0 +1,83 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  GzipStreamBuffer
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares GzipStreamBuffer class, a stream buffer that gzips what is
+// written through it. The text is cut into blocks, each compressed on a
+// worker thread into a gzip member of its own, and the members are written
+// to the file in order. Concatenated members are a valid gzip file, so
+// gunzip, zcat and zlib read it whole. Each member also records its own
+// length in an extra header field, so a reader can step from member to
+// member and inflate only those holding the bytes it wants.
+//
+// Compression needs zlib, found at build time; without it IsAvailable()
+// returns false and nothing should be written through the buffer.
+
+#ifndef GzipStreamBuffer_hpp
+#define GzipStreamBuffer_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+class VRInterface_API GzipStreamBuffer : public std::streambuf
+{
+public:
+	// @sink receives the members, opened in binary mode
+	// @level zlib compression level, 1 to 9
+	// @workerCount threads compressing blocks; 1 compresses on the
+	// writing thread
+	GzipStreamBuffer(std::ostream &sink, const Integer level,
+		const Integer workerCount);
+	~GzipStreamBuffer();
+
+	static bool IsAvailable();
+
+	// compresses what is left and waits for every member to be written;
+	// returns the number of bytes written to the sink
+	size_t Finish();
+
+	// bytes uncompressed, then written to the sink so far
+	size_t GetTextBytes() const { return mTextBytes; }
+	size_t GetFileBytes() const { return mFileBytes; }
+
+protected:
+	struct Block
+	{
+		std::string text;
+		std::string member;
+		bool done;
+	};
+
+	virtual int_type overflow(int_type c);
+	virtual std::streamsize xsputn(const char *s, std::streamsize n);
+	virtual int sync();
+
+	void Submit();
+	void WriteDone(const size_t pendingLimit);
+	void Work();
+	void Compress(Block &block) const;
+
+	std::ostream &mSink;
+	Integer mLevel;
+	std::string mText;					// block being filled
+	size_t mTextBytes, mFileBytes;
+	bool mFinished;
+
+	std::vector<std::thread> mWorkers;
+	std::deque<Block*> mPending;		// in file order, compressed or not
+	std::deque<Block*> mQueue;			// waiting for a worker
+	std::mutex mMutex;
+	std::condition_variable mWorkReady, mBlockDone;
+	bool mStopping;
+};
+
+#endif
@@ -0,0 +1,258 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  PerformanceLog
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements PerformanceLog class
+
+#include "PerformanceLog.hpp"
+#include "MessageInterface.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>		// for getrusage()
+#endif
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+PerformanceLog::PerformanceLog() {
+	mObjectCount = 0;
+	mExportAttitude = false;
+	mFrameConversion = false;
+	Reset();
+}
+
+//------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------
+PerformanceLog::~PerformanceLog() {
+}
+
+//------------------------------------------------------------
+// Copy constructor
+//------------------------------------------------------------
+PerformanceLog::PerformanceLog(const PerformanceLog &pl) {
+	operator=(pl);
+}
+
+//------------------------------------------------------------
+// Assignment Operator
+//------------------------------------------------------------
+PerformanceLog& PerformanceLog::operator=(const PerformanceLog &pl) {
+	mIngestStart = pl.mIngestStart;
+	mExportStart = pl.mExportStart;
+	mIngestSeconds = pl.mIngestSeconds;
+	mExportSeconds = pl.mExportSeconds;
+	mIngestCalls = pl.mIngestCalls;
+	mSamplesKept = pl.mSamplesKept;
+	mBytesWritten = pl.mBytesWritten;
+	mSamples = pl.mSamples;
+	mBufferBytes = pl.mBufferBytes;
+	mObjectCount = pl.mObjectCount;
+	mExportAttitude = pl.mExportAttitude;
+	mFrameConversion = pl.mFrameConversion;
+
+	return *this;
+}
+
+//------------------------------------------------------------
+// Reset counters at start of run
+//------------------------------------------------------------
+void PerformanceLog::Reset() {
+	mIngestSeconds = 0.0;
+	mExportSeconds = 0.0;
+	mIngestCalls = 0;
+	mSamplesKept = 0;
+	mBytesWritten = 0;
+	mSamples = 0;
+	mBufferBytes = 0;
+}
+
+//------------------------------------------------------------
+// Timing of ingest and export
+//------------------------------------------------------------
+void PerformanceLog::StartIngest() {
+	mIngestStart = std::chrono::steady_clock::now();
+}
+
+void PerformanceLog::StopIngest(bool sampleKept) {
+	std::chrono::duration<Real> elapsed =
+		std::chrono::steady_clock::now() - mIngestStart;
+	mIngestSeconds += elapsed.count();
+	mIngestCalls++;
+	if (sampleKept)
+		mSamplesKept++;
+}
+
+void PerformanceLog::StartExport() {
+	mExportStart = std::chrono::steady_clock::now();
+}
+
+void PerformanceLog::StopExport(const size_t bytesWritten) {
+	std::chrono::duration<Real> elapsed =
+		std::chrono::steady_clock::now() - mExportStart;
+	mExportSeconds += elapsed.count();
+	mBytesWritten += bytesWritten;
+}
+
+//------------------------------------------------------------
+// Run description, used as the key for baseline comparison
+//------------------------------------------------------------
+void PerformanceLog::SetConfiguration(const Integer objectCount,
+	const bool exportAttitude, const bool frameConversion) {
+	mObjectCount = objectCount;
+	mExportAttitude = exportAttitude;
+	mFrameConversion = frameConversion;
+}
+
+//------------------------------------------------------------
+// Buffer size at export, which is the peak for the run
+//------------------------------------------------------------
+void PerformanceLog::SetBufferUsage(const size_t samples,
+	const size_t bufferBytes) {
+	mSamples = samples;
+	mBufferBytes = bufferBytes;
+}
+
+//------------------------------------------------------------
+// Append results to log file
+//------------------------------------------------------------
+/*
+* One JSON object per line, so that the file can be read back with
+* any JSON Lines reader and used as a baseline later on
+*/
+bool PerformanceLog::Write(const std::string &logFileName) const {
+	std::ofstream logStream(logFileName, std::ofstream::app);
+	if (!logStream.is_open()) {
+		MessageInterface::ShowMessage("*** WARNING *** VRInterface: Cannot open "
+			"performance log \"%s\"\n", logFileName.c_str());
+		return false;
+	}
+	logStream << ToJsonLine() << "\n";
+	return true;
+}
+
+//------------------------------------------------------------
+// Compare results to last matching baseline entry
+//------------------------------------------------------------
+/*
+* @margin allowed relative drop in throughput (or growth in memory)
+* Returns false and warns if any metric falls past the margin
+*/
+bool PerformanceLog::CompareToBaseline(const std::string &baselineFileName,
+	const Real margin) const {
+	std::ifstream baseStream(baselineFileName);
+	if (!baseStream.is_open()) {
+		MessageInterface::ShowMessage("*** WARNING *** VRInterface: Cannot open "
+			"performance baseline \"%s\"\n", baselineFileName.c_str());
+		return true;
+	}
+
+	std::string line, baseline;
+	while (std::getline(baseStream, line)) {
+		if (MatchesConfiguration(line))
+			baseline = line;
+	}
+	if (baseline == "") {
+		MessageInterface::ShowMessage("VRInterface: No performance baseline "
+			"for %d objects, %lu samples, attitude=%d, frameConversion=%d\n",
+			mObjectCount, (unsigned long)mSamples, mExportAttitude, mFrameConversion);
+		return true;
+	}
+
+	std::string current = ToJsonLine();
+	const char *higherIsBetter[] = { "ingestRate", "exportRate" };
+	const char *lowerIsBetter[] = { "bufferBytesPerSample", "peakResidentBytes" };
+	bool passed = true;
+	Real base, now;
+
+	for (int i = 0; i < 2; i++) {
+		if (FindValue(baseline, higherIsBetter[i], base) &&
+			FindValue(current, higherIsBetter[i], now) &&
+			base > 0.0 && now < base * (1.0 - margin)) {
+			MessageInterface::ShowMessage("*** WARNING *** VRInterface: %s "
+				"regressed from %.6g to %.6g\n", higherIsBetter[i], base, now);
+			passed = false;
+		}
+	}
+	for (int i = 0; i < 2; i++) {
+		if (FindValue(baseline, lowerIsBetter[i], base) &&
+			FindValue(current, lowerIsBetter[i], now) &&
+			base > 0.0 && now > base * (1.0 + margin)) {
+			MessageInterface::ShowMessage("*** WARNING *** VRInterface: %s "
+				"regressed from %.6g to %.6g\n", lowerIsBetter[i], base, now);
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+//------------------------------------------------------------
+// Protected methods
+//------------------------------------------------------------
+std::string PerformanceLog::ToJsonLine() const {
+	// samples are counted per object, as objects may be sampled at
+	// different rates
+	Real storedSamples = (Real)mSamples;
+
+	std::ostringstream json;
+	json << std::setprecision(10);
+	json << "{\"objects\":" << mObjectCount
+		<< ",\"attitude\":" << (mExportAttitude ? 1 : 0)
+		<< ",\"frameConversion\":" << (mFrameConversion ? 1 : 0)
+		<< ",\"ingestCalls\":" << mIngestCalls
+		<< ",\"stepsKept\":" << mSamplesKept
+		<< ",\"samples\":" << mSamples
+		<< ",\"ingestSeconds\":" << mIngestSeconds
+		<< ",\"ingestRate\":" << (mIngestSeconds > 0.0 ? storedSamples / mIngestSeconds : 0.0)
+		<< ",\"exportSeconds\":" << mExportSeconds
+		<< ",\"exportBytes\":" << mBytesWritten
+		<< ",\"exportRate\":" << (mExportSeconds > 0.0 ? mBytesWritten / mExportSeconds : 0.0)
+		<< ",\"bufferBytes\":" << mBufferBytes
+		<< ",\"bufferBytesPerSample\":" << (storedSamples > 0.0 ? mBufferBytes / storedSamples : 0.0)
+		<< ",\"peakResidentBytes\":" << PeakResidentBytes()
+		<< "}";
+	return json.str();
+}
+
+/*
+* Runs are comparable when they store as many samples of as many objects,
+* with the same export options
+*/
+bool PerformanceLog::MatchesConfiguration(const std::string &jsonLine) const {
+	Real objects, samples, attitude, conversion;
+	return FindValue(jsonLine, "objects", objects) && (Integer)objects == mObjectCount &&
+		FindValue(jsonLine, "samples", samples) && (size_t)samples == mSamples &&
+		FindValue(jsonLine, "attitude", attitude) && (attitude != 0.0) == mExportAttitude &&
+		FindValue(jsonLine, "frameConversion", conversion) && (conversion != 0.0) == mFrameConversion;
+}
+
+bool PerformanceLog::FindValue(const std::string &jsonLine, const std::string &key,
+	Real &value) {
+	size_t pos = jsonLine.find("\"" + key + "\":");
+	if (pos == std::string::npos)
+		return false;
+	std::istringstream valueStream(jsonLine.substr(pos + key.size() + 3));
+	return (bool)(valueStream >> value);
+}
+
+size_t PerformanceLog::PeakResidentBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+	#ifdef __APPLE__
+		return (size_t)usage.ru_maxrss;			// bytes on macOS
+	#else
+		return (size_t)usage.ru_maxrss * 1024;	// kilobytes on Linux
+	#endif
+	}
+#endif
+	return 0;
+}
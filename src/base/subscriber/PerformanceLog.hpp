@@ -0,0 +1,64 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  PerformanceLog
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares PerformanceLog class, which times the ingest and export paths of a
+// VRInterface run and records the results as one JSON line per run
+
+#ifndef PerformanceLog_hpp
+#define PerformanceLog_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <chrono>
+
+class VRInterface_API PerformanceLog
+{
+public:
+	PerformanceLog();
+	virtual ~PerformanceLog();
+
+	PerformanceLog(const PerformanceLog &source);
+	PerformanceLog& operator=(const PerformanceLog &rhs);
+
+	void Reset();
+
+	void StartIngest();
+	void StopIngest(bool sampleKept);
+	void StartExport();
+	void StopExport(const size_t bytesWritten);
+
+	void SetConfiguration(const Integer objectCount, const bool exportAttitude,
+		const bool frameConversion);
+	void SetBufferUsage(const size_t samples, const size_t bufferBytes);
+
+	bool Write(const std::string &logFileName) const;
+	bool CompareToBaseline(const std::string &baselineFileName,
+		const Real margin) const;
+
+protected:
+	std::string ToJsonLine() const;
+	bool MatchesConfiguration(const std::string &jsonLine) const;
+	static bool FindValue(const std::string &jsonLine, const std::string &key,
+		Real &value);
+	static size_t PeakResidentBytes();
+
+	std::chrono::steady_clock::time_point mIngestStart;
+	std::chrono::steady_clock::time_point mExportStart;
+
+	Real mIngestSeconds;		// time spent in DataControl
+	Real mExportSeconds;		// time spent in WriteToJson
+	Integer mIngestCalls;
+	Integer mSamplesKept;
+	size_t mBytesWritten;
+	size_t mSamples;
+	size_t mBufferBytes;
+
+	Integer mObjectCount;
+	bool mExportAttitude;
+	bool mFrameConversion;
+};
+
+#endif
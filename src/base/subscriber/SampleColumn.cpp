@@ -0,0 +1,596 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SampleColumn
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements SampleColumn class
+
+#include "SampleColumn.hpp"
+#include "MessageInterface.hpp"
+
+#include <algorithm>		// for min(), upper_bound(), is_sorted()
+#include <atomic>
+#include <cmath>			// for fabs()
+#include <cstdlib>		// for malloc(), realloc()
+#include <cstring>		// for memcpy()
+#include <new>			// for bad_alloc
+#include <sstream>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <process.h>		// for _getpid()
+	#define getpid _getpid
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+
+// scratch files are named after the process and a running number
+static std::atomic<size_t> spillFileCount(0);
+static std::atomic<bool> spillWarningShown(false);
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+SampleColumn::SampleColumn() {
+	mData = NULL;
+	mSize = 0;
+	mCapacity = 0;
+	mSealedCount = 0;
+	mCompressed = false;
+	mSingle = false;
+	mMode = NULL;
+}
+
+SampleColumn::ModeState::ModeState() :
+	decodedBlock((size_t)-1),
+	originRange(0.0),
+	maxError(0.0),
+	originCursor(0) {
+}
+
+//------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------
+SampleColumn::~SampleColumn() {
+	Release();
+	delete mMode;
+}
+
+//------------------------------------------------------------
+// Copy constructor
+//------------------------------------------------------------
+/*
+* Copies are always made in memory; only the original owns a scratch file
+*/
+SampleColumn::SampleColumn(const SampleColumn &sc) {
+	mData = NULL;
+	mSize = 0;
+	mCapacity = 0;
+	mSealedCount = 0;
+	mCompressed = false;
+	mSingle = false;
+	mMode = NULL;
+	operator=(sc);
+}
+
+//------------------------------------------------------------
+// Assignment Operator
+//------------------------------------------------------------
+SampleColumn& SampleColumn::operator=(const SampleColumn &sc) {
+	if (this == &sc)
+		return *this;
+
+	Release();
+	delete mMode;
+	mMode = NULL;
+	mCompressed = sc.mCompressed;
+	mSealedCount = sc.mSealedCount;
+	mSingle = sc.mSingle;
+	if (sc.mMode != NULL) {
+		ModeState &mode = Mode();
+		mode.spillDirectory = sc.mMode->spillDirectory;
+		mode.sealed = sc.mMode->sealed;
+		mode.blockOffset = sc.mMode->blockOffset;
+		mode.originRange = sc.mMode->originRange;
+		mode.floats = sc.mMode->floats;
+		mode.origin = sc.mMode->origin;
+		mode.originStart = sc.mMode->originStart;
+		mode.maxError = sc.mMode->maxError;
+	}
+	if (sc.mSize > 0 && !sc.mSingle) {
+		Grow(sc.mSize);
+		std::memcpy(mData, sc.mData, sc.mSize * sizeof(Real));
+	}
+	mSize = sc.mSize;
+	if (mSingle)
+		mCapacity = mMode->floats.capacity();
+
+	return *this;
+}
+
+//------------------------------------------------------------
+// Move constructor and assignment
+//------------------------------------------------------------
+/*
+* Lets a SampleColumnArray grow without copying the samples
+*/
+SampleColumn::SampleColumn(SampleColumn &&sc) noexcept
+	: mData(sc.mData), mSize(sc.mSize), mCapacity(sc.mCapacity),
+	mSealedCount(sc.mSealedCount), mCompressed(sc.mCompressed),
+	mSingle(sc.mSingle), mMode(sc.mMode) {
+	// the source is left a plain, empty column
+	sc.mData = NULL;
+	sc.mSize = 0;
+	sc.mCapacity = 0;
+	sc.mSealedCount = 0;
+	sc.mCompressed = false;
+	sc.mSingle = false;
+	sc.mMode = NULL;
+}
+
+SampleColumn& SampleColumn::operator=(SampleColumn &&sc) noexcept {
+	if (this == &sc)
+		return *this;
+
+	Release();
+	delete mMode;
+	mData = sc.mData;
+	mSize = sc.mSize;
+	mCapacity = sc.mCapacity;
+	mSealedCount = sc.mSealedCount;
+	mCompressed = sc.mCompressed;
+	mSingle = sc.mSingle;
+	mMode = sc.mMode;
+
+	sc.mData = NULL;
+	sc.mSize = 0;
+	sc.mCapacity = 0;
+	sc.mSealedCount = 0;
+	sc.mCompressed = false;
+	sc.mSingle = false;
+	sc.mMode = NULL;
+
+	return *this;
+}
+
+//------------------------------------------------------------
+// Spill settings
+//------------------------------------------------------------
+/*
+* @directory scratch directory for the mapped file. The column moves there
+* once it outgrows SPILL_EXTENT, so short columns never touch the disk.
+*/
+void SampleColumn::SetSpillDirectory(const std::string &directory) {
+	if (directory != "" || mMode != NULL)
+		Mode().spillDirectory = directory;
+}
+
+bool SampleColumn::IsSpilled() const {
+	return mMode != NULL && mMode->fileName != "";
+}
+
+/*
+* Hint to read ahead, as the writer goes through each column once
+*/
+void SampleColumn::AdviseSequential() const {
+#ifndef _WIN32
+	if (IsSpilled() && mData != NULL)
+		madvise(mData, mCapacity * sizeof(Real), MADV_SEQUENTIAL);
+#endif
+}
+
+/*
+* Only for an empty column, e.g. straight after BuildDynamicBuffers
+*/
+void SampleColumn::SetCompressed(const bool compressed) {
+	if (empty()) {
+		mCompressed = compressed;
+		if (compressed)
+			Mode();
+	}
+}
+
+/*
+* Only for an empty column. With an origin range R, the rounding error of a
+* sample is at most half a float32 ulp at R, i.e. below R * 2^-24.
+*/
+void SampleColumn::SetSinglePrecision(const bool single, const Real originRange) {
+	if (empty()) {
+		mSingle = single;
+		if (single || mMode != NULL)
+			Mode().originRange = originRange;
+	}
+}
+
+//------------------------------------------------------------
+// Size management
+//------------------------------------------------------------
+/*
+* Compressed columns only ever hold one open block uncompressed
+*/
+void SampleColumn::reserve(const size_t count) {
+	if (mSingle) {
+		mMode->floats.reserve(count);
+		mCapacity = mMode->floats.capacity();
+		return;
+	}
+	size_t open = mCompressed ? std::min(count, ColumnCodec::BLOCK_SIZE) : count;
+	if (open > mCapacity)
+		Grow(open);
+}
+
+/*
+* Drops the samples but keeps the storage, as RealArray::clear() does
+*/
+void SampleColumn::clear() {
+	mSize = 0;
+	mSealedCount = 0;
+	if (mMode == NULL)
+		return;
+	mMode->sealed.clear();
+	mMode->blockOffset.clear();
+	mMode->decodedBlock = (size_t)-1;
+	mMode->floats.clear();
+	mMode->origin.clear();
+	mMode->originStart.clear();
+	mMode->maxError = 0.0;
+	mMode->originCursor = 0;
+}
+
+/*
+* @keep indices of the samples to retain, in their new order. A compressed
+* column is decoded and sealed again, which only happens when the column is
+* halved or reordered.
+*/
+void SampleColumn::Compact(const std::vector<size_t> &keep) {
+	// ascending indices are compacted in place; any other order is
+	// gathered into a copy first, as a sample may be read after its slot
+	// has been overwritten
+	bool ascending = std::is_sorted(keep.begin(), keep.end());
+
+	if (mSingle) {
+		// samples keep their float and origin, so nothing is rounded twice
+		ModeState &mode = *mMode;
+		std::vector<float> floats;
+		if (!ascending)
+			floats.resize(keep.size());
+		RealArray origin;
+		std::vector<size_t> originStart;
+		size_t run = 0;
+		for (size_t k = 0; k < keep.size(); k++) {
+			// a sample outside the run of the last one, as in a reordering,
+			// searches for its run
+			if (keep[k] < mode.originStart[run] ||
+				(run + 1 < mode.originStart.size() && mode.originStart[run + 1] <= keep[k]))
+				run = std::upper_bound(mode.originStart.begin(), mode.originStart.end(),
+					keep[k]) - mode.originStart.begin() - 1;
+			if (origin.empty() || mode.origin[run] != origin.back()) {
+				origin.push_back(mode.origin[run]);
+				originStart.push_back(k);
+			}
+			if (ascending)
+				mode.floats[k] = mode.floats[keep[k]];
+			else
+				floats[k] = mode.floats[keep[k]];
+		}
+		if (ascending)
+			mode.floats.resize(keep.size());
+		else
+			mode.floats.swap(floats);
+		mode.origin.swap(origin);
+		mode.originStart.swap(originStart);
+		mSize = keep.size();
+		mode.originCursor = 0;
+		return;
+	}
+
+	if (!mCompressed && ascending) {
+		for (size_t k = 0; k < keep.size(); k++)
+			mData[k] = mData[keep[k]];
+		mSize = keep.size();
+		return;
+	}
+
+	RealArray kept(keep.size());
+	for (size_t k = 0; k < keep.size(); k++)
+		kept[k] = operator[](keep[k]);
+
+	if (!mCompressed) {
+		std::copy(kept.begin(), kept.end(), mData);
+		mSize = kept.size();
+		return;
+	}
+
+	clear();
+	for (size_t k = 0; k < kept.size(); k++)
+		push_back(kept[k]);
+}
+
+//------------------------------------------------------------
+// Search and statistics
+//------------------------------------------------------------
+size_t SampleColumn::LowerBound(const Real value) const {
+	size_t first = 0, count = size();
+	while (count > 0) {
+		size_t step = count / 2;
+		if (operator[](first + step) < value) {
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+	return first;
+}
+
+size_t SampleColumn::UpperBound(const Real value) const {
+	size_t first = 0, count = size();
+	while (count > 0) {
+		size_t step = count / 2;
+		if (!(value < operator[](first + step))) {
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+	return first;
+}
+
+/*
+* Memory used, counting mapped columns at their full file size
+*/
+size_t SampleColumn::GetBytes() const {
+	if (mMode == NULL)
+		return mCapacity * sizeof(Real);
+	if (mSingle)
+		return mMode->floats.capacity() * sizeof(float) +
+			mMode->origin.capacity() * sizeof(Real) +
+			mMode->originStart.capacity() * sizeof(size_t);
+	return mCapacity * sizeof(Real) + mMode->sealed.capacity() +
+		mMode->blockOffset.capacity() * sizeof(size_t) +
+		mMode->decoded.capacity() * sizeof(Real);
+}
+
+//------------------------------------------------------------
+// Protected methods
+//------------------------------------------------------------
+
+/*
+* Doubles the storage as a RealArray would. Mapped files grow in extents of
+* at most MAX_EXTENT, so a long column does not reserve twice its size.
+*/
+void SampleColumn::Grow(const size_t minCapacity) {
+	size_t newCapacity = mCapacity > 0 ? mCapacity * 2 : 16;
+	size_t maxStep = MAX_EXTENT / sizeof(Real);
+	if (IsSpilled() && newCapacity - mCapacity > maxStep)
+		newCapacity = mCapacity + maxStep;
+	if (newCapacity < minCapacity)
+		newCapacity = minCapacity;
+
+	if (mMode != NULL && mMode->spillDirectory != "" && !mCompressed &&
+		newCapacity * sizeof(Real) >= SPILL_EXTENT) {
+		if (MapFile(newCapacity))
+			return;
+		// no usable scratch file, carry on in memory
+		mMode->spillDirectory = "";
+	}
+
+	Real *data;
+	if (IsSpilled()) {
+		data = (Real*)std::malloc(newCapacity * sizeof(Real));
+		if (data != NULL) {
+			if (mSize > 0)
+				std::memcpy(data, mData, mSize * sizeof(Real));
+			UnmapFile();
+		}
+	}
+	else
+		data = (Real*)std::realloc(mData, newCapacity * sizeof(Real));
+
+	if (data == NULL)
+		throw std::bad_alloc();
+	mData = data;
+	mCapacity = newCapacity;
+}
+
+/*
+* Maps the column onto its scratch file, enlarging the file to
+* newCapacity samples. On the first call the samples held in memory are
+* copied over. Returns false if the file cannot be created or mapped.
+*/
+bool SampleColumn::MapFile(const size_t newCapacity) {
+	bool firstMap = !IsSpilled();
+	std::string fileName = mMode->fileName;
+	if (firstMap) {
+		std::ostringstream name;
+		name << mMode->spillDirectory << "/VRInterface_" << getpid() << "_"
+			<< spillFileCount++ << ".bin";
+		fileName = name.str();
+	}
+	size_t bytes = newCapacity * sizeof(Real);
+	void *mapped = NULL;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL);
+	if (file != INVALID_HANDLE_VALUE) {
+		// the mapping enlarges the file to its size
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+			(DWORD)((unsigned long long)bytes >> 32), (DWORD)(bytes & 0xFFFFFFFF), NULL);
+		if (mapping != NULL) {
+			mapped = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+	}
+#else
+	int fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0600);
+	if (fd != -1) {
+		if (ftruncate(fd, (off_t)bytes) == 0) {
+			mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (mapped == MAP_FAILED)
+				mapped = NULL;
+		}
+		close(fd);
+	}
+#endif
+
+	if (mapped == NULL) {
+		if (!spillWarningShown.exchange(true))
+			MessageInterface::ShowMessage("*** WARNING *** VRInterface: Cannot map "
+				"scratch file \"%s\", buffering in memory instead\n", fileName.c_str());
+		if (firstMap) {
+#ifdef _WIN32
+			DeleteFileA(fileName.c_str());
+#else
+			unlink(fileName.c_str());
+#endif
+		}
+		return false;
+	}
+
+	// the old and new views share the file, so only the first map copies
+	if (firstMap) {
+		if (mSize > 0)
+			std::memcpy(mapped, mData, mSize * sizeof(Real));
+		std::free(mData);
+	}
+	else {
+#ifdef _WIN32
+		UnmapViewOfFile(mData);
+#else
+		munmap(mData, mCapacity * sizeof(Real));
+#endif
+	}
+
+	mData = (Real*)mapped;
+	mCapacity = newCapacity;
+	mMode->fileName = fileName;
+	return true;
+}
+
+/*
+* Encodes the full open block and starts a new one
+*/
+void SampleColumn::SealBlock() {
+	mMode->blockOffset.push_back(mMode->sealed.size());
+	ColumnCodec::EncodeBlock(mData, mSize, mMode->sealed);
+	mSealedCount += mSize;
+	mSize = 0;
+}
+
+/*
+* Reads a sample from a sealed block, decoding the block if it is not the
+* one decoded last
+*/
+Real SampleColumn::SealedValue(const size_t index) const {
+	ModeState &mode = *mMode;
+	size_t block = index / ColumnCodec::BLOCK_SIZE;
+	if (block != mode.decodedBlock) {
+		mode.decoded.resize(ColumnCodec::BLOCK_SIZE);
+		ColumnCodec::DecodeBlock(&mode.sealed[mode.blockOffset[block]],
+			ColumnCodec::BLOCK_SIZE, &mode.decoded[0]);
+		mode.decodedBlock = block;
+	}
+	return mode.decoded[index % ColumnCodec::BLOCK_SIZE];
+}
+
+/*
+* Stores a value as float32, starting a new origin when the offset from the
+* current one would leave the origin range
+*/
+void SampleColumn::PushSingle(const Real value) {
+	ModeState &mode = *mMode;
+	if (mode.originRange > 0.0 &&
+		(mode.origin.empty() || std::fabs(value - mode.origin.back()) > mode.originRange)) {
+		mode.origin.push_back(value);
+		mode.originStart.push_back(mSize);
+	}
+	else if (mode.origin.empty()) {
+		mode.origin.push_back(0.0);
+		mode.originStart.push_back(0);
+	}
+
+	float offset = (float)(value - mode.origin.back());
+	mode.floats.push_back(offset);
+	mCapacity = mode.floats.capacity();
+	mSize++;
+
+	Real error = std::fabs(mode.origin.back() + (Real)offset - value);
+	if (error > mode.maxError)
+		mode.maxError = error;
+}
+
+/*
+* Reads a float32 sample back, tracking the origin run of the last read so
+* that sequential reads need no search
+*/
+Real SampleColumn::SingleValue(const size_t index) const {
+	ModeState &mode = *mMode;
+	size_t run = mode.originCursor;
+	if (run >= mode.originStart.size() || mode.originStart[run] > index ||
+		(run + 1 < mode.originStart.size() && mode.originStart[run + 1] <= index)) {
+		run = std::upper_bound(mode.originStart.begin(), mode.originStart.end(), index) -
+			mode.originStart.begin() - 1;
+		mode.originCursor = run;
+	}
+	return mode.origin[run] + (Real)mode.floats[index];
+}
+
+/*
+* Unmaps and deletes the scratch file
+*/
+void SampleColumn::UnmapFile() {
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+	DeleteFileA(mMode->fileName.c_str());
+#else
+	munmap(mData, mCapacity * sizeof(Real));
+	unlink(mMode->fileName.c_str());
+#endif
+	mMode->fileName.clear();
+	mData = NULL;
+}
+
+/*
+* Frees the storage and deletes the scratch file, if any
+*/
+void SampleColumn::Release() {
+	if (IsSpilled())
+		UnmapFile();
+	else
+		std::free(mData);
+
+	mData = NULL;
+	mSize = 0;
+	mCapacity = 0;
+	mSealedCount = 0;
+	if (mMode == NULL)
+		return;
+	std::vector<unsigned char>().swap(mMode->sealed);
+	std::vector<size_t>().swap(mMode->blockOffset);
+	RealArray().swap(mMode->decoded);
+	mMode->decodedBlock = (size_t)-1;
+	std::vector<float>().swap(mMode->floats);
+	RealArray().swap(mMode->origin);
+	std::vector<size_t>().swap(mMode->originStart);
+	mMode->maxError = 0.0;
+	mMode->originCursor = 0;
+}
+
+/*
+* The mode state, made on first use
+*/
+SampleColumn::ModeState& SampleColumn::Mode() {
+	if (mMode == NULL)
+		mMode = new ModeState();
+	return *mMode;
+}
@@ -0,0 +1,144 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SampleColumn
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares SampleColumn class, a growable array of Real used for one buffered
+// channel of one object. It behaves like a RealArray, but once a spill
+// directory is set and the column outgrows its first extent, the samples are
+// moved to a memory-mapped scratch file. Resident memory is then bounded by
+// the OS page cache rather than by mission length. A compressed column
+// instead seals every ColumnCodec::BLOCK_SIZE samples into a lossless
+// encoded block, and decodes blocks again as they are read. A single
+// precision column stores float32 values, optionally as offsets from a
+// double precision origin that is renewed whenever the offset would exceed
+// a set range. That bounds the rounding error however far the object goes.
+
+#ifndef SampleColumn_hpp
+#define SampleColumn_hpp
+
+#include "VRInterfaceDefs.hpp"
+#include "ColumnCodec.hpp"
+
+#include <vector>
+
+class VRInterface_API SampleColumn
+{
+public:
+	SampleColumn();
+	virtual ~SampleColumn();
+
+	SampleColumn(const SampleColumn &source);
+	SampleColumn& operator=(const SampleColumn &rhs);
+	SampleColumn(SampleColumn &&source) noexcept;
+	SampleColumn& operator=(SampleColumn &&rhs) noexcept;
+
+	// "" keeps the column in memory
+	void SetSpillDirectory(const std::string &directory);
+	bool IsSpilled() const;
+	void AdviseSequential() const;
+
+	// compressed columns keep sealed blocks in memory and never spill
+	void SetCompressed(const bool compressed);
+	bool IsCompressed() const { return mCompressed; }
+
+	// float32 storage, which overrides compression and spilling.
+	// @originRange largest offset from an origin, 0 for plain float32
+	void SetSinglePrecision(const bool single, const Real originRange = 0.0);
+	bool IsSinglePrecision() const { return mSingle; }
+	// largest rounding error of any sample pushed so far
+	Real GetMaxError() const { return mMode != NULL ? mMode->maxError : 0.0; }
+
+	// RealArray-style access, so the column can replace one in place.
+	// Samples are read by value; use push_back() and Compact() to change them.
+	size_t size() const { return mSealedCount + mSize; }
+	bool empty() const { return size() == 0; }
+	size_t capacity() const { return mSealedCount + mCapacity; }
+
+	Real operator[](const size_t index) const {
+		if (mSingle)
+			return SingleValue(index);
+		return index < mSealedCount ? SealedValue(index) : mData[index - mSealedCount];
+	}
+	Real back() const { return operator[](size() - 1); }
+
+	void push_back(const Real value) {
+		if (mSingle) {
+			PushSingle(value);
+			return;
+		}
+		if (mSize == mCapacity)
+			Grow(mSize + 1);
+		mData[mSize++] = value;
+		if (mCompressed && mSize == ColumnCodec::BLOCK_SIZE)
+			SealBlock();
+	}
+	void reserve(const size_t count);
+	void clear();
+	// frees the storage and any scratch file; the storage mode is kept
+	void Release();
+
+	// keeps only the samples at the given indices, in that order
+	void Compact(const std::vector<size_t> &keep);
+
+	// binary search on a sorted column, as std::lower_bound/upper_bound
+	size_t LowerBound(const Real value) const;
+	size_t UpperBound(const Real value) const;
+
+	// memory held by the column, including spare capacity
+	size_t GetBytes() const;
+
+protected:
+	void Grow(const size_t minCapacity);
+	bool MapFile(const size_t newCapacity);
+	void UnmapFile();
+	void SealBlock();
+	Real SealedValue(const size_t index) const;
+	void PushSingle(const Real value);
+	Real SingleValue(const size_t index) const;
+
+	// state of the spilled, compressed and single precision columns,
+	// made when a column is first set to one of them
+	struct ModeState
+	{
+		ModeState();
+
+		std::string spillDirectory;	// "" for memory only
+		std::string fileName;			// scratch file, "" while in memory
+
+		std::vector<unsigned char> sealed;	// encoded blocks, back to back
+		std::vector<size_t> blockOffset;		// start of each block in sealed
+		// last decoded block, so sequential reads decode each block once
+		RealArray decoded;
+		size_t decodedBlock;
+
+		Real originRange;						// 0 for plain float32
+		std::vector<float> floats;			// value - origin, per sample
+		RealArray origin;						// one per run of samples
+		std::vector<size_t> originStart;	// first sample of each run
+		Real maxError;
+		size_t originCursor;					// run of the last sample read
+	};
+
+	ModeState& Mode();
+
+	// every row pushes to eleven columns of every object, so a plain
+	// column holds only what a push reads, and stays in cache
+	Real *mData;			// whole column, or the open block when compressed
+	size_t mSize;
+	size_t mCapacity;
+	size_t mSealedCount;	// samples in sealed blocks
+	bool mCompressed;
+	bool mSingle;
+	ModeState *mMode;		// NULL for a plain column
+
+	// bytes kept in memory before a column spills, and the largest step
+	// a mapped file grows by
+	static const size_t SPILL_EXTENT = 1 << 20;
+	static const size_t MAX_EXTENT = 64 << 20;
+};
+
+typedef std::vector<SampleColumn> SampleColumnArray;
+
+#endif
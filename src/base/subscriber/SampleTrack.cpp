@@ -0,0 +1,226 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SampleTrack
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements SampleTrack class
+
+#include "SampleTrack.hpp"
+
+#include <algorithm>
+
+std::map<std::string, std::weak_ptr<SampleTrack> > SampleTrack::repository;
+std::mutex SampleTrack::repositoryMutex;
+
+// bound by reference in std::min(), so it needs a definition
+const Integer SampleTrack::MAX_LEVEL;
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+SampleTrack::SampleTrack() :
+	level(0),
+	anchorLimit(0),
+	inOrder(true),
+	mBufferedBy(NULL),
+	mExportsPending(0),
+	mLastCount(0) {
+}
+
+//------------------------------------------------------------
+// Join a track
+//------------------------------------------------------------
+/*
+* @key object name and the settings that decide which of its samples are
+* stored, and how
+* @member the exporter joining, active; the first active member buffers
+* the track
+* @created set true if the track is new and still needs its storage modes
+*/
+std::shared_ptr<SampleTrack> SampleTrack::Acquire(const std::string &key,
+	const void *member, bool &created) {
+	std::shared_ptr<SampleTrack> track;
+	std::lock_guard<std::mutex> lock(repositoryMutex);
+
+	if (key != "") {
+		std::map<std::string, std::weak_ptr<SampleTrack> >::iterator found =
+			repository.find(key);
+		if (found != repository.end())
+			track = found->second.lock();
+	}
+
+	created = !track;
+	if (created) {
+		track = std::make_shared<SampleTrack>();
+		track->mKey = key;
+		if (key != "")
+			repository[key] = track;
+	}
+
+	std::lock_guard<std::mutex> trackLock(track->mutex);
+	track->mMembers.push_back(member);
+	track->mActive.push_back(true);
+	track->ChooseBuffering();
+	return track;
+}
+
+//------------------------------------------------------------
+// Leave a track
+//------------------------------------------------------------
+void SampleTrack::Leave(const std::shared_ptr<SampleTrack> &track,
+	const void *member) {
+	if (!track)
+		return;
+
+	std::lock_guard<std::mutex> lock(repositoryMutex);
+	std::lock_guard<std::mutex> trackLock(track->mutex);
+	std::vector<const void*>::iterator found =
+		std::find(track->mMembers.begin(), track->mMembers.end(), member);
+	if (found == track->mMembers.end())
+		return;
+
+	track->mActive.erase(track->mActive.begin() +
+		(found - track->mMembers.begin()));
+	track->mMembers.erase(found);
+	track->ChooseBuffering();
+	if (track->mExportsPending > track->mMembers.size())
+		track->mExportsPending = track->mMembers.size();
+
+	if (track->mMembers.empty() && track->mKey != "")
+		repository.erase(track->mKey);
+}
+
+//------------------------------------------------------------
+// Whether a member buffers the track
+//------------------------------------------------------------
+/*
+* Read on every published row, so it does not lock the track
+*/
+bool SampleTrack::IsBufferedBy(const void *member) const {
+	return member != NULL && mBufferedBy.load() == member;
+}
+
+//------------------------------------------------------------
+// Turn a member on or off
+//------------------------------------------------------------
+/*
+* Called as the member is toggled, before its next row, so that a row
+* published after the change is buffered by whoever buffers from then on
+*/
+void SampleTrack::SetActive(const void *member, const bool active) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t k = 0; k < mMembers.size(); k++) {
+		if (mMembers[k] == member)
+			mActive[k] = active;
+	}
+	ChooseBuffering();
+}
+
+//------------------------------------------------------------
+// Pick the member that buffers
+//------------------------------------------------------------
+/*
+* The first active member in join order. While none is active, the last
+* one to buffer keeps the track, so that its export still counts it.
+* Called with the track locked.
+*/
+void SampleTrack::ChooseBuffering() {
+	for (size_t k = 0; k < mMembers.size(); k++) {
+		if (mActive[k]) {
+			mBufferedBy = mMembers[k];
+			return;
+		}
+	}
+	if (std::find(mMembers.begin(), mMembers.end(), mBufferedBy.load()) ==
+		mMembers.end())
+		mBufferedBy = mMembers.empty() ? (const void*)NULL : mMembers.front();
+}
+
+//------------------------------------------------------------
+// Channel by index
+//------------------------------------------------------------
+SampleColumn& SampleTrack::Channel(const size_t c) {
+	SampleColumn *channels[CHANNEL_COUNT] = {
+		&posX, &posY, &posZ, &velX, &velY, &velZ,
+		&q1, &q2, &q3, &q4, &time };
+	return *channels[c];
+}
+
+const SampleColumn& SampleTrack::Channel(const size_t c) const {
+	return const_cast<SampleTrack*>(this)->Channel(c);
+}
+
+//------------------------------------------------------------
+// Start of a run
+//------------------------------------------------------------
+/*
+* Called by every member as it initialises; all but the first find the
+* track already empty. The memory of the last run is kept.
+*/
+void SampleTrack::Reset() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+		Channel(c).clear();
+		Channel(c).reserve(mLastCount);
+	}
+	anchor.clear();
+	anchor.reserve(mLastCount);
+	resumed.clear();
+	resumed.reserve(mLastCount);
+	level = 0;
+	anchorLimit = 0;
+	inOrder = true;
+	mExportsPending = mMembers.size();
+}
+
+//------------------------------------------------------------
+// End of one member's export
+//------------------------------------------------------------
+/*
+* The last member to export empties the track. Spilled columns are
+* released, so that no scratch file outlives the run.
+*/
+void SampleTrack::ExportDone() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (mExportsPending > 1) {
+		mExportsPending--;
+		return;
+	}
+	mExportsPending = 0;
+
+	mLastCount = time.size();
+	for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+		if (Channel(c).IsSpilled())
+			Channel(c).Release();
+		else
+			Channel(c).clear();
+	}
+	anchor.clear();
+	resumed.clear();
+	level = 0;
+	anchorLimit = 0;
+	inOrder = true;
+}
+
+//------------------------------------------------------------
+// Memory held by the track
+//------------------------------------------------------------
+size_t SampleTrack::GetBytes() const {
+	size_t bytes = (anchor.capacity() + resumed.capacity()) / 8;
+	for (size_t c = 0; c < CHANNEL_COUNT; c++)
+		bytes += Channel(c).GetBytes();
+	return bytes;
+}
+
+//------------------------------------------------------------
+// Point budget
+//------------------------------------------------------------
+/*
+* @maxData point budget per object; the track may hold more once its
+* anchors alone fill it
+*/
+bool SampleTrack::IsFull(const Integer maxData) const {
+	return (Integer)time.size() >= maxData && time.size() >= anchorLimit;
+}
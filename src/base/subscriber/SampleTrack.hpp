@@ -0,0 +1,101 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SampleTrack
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares SampleTrack class, the buffered samples of one object. Tracks are
+// kept in a repository keyed by object and sampling settings, so that every
+// exporter sampling an object the same way refers to one track. The first
+// active member of a track buffers it; the others only read it at export.
+
+#ifndef SampleTrack_hpp
+#define SampleTrack_hpp
+
+#include "VRInterfaceDefs.hpp"
+#include "SampleColumn.hpp"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+class VRInterface_API SampleTrack
+{
+public:
+	// channel order used by Channel()
+	enum
+	{
+		POS_X, POS_Y, POS_Z,
+		VEL_X, VEL_Y, VEL_Z,
+		ATT_Q1, ATT_Q2, ATT_Q3, ATT_Q4,
+		EPOCH,
+		CHANNEL_COUNT
+	};
+
+	SampleTrack();
+
+	// the track for a key, created on first use, with member added.
+	// An empty key gives a new private track.
+	static std::shared_ptr<SampleTrack> Acquire(const std::string &key,
+		const void *member, bool &created);
+	// removes member; the track is freed with its last reference
+	static void Leave(const std::shared_ptr<SampleTrack> &track,
+		const void *member);
+
+	bool IsBufferedBy(const void *member) const;
+	// a member turned off stops buffering; the next active member takes over
+	void SetActive(const void *member, const bool active);
+
+	SampleColumn& Channel(const size_t c);
+	const SampleColumn& Channel(const size_t c) const;
+
+	// empties the track for a new run, reserving as many samples as last time
+	void Reset();
+	// empties the track once every member has exported it
+	void ExportDone();
+
+	// memory held by the track, including spare capacity
+	size_t GetBytes() const;
+	// true once the track holds as many samples as it may before a halving
+	bool IsFull(const Integer maxData) const;
+
+	SampleColumn posX, posY, posZ;
+	SampleColumn velX, velY, velZ;
+	SampleColumn q1, q2, q3, q4;
+	SampleColumn time;
+
+	// samples that survive every reduction and are flagged in the output
+	BooleanArray anchor;
+	// samples that begin a presence span: the object was missing from the
+	// rows published since the sample before. Always anchors.
+	BooleanArray resumed;
+	// number of halvings applied, at most MAX_LEVEL
+	Integer level;
+	static const Integer MAX_LEVEL = 20;
+	// samples held before the next halving once anchors alone fill the
+	// point budget; 0 while the budget applies
+	size_t anchorLimit;
+	// false once a sample arrived earlier than the one before it
+	bool inOrder;
+
+	// held while the track is read or changed
+	std::mutex mutex;
+
+protected:
+	void ChooseBuffering();
+
+	std::string mKey;
+	std::vector<const void*> mMembers;	// in join order
+	std::vector<bool> mActive;			// [member]
+	std::atomic<const void*> mBufferedBy;
+	size_t mExportsPending;				// members yet to export this run
+	size_t mLastCount;						// samples at last export
+
+	static std::map<std::string, std::weak_ptr<SampleTrack> > repository;
+	static std::mutex repositoryMutex;
+};
+
+typedef std::vector<std::shared_ptr<SampleTrack> > SampleTrackArray;
+
+#endif
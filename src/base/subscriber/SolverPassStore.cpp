@@ -0,0 +1,156 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SolverPassStore
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements SolverPassStore class
+
+#include "SolverPassStore.hpp"
+
+#include <limits>
+#include <utility>		// for move()
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+SolverPassStore::SolverPassStore() :
+	mScCount(0),
+	mPassLimit(0),
+	mPassInterval(1),
+	mPointLimit(0),
+	mPassNumber(0),
+	mCapturing(false) {
+}
+
+//------------------------------------------------------------
+// Capture settings
+//------------------------------------------------------------
+/*
+* Called at initialisation. Passes of the last run stay pooled.
+*/
+void SolverPassStore::Configure(const Integer scCount, const Integer passLimit,
+	const Integer passInterval, const Integer pointLimit) {
+	Clear();
+	mScCount = scCount;
+	mPassLimit = passLimit;
+	mPassInterval = passInterval > 0 ? passInterval : 1;
+	mPointLimit = pointLimit;
+}
+
+//------------------------------------------------------------
+// Start of a pass
+//------------------------------------------------------------
+/*
+* A captured pass takes the oldest kept pass once the limit is reached,
+* else a pooled one, so memory stays bounded by the pass limit.
+*/
+bool SolverPassStore::BeginPass() {
+	mPassNumber++;
+	mCapturing = mPassLimit > 0 && (mPassNumber - 1) % mPassInterval == 0;
+	if (!mCapturing)
+		return false;
+
+	Pass pass;
+	if ((Integer)mPasses.size() >= mPassLimit) {
+		pass = std::move(mPasses.front());
+		mPasses.pop_front();
+	}
+	else if (!mPool.empty()) {
+		pass = std::move(mPool.back());
+		mPool.pop_back();
+	}
+
+	pass.number = mPassNumber;
+	pass.data.resize(mScCount * CHANNEL_COUNT);
+	for (size_t c = 0; c < pass.data.size(); c++)
+		pass.data[c].clear();
+	pass.rows.assign(mScCount, 0);
+	pass.stride.assign(mScCount, 1);
+	mPasses.push_back(std::move(pass));
+	return true;
+}
+
+//------------------------------------------------------------
+// Add a sample to the current pass
+//------------------------------------------------------------
+/*
+* Rows are kept at the spacecraft's stride in the pass, so a long pass is
+* halved once per doubling of its length rather than every few rows.
+*/
+void SolverPassStore::Add(const Integer scIndex, const Real epoch,
+	const Real *state) {
+	if (!mCapturing || scIndex < 0 || scIndex >= mScCount)
+		return;
+
+	Pass &pass = mPasses.back();
+	if (pass.rows[scIndex]++ % pass.stride[scIndex] != 0)
+		return;
+	for (Integer k = 0; k < 6; k++)
+		pass.data[scIndex * CHANNEL_COUNT + k].push_back(state[k]);
+	RealArray &time = pass.data[scIndex * CHANNEL_COUNT + EPOCH];
+	time.push_back(epoch);
+
+	if (mPointLimit > 0 && (Integer)time.size() >= mPointLimit)
+		Halve(pass, scIndex);
+}
+
+//------------------------------------------------------------
+// Halve one spacecraft of a pass
+//------------------------------------------------------------
+/*
+* Keeps every other sample and the last one, and doubles the stride. Passes
+* are only drawn to show convergence, so extremes and anchors are not kept
+* as in the main buffers.
+*/
+void SolverPassStore::Halve(Pass &pass, const Integer scIndex) {
+	if (pass.stride[scIndex] <= std::numeric_limits<Integer>::max() / 2)
+		pass.stride[scIndex] *= 2;
+
+	for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+		RealArray &column = pass.data[scIndex * CHANNEL_COUNT + c];
+		size_t count = column.size();
+		size_t k = 0;
+		for (size_t j = 0; j < count; j += 2)
+			column[k++] = column[j];
+		if (count % 2 == 0)
+			column[k++] = column[count - 1];
+		column.resize(k);
+	}
+}
+
+//------------------------------------------------------------
+// End of a run
+//------------------------------------------------------------
+void SolverPassStore::Clear() {
+	while (!mPasses.empty()) {
+		mPool.push_back(std::move(mPasses.front()));
+		mPasses.pop_front();
+	}
+	mPassNumber = 0;
+	mCapturing = false;
+}
+
+void SolverPassStore::Release() {
+	mPasses.clear();
+	mPool.clear();
+	mPassNumber = 0;
+	mCapturing = false;
+}
+
+//------------------------------------------------------------
+// Memory held by the store
+//------------------------------------------------------------
+size_t SolverPassStore::GetBytes() const {
+	size_t bytes = 0;
+	for (size_t k = 0; k < mPasses.size(); k++) {
+		for (size_t c = 0; c < mPasses[k].data.size(); c++)
+			bytes += mPasses[k].data[c].capacity() * sizeof(Real);
+	}
+	for (size_t k = 0; k < mPool.size(); k++) {
+		for (size_t c = 0; c < mPool[k].data.size(); c++)
+			bytes += mPool[k].data[c].capacity() * sizeof(Real);
+	}
+	return bytes;
+}
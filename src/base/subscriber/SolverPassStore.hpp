@@ -0,0 +1,86 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SolverPassStore
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares SolverPassStore class, the spacecraft trajectories of the solver
+// passes of a run, e.g. each iteration of a Target or Optimize loop. Only the
+// last few passes are kept. A pass that is dropped, or left over from the
+// last run, goes back to a pool and lends its memory to the next pass, so a
+// run of thousands of iterations allocates no more passes than it keeps.
+
+#ifndef SolverPassStore_hpp
+#define SolverPassStore_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <deque>
+#include <vector>
+
+class VRInterface_API SolverPassStore
+{
+public:
+	// channel order within a pass
+	enum
+	{
+		POS_X, POS_Y, POS_Z,
+		VEL_X, VEL_Y, VEL_Z,
+		EPOCH,
+		CHANNEL_COUNT
+	};
+
+	struct Pass
+	{
+		Integer number;				// 1 for the first pass of the run
+		std::vector<RealArray> data;	// [spacecraft * CHANNEL_COUNT + channel]
+		// [spacecraft] rows offered, and rows between samples kept; each
+		// halving doubles the stride, as it doubles a main buffer's interval
+		std::vector<Integer> rows;
+		std::vector<Integer> stride;
+	};
+
+	SolverPassStore();
+
+	// @passLimit passes kept, the oldest dropped first; 0 captures nothing
+	// @passInterval only every Nth pass is captured
+	// @pointLimit samples per spacecraft and pass; a pass reaching it is
+	// halved
+	void Configure(const Integer scCount, const Integer passLimit,
+		const Integer passInterval, const Integer pointLimit);
+
+	// starts the next pass; false if it is not captured
+	bool BeginPass();
+	// @state position and velocity of one spacecraft
+	void Add(const Integer scIndex, const Real epoch, const Real *state);
+
+	// captured passes, oldest first
+	size_t GetPassCount() const { return mPasses.size(); }
+	const Pass& GetPass(const size_t k) const { return mPasses[k]; }
+	const RealArray& Channel(const Pass &pass, const Integer scIndex,
+		const size_t c) const { return pass.data[scIndex * CHANNEL_COUNT + c]; }
+
+	// empties the store for a new run; the passes go back to the pool
+	void Clear();
+	// frees every pass, pooled or not
+	void Release();
+
+	// memory held by the store, including the pool
+	size_t GetBytes() const;
+
+protected:
+	void Halve(Pass &pass, const Integer scIndex);
+
+	Integer mScCount;
+	Integer mPassLimit;
+	Integer mPassInterval;
+	Integer mPointLimit;
+
+	Integer mPassNumber;		// passes begun this run
+	bool mCapturing;			// whether the current pass is kept
+
+	std::deque<Pass> mPasses;
+	std::vector<Pass> mPool;
+};
+
+#endif
@@ -0,0 +1,153 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  TrajectoryBounds
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements TrajectoryBounds class
+
+#include "TrajectoryBounds.hpp"
+
+#include <algorithm>
+#include <iomanip>		// for setprecision()
+#include <limits>
+
+namespace
+{
+	// orders chunks by the centre of their boxes along one axis
+	struct CentreLess
+	{
+		CentreLess(const RealArray &boxes, const size_t axis) :
+			boxes(boxes), axis(axis) {}
+		bool operator()(const size_t a, const size_t b) const {
+			return boxes[6 * a + axis] + boxes[6 * a + 3 + axis] <
+				boxes[6 * b + axis] + boxes[6 * b + 3 + axis];
+		}
+		const RealArray &boxes;
+		size_t axis;
+	};
+}
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+TrajectoryBounds::TrajectoryBounds() :
+	mChunkSize(0) {
+}
+
+//------------------------------------------------------------
+// Build the chunk boxes and the hierarchy
+//------------------------------------------------------------
+void TrajectoryBounds::Build(const RealArray &position, const size_t chunkSize) {
+	mChunkSize = chunkSize > 0 ? chunkSize : 1;
+	mChunkBox.clear();
+	mNodeBox.clear();
+	mNodeLink.clear();
+
+	size_t count = position.size() / 3;
+	if (count == 0)
+		return;
+
+	size_t chunkCount = count > 1 ? (count - 2) / mChunkSize + 1 : 1;
+	mChunkBox.resize(6 * chunkCount);
+	for (size_t k = 0; k < chunkCount; k++) {
+		Real *box = &mChunkBox[6 * k];
+		size_t first = k * mChunkSize;
+		size_t last = std::min(first + mChunkSize, count - 1);
+		for (size_t c = 0; c < 3; c++) {
+			box[c] = box[3 + c] = position[3 * first + c];
+			for (size_t j = first + 1; j <= last; j++) {
+				box[c] = std::min(box[c], position[3 * j + c]);
+				box[3 + c] = std::max(box[3 + c], position[3 * j + c]);
+			}
+		}
+	}
+
+	std::vector<size_t> order(chunkCount);
+	for (size_t k = 0; k < chunkCount; k++)
+		order[k] = k;
+	mNodeBox.reserve(6 * (2 * chunkCount - 1));
+	mNodeLink.reserve(2 * (2 * chunkCount - 1));
+	BuildNode(order, 0, chunkCount);
+}
+
+//------------------------------------------------------------
+// Build one node of the hierarchy
+//------------------------------------------------------------
+/*
+* Splits the chunks at the median of their centres along the longest axis
+* of the centres' spread. Nodes are numbered depth first, parents ahead of
+* their children. Returns the node's index.
+*/
+Integer TrajectoryBounds::BuildNode(std::vector<size_t> &order,
+	const size_t begin, const size_t end) {
+	Integer node = (Integer)GetNodeCount();
+	mNodeLink.push_back(-1);
+	mNodeLink.push_back((Integer)order[begin]);
+
+	Real box[6], low[3], high[3];
+	for (size_t c = 0; c < 3; c++) {
+		box[c] = low[c] = std::numeric_limits<Real>::max();
+		box[3 + c] = high[c] = -std::numeric_limits<Real>::max();
+	}
+	for (size_t k = begin; k < end; k++) {
+		const Real *chunk = &mChunkBox[6 * order[k]];
+		for (size_t c = 0; c < 3; c++) {
+			box[c] = std::min(box[c], chunk[c]);
+			box[3 + c] = std::max(box[3 + c], chunk[3 + c]);
+			low[c] = std::min(low[c], chunk[c] + chunk[3 + c]);
+			high[c] = std::max(high[c], chunk[c] + chunk[3 + c]);
+		}
+	}
+	mNodeBox.insert(mNodeBox.end(), box, box + 6);
+
+	if (end - begin > 1) {
+		size_t axis = 0;
+		for (size_t c = 1; c < 3; c++) {
+			if (high[c] - low[c] > high[axis] - low[axis])
+				axis = c;
+		}
+		size_t middle = begin + (end - begin) / 2;
+		std::nth_element(order.begin() + begin, order.begin() + middle,
+			order.begin() + end, CentreLess(mChunkBox, axis));
+
+		Integer left = BuildNode(order, begin, middle);
+		Integer right = BuildNode(order, middle, end);
+		mNodeLink[2 * node] = left;
+		mNodeLink[2 * node + 1] = right;
+	}
+	return node;
+}
+
+//------------------------------------------------------------
+// Write the bounds as json
+//------------------------------------------------------------
+/*
+* "chunks" holds a box per chunk, "nodes" a box per node followed by its
+* two children, or by -1 and its chunk for a leaf. Node 0 is the root.
+*/
+void TrajectoryBounds::WriteJson(std::ostringstream &jsonBuilder,
+	const std::string &indent) const {
+	jsonBuilder << indent << "\"bounds\": {\n";
+	jsonBuilder << indent << "\t" << "\"chunkSize\": " << mChunkSize << ",\n";
+
+	jsonBuilder << indent << "\t" << "\"chunks\": [\n";
+	for (size_t k = 0; k < GetChunkCount(); k++) {
+		jsonBuilder << indent << "\t\t" << "[" << std::setprecision(10);
+		for (size_t c = 0; c < 6; c++)
+			jsonBuilder << mChunkBox[6 * k + c] << (c < 5 ? "," : "");
+		jsonBuilder << "],\n";
+	}
+	jsonBuilder << indent << "\t" << "],\n";
+
+	jsonBuilder << indent << "\t" << "\"nodes\": [\n";
+	for (size_t k = 0; k < GetNodeCount(); k++) {
+		jsonBuilder << indent << "\t\t" << "[" << std::setprecision(10);
+		for (size_t c = 0; c < 6; c++)
+			jsonBuilder << mNodeBox[6 * k + c] << ",";
+		jsonBuilder << mNodeLink[2 * k] << "," << mNodeLink[2 * k + 1] << "],\n";
+	}
+	jsonBuilder << indent << "\t" << "]\n";
+	jsonBuilder << indent << "},\n";
+}
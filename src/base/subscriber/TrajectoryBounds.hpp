@@ -0,0 +1,45 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  TrajectoryBounds
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares TrajectoryBounds class, the spatial index of one object's
+// exported trajectory: axis-aligned boxes around chunks of consecutive
+// samples and a bounding volume hierarchy over the chunks, so a client can
+// cull and pick against an orbit without testing every segment.
+
+#ifndef TrajectoryBounds_hpp
+#define TrajectoryBounds_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <sstream>
+
+class VRInterface_API TrajectoryBounds
+{
+public:
+	TrajectoryBounds();
+
+	// chunk k spans samples k * chunkSize to (k + 1) * chunkSize, both
+	// included, so every segment lies in exactly one chunk
+	// @position 3 per sample
+	void Build(const RealArray &position, const size_t chunkSize);
+
+	size_t GetChunkCount() const { return mChunkBox.size() / 6; }
+	size_t GetNodeCount() const { return mNodeLink.size() / 2; }
+
+	// @indent tabs ahead of the "bounds" key
+	void WriteJson(std::ostringstream &jsonBuilder, const std::string &indent) const;
+
+protected:
+	Integer BuildNode(std::vector<size_t> &order, const size_t begin,
+		const size_t end);
+
+	size_t mChunkSize;
+	RealArray mChunkBox;			// 6 per chunk: min x, y, z, max x, y, z
+	RealArray mNodeBox;			// 6 per node
+	IntegerArray mNodeLink;		// 2 per node: child nodes, or -1 and a chunk
+};
+
+#endif
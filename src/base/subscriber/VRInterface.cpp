@@ -19,9 +19,14 @@
 #include "FileUtil.hpp"				  // for fileName validation
 #include "AttitudeConversionUtility.hpp"	// for attitude conversation
 #include "Moderator.hpp"				// for GetScriptFileName()
+#include "TimeSystemConverter.hpp"	// for export window epochs
 #include <cmath>						  // for M_PI
+#include <limits>						  // for open export windows
+#include <algorithm>					  // for sort()
 
 #include "DataManager.hpp"
+#include "GzipStreamBuffer.hpp"
+#include "VRInterfaceProbes.hpp"
 
 #define _USE_MATH_DEFINES
 
@@ -30,6 +35,90 @@
 #define __REMOVE_OBJ_BY_SETTING_FLAG__
 #define __SHOW_WARNING_FOR_UNPUBLISHED_OBJ__
 
+namespace
+{
+	// converts samples stored in the published frame to the view frame.
+	// GMAT evaluates frames through ephemeris readers and axis caches shared
+	// with the mission, so the frames are evaluated once per epoch by the
+	// constructor, on the GMAT thread. Apply only reads the table, so the
+	// samples are converted on the export threads.
+	class ViewFrameTransform : public SampleTransform
+	{
+	public:
+		// @epochs ascending; every epoch Apply will be called at
+		ViewFrameTransform(CoordinateSystem *dataFrame, CoordinateSystem *viewFrame,
+			const BooleanArray &hasAttitude, const RealArray &epochs) :
+			mEpochs(epochs), mFrames(FRAME_SIZE * epochs.size()),
+			mHasAttitude(hasAttitude) {
+			// a conversion is affine in the state: the origin of the data
+			// frame gives the offset, then the rotation and its rate apply
+			CoordinateConverter converter;
+			Rvector6 origin(0.0, 0.0, 0.0, 0.0, 0.0, 0.0), offset;
+			for (size_t j = 0; j < mEpochs.size(); j++) {
+				converter.Convert(mEpochs[j], origin, dataFrame, offset, viewFrame);
+				Rmatrix33 rot = converter.GetLastRotationMatrix();
+				Rmatrix33 rotDot = converter.GetLastRotationDotMatrix();
+				Real *frame = &mFrames[FRAME_SIZE * j];
+				for (Integer k = 0; k < 6; k++)
+					frame[k] = offset[k];
+				for (Integer r = 0; r < 3; r++) {
+					for (Integer c = 0; c < 3; c++) {
+						frame[ROT + 3 * r + c] = rot(r, c);
+						frame[ROT_DOT + 3 * r + c] = rotDot(r, c);
+					}
+				}
+			}
+		}
+
+		virtual void Apply(const Integer spIndex, const Real epoch,
+			Real *state, Real *quat) {
+			if (mEpochs.empty())
+				return;
+			size_t j = std::lower_bound(mEpochs.begin(), mEpochs.end(), epoch) -
+				mEpochs.begin();
+			const Real *frame = &mFrames[FRAME_SIZE * std::min(j, mEpochs.size() - 1)];
+			const Real *rot = frame + ROT;
+			const Real *rotDot = frame + ROT_DOT;
+
+			Real outState[6];
+			for (Integer r = 0; r < 3; r++) {
+				outState[r] = frame[r];
+				outState[3 + r] = frame[3 + r];
+				for (Integer c = 0; c < 3; c++) {
+					outState[r] += rot[3 * r + c] * state[c];
+					outState[3 + r] += rotDot[3 * r + c] * state[c] +
+						rot[3 * r + c] * state[3 + c];
+				}
+			}
+			for (Integer k = 0; k < 6; k++)
+				state[k] = outState[k];
+
+			// as in BufferSpacecraftData: objects without attitude keep the
+			// default quaternion
+			if (mHasAttitude[spIndex]) {
+				Rmatrix33 cosMat = AttitudeConversionUtility::ToCosineMatrix(
+					Rvector(4, quat[Q1], quat[Q2], quat[Q3], quat[Q4]));
+				Rmatrix33 rotMat;
+				for (Integer r = 0; r < 3; r++)
+					for (Integer c = 0; c < 3; c++)
+						rotMat(r, c) = rot[3 * r + c];
+				Rvector viewQuat = AttitudeConversionUtility::ToQuaternion(
+					cosMat * rotMat.Transpose());
+				for (Integer k = 0; k < 4; k++)
+					quat[k] = viewQuat[k];
+			}
+		}
+
+	private:
+		// per epoch: offset state, then rotation and rotation rate, row major
+		enum { ROT = 6, ROT_DOT = 15, FRAME_SIZE = 24 };
+
+		RealArray mEpochs;
+		RealArray mFrames;
+		BooleanArray mHasAttitude;	// per object, in buffer order
+	};
+}
+
 
 //---------------------------------
 // static data
@@ -47,8 +136,33 @@ VRInterface::PARAMETER_TEXT[VRInterfaceParamCount - SubscriberParamCount] =
 	"MinimumSpacecraftRadii", 
 	//"ModelFile",
 	"DataCollectFrequency",
+	"ObjectCollectFrequency",
 	"MaxDataPoints",
-	"JsonFileLocation"
+	"BufferMemoryLimit",
+	"SpillDirectory",
+	"CompressBuffers",
+	"BufferPrecision",
+	"ReleaseBuffersAfterRun",
+	"JsonFileLocation",
+	"AppendRuns",
+	"EnvelopeStep",
+	"EpochIndexBlock",
+	"TileDuration",
+	"LodLevels",
+	"LodTolerance",
+	"BoundsChunk",
+	"CloseApproachDistance",
+	"CompressionLevel",
+	"ExportArrow",
+	"PerformanceLogFile",
+	"PerformanceBaselineFile",
+	"PerformanceMargin",
+	"ExportStartEpoch",
+	"ExportStopEpoch",
+	"ExportEpochFormat",
+	"AnchorVelocityJump",
+	"SolverPassLimit",
+	"SolverPassInterval"
 };
 
 
@@ -63,8 +177,33 @@ VRInterface::PARAMETER_TYPE[VRInterfaceParamCount - SubscriberParamCount] =
 	Gmat::INTEGER_TYPE,				//"MinimumSpacecraftRadii",
 	//Gmat::FILENAME_TYPE,				//"ModelFile",
 	Gmat::INTEGER_TYPE,				//"DataCollectFrequency",
+	Gmat::INTARRAY_TYPE,				//"ObjectCollectFrequency",
 	Gmat::INTEGER_TYPE,           //"MaxDataPoints"
+	Gmat::REAL_TYPE,					//"BufferMemoryLimit",
+	Gmat::STRING_TYPE,				//"SpillDirectory",
+	Gmat::BOOLEAN_TYPE,				//"CompressBuffers",
+	Gmat::STRING_TYPE,				//"BufferPrecision",
+	Gmat::BOOLEAN_TYPE,				//"ReleaseBuffersAfterRun",
 	Gmat::FILENAME_TYPE,				//"JsonFile",
+	Gmat::BOOLEAN_TYPE,				//"AppendRuns",
+	Gmat::REAL_TYPE,					//"EnvelopeStep",
+	Gmat::INTEGER_TYPE,				//"EpochIndexBlock",
+	Gmat::REAL_TYPE,					//"TileDuration",
+	Gmat::INTEGER_TYPE,				//"LodLevels",
+	Gmat::REAL_TYPE,					//"LodTolerance",
+	Gmat::INTEGER_TYPE,				//"BoundsChunk",
+	Gmat::REAL_TYPE,					//"CloseApproachDistance",
+	Gmat::INTEGER_TYPE,				//"CompressionLevel",
+	Gmat::BOOLEAN_TYPE,				//"ExportArrow",
+	Gmat::FILENAME_TYPE,				//"PerformanceLogFile",
+	Gmat::FILENAME_TYPE,				//"PerformanceBaselineFile",
+	Gmat::REAL_TYPE,					//"PerformanceMargin",
+	Gmat::STRINGARRAY_TYPE,			//"ExportStartEpoch",
+	Gmat::STRINGARRAY_TYPE,			//"ExportStopEpoch",
+	Gmat::STRING_TYPE,				//"ExportEpochFormat",
+	Gmat::REAL_TYPE,					//"AnchorVelocityJump",
+	Gmat::INTEGER_TYPE,				//"SolverPassLimit",
+	Gmat::INTEGER_TYPE,				//"SolverPassInterval",
 
 };
 
@@ -97,6 +236,12 @@ VRInterface::VRInterface(const std::string &type, const std::string &name)
 	// jsonFileName = { R"(C:\Users\User\Documents\Unity\JSONs\json.json)" };
 
 	mSolverIterOption = SI_NONE;
+	mSolverIterations = "None";
+	mSolverPassLimit = 10;
+	mSolverPassInterval = 1;
+	mSolverPassOpen = false;
+	mSolverPassEpoch = 0.0;
+	mSolverPassRows = 0;
 
 	mOldName = instanceName;
 	mViewCoordSysName = "EarthMJ2000Eq";
@@ -104,10 +249,55 @@ VRInterface::VRInterface(const std::string &type, const std::string &name)
 	mScRadiiMin = 50;
 
 	mDataCollectFrequency = 1;
+	mObjectCollectFrequencyList.clear();
+	mObjectCollectFrequency.clear();
+	mSampleMask.clear();
 	mNumData = 0;
 	mMaxData = 20000;
+	mBufferMemoryLimit = 0.0;
+	mSpillDirectory = "";
+	mCompressBuffers = false;
+	mBufferPrecision = "Double";
+	mReleaseBuffersAfterRun = false;
+	mAppendRuns = false;
+	mEnvelopeStep = 0.0;
+	mEpochIndexBlock = 0;
+	mTileDuration = 0.0;
+	mLodLevels = 0;
+	mLodTolerance = 1.0;
+	mBoundsChunk = 0;
+	mCloseApproachDistance = 0.0;
+	mCompressionLevel = 0;
+	mExportArrow = false;
+	mExportRunning = false;
+	mExportBytes = 0;
+	mExportError = "";
+	mExportTransform = NULL;
+	mDeferViewTransform = true;
+	mPointBudget = mMaxData;
 	mDataAbsentWarningCount = 0;
 
+	mPerformanceLogFile = "";
+	mPerformanceBaselineFile = "";
+	mPerformanceMargin = 0.1;
+
+	mExportStartEpochs.clear();
+	mExportStopEpochs.clear();
+	mExportEpochFormat = "UTCGregorian";
+	mWindowStart.clear();
+	mWindowStop.clear();
+
+	mAnchorVelocityJump = 0.1;
+	mLastData.clear();
+	mLastRowStored.clear();
+	mAnchorMask.clear();
+	mAnchorNextSample = true;
+	mResumeNextSample = false;
+	mLastRunState = Gmat::IDLE;
+	mProviderLabels.clear();
+	mLabels = NULL;
+	mLastRowLabels = NULL;
+
 	mScNameArray.clear();
 	mCbNameArray.clear();
 	mObjectNameArray.clear();
@@ -171,6 +361,11 @@ VRInterface::VRInterface(const VRInterface &vri)
 	jsonFileName = vri.jsonFileName;
 
 	mSolverIterOption = vri.mSolverIterOption;
+	mSolverPassLimit = vri.mSolverPassLimit;
+	mSolverPassInterval = vri.mSolverPassInterval;
+	mSolverPassOpen = false;
+	mSolverPassEpoch = 0.0;
+	mSolverPassRows = 0;
 
 	mOldName = vri.mOldName;
 	mViewCoordSysName = vri.mViewCoordSysName;
@@ -178,7 +373,47 @@ VRInterface::VRInterface(const VRInterface &vri)
 	mScRadiiMin = vri.mScRadiiMin;
 
 	mDataCollectFrequency = vri.mDataCollectFrequency;
+	mObjectCollectFrequencyList = vri.mObjectCollectFrequencyList;
+	mObjectCollectFrequency = vri.mObjectCollectFrequency;
+	mSampleMask = vri.mSampleMask;
+	mObjectRows = vri.mObjectRows;
 	mMaxData = vri.mMaxData;
+	mBufferMemoryLimit = vri.mBufferMemoryLimit;
+	mSpillDirectory = vri.mSpillDirectory;
+	mCompressBuffers = vri.mCompressBuffers;
+	mBufferPrecision = vri.mBufferPrecision;
+	mReleaseBuffersAfterRun = vri.mReleaseBuffersAfterRun;
+	mAppendRuns = vri.mAppendRuns;
+	mEnvelopeStep = vri.mEnvelopeStep;
+	mEpochIndexBlock = vri.mEpochIndexBlock;
+	mTileDuration = vri.mTileDuration;
+	mLodLevels = vri.mLodLevels;
+	mLodTolerance = vri.mLodTolerance;
+	mBoundsChunk = vri.mBoundsChunk;
+	mCloseApproachDistance = vri.mCloseApproachDistance;
+	mCompressionLevel = vri.mCompressionLevel;
+	mExportArrow = vri.mExportArrow;
+	mExportRunning = false;
+	mExportBytes = 0;
+	mExportError = "";
+	mExportTransform = NULL;
+	mDeferViewTransform = vri.mDeferViewTransform;
+	mPointBudget = vri.mPointBudget;
+
+	mPerformanceLog = vri.mPerformanceLog;
+	mPerformanceLogFile = vri.mPerformanceLogFile;
+	mPerformanceBaselineFile = vri.mPerformanceBaselineFile;
+	mPerformanceMargin = vri.mPerformanceMargin;
+
+	mExportStartEpochs = vri.mExportStartEpochs;
+	mExportStopEpochs = vri.mExportStopEpochs;
+	mExportEpochFormat = vri.mExportEpochFormat;
+
+	mAnchorVelocityJump = vri.mAnchorVelocityJump;
+	mLabels = NULL;
+	mLastRowLabels = NULL;
+	mWindowStart = vri.mWindowStart;
+	mWindowStop = vri.mWindowStop;
 
 	mAllSpCount = vri.mAllSpCount;
 	mScCount = vri.mScCount;
@@ -244,11 +479,18 @@ VRInterface& VRInterface::operator=(const VRInterface& vri)
 	if (this == &vri)
 		return *this;
 
+	// buffers are not copied; a copy collects its own samples
+	FinishExport();
 	Subscriber::operator=(vri);
 
 	mViewCoordSystem = vri.mViewCoordSystem;
 
 	mSolverIterOption = vri.mSolverIterOption;
+	mSolverPassLimit = vri.mSolverPassLimit;
+	mSolverPassInterval = vri.mSolverPassInterval;
+	mSolverPassOpen = false;
+	mSolverPassEpoch = 0.0;
+	mSolverPassRows = 0;
 
 	jsonFileName = vri.jsonFileName;
 
@@ -258,7 +500,44 @@ VRInterface& VRInterface::operator=(const VRInterface& vri)
 	mScRadiiMin = vri.mScRadiiMin;
 
 	mDataCollectFrequency = vri.mDataCollectFrequency;
+	mObjectCollectFrequencyList = vri.mObjectCollectFrequencyList;
+	mObjectCollectFrequency = vri.mObjectCollectFrequency;
+	mSampleMask = vri.mSampleMask;
+	mObjectRows = vri.mObjectRows;
 	mMaxData = vri.mMaxData;
+	mBufferMemoryLimit = vri.mBufferMemoryLimit;
+	mSpillDirectory = vri.mSpillDirectory;
+	mCompressBuffers = vri.mCompressBuffers;
+	mBufferPrecision = vri.mBufferPrecision;
+	mReleaseBuffersAfterRun = vri.mReleaseBuffersAfterRun;
+	mAppendRuns = vri.mAppendRuns;
+	mEnvelopeStep = vri.mEnvelopeStep;
+	mEpochIndexBlock = vri.mEpochIndexBlock;
+	mTileDuration = vri.mTileDuration;
+	mLodLevels = vri.mLodLevels;
+	mLodTolerance = vri.mLodTolerance;
+	mBoundsChunk = vri.mBoundsChunk;
+	mCloseApproachDistance = vri.mCloseApproachDistance;
+	mCompressionLevel = vri.mCompressionLevel;
+	mExportArrow = vri.mExportArrow;
+	mDeferViewTransform = vri.mDeferViewTransform;
+	mPointBudget = vri.mPointBudget;
+
+	mPerformanceLog = vri.mPerformanceLog;
+	mPerformanceLogFile = vri.mPerformanceLogFile;
+	mPerformanceBaselineFile = vri.mPerformanceBaselineFile;
+	mPerformanceMargin = vri.mPerformanceMargin;
+
+	mExportStartEpochs = vri.mExportStartEpochs;
+	mExportStopEpochs = vri.mExportStopEpochs;
+	mExportEpochFormat = vri.mExportEpochFormat;
+
+	mAnchorVelocityJump = vri.mAnchorVelocityJump;
+	mProviderLabels.clear();
+	mLabels = NULL;
+	mLastRowLabels = NULL;
+	mWindowStart = vri.mWindowStart;
+	mWindowStop = vri.mWindowStop;
 
 	mAllSpCount = vri.mAllSpCount;
 	mScCount = vri.mScCount;
@@ -322,6 +601,7 @@ VRInterface& VRInterface::operator=(const VRInterface& vri)
  //------------------------------------------------------------------------------
 VRInterface::~VRInterface()
 {
+	FinishExport();
 	jstream.flush();
 	jstream.close();
 
@@ -448,8 +728,66 @@ bool VRInterface::Initialize() {
 
 		ClearDynamicArrays();
 		BuildDynamicArrays();
-		DataManager bdg;
-			bdg.BuildDynamicBuffers(mObjectCount);
+		mPerformanceLog.Reset();
+		BuildExportWindows();
+
+		mLastData.clear();
+		mAnchorNextSample = true;
+		mResumeNextSample = false;
+		mLastRunState = runstate;
+		mProviderLabels.clear();
+		mLabels = NULL;
+		mLastRowLabels = NULL;
+
+		// per-object point budget; the memory limit covers the time stamp,
+		// state and quaternion of every sample
+		mPointBudget = mMaxData;
+		if (mBufferMemoryLimit > 0.0 && mObjectCount > 0) {
+			Real memoryPoints = mBufferMemoryLimit * 1.0e6 /
+				(mObjectCount * 11 * sizeof(Real));
+			if (memoryPoints < mPointBudget)
+				mPointBudget = std::max((Integer)memoryPoints, 4);
+		}
+
+		// states are stored in the published frame and converted at export,
+		// unless the view frame depends on a spacecraft. Such a frame can
+		// only be evaluated at the current epoch.
+		mDeferViewTransform = true;
+		if (mViewCoordSystem != NULL) {
+			SpacePoint *frameObjects[] = { mViewCoordSystem->GetOrigin(),
+				mViewCoordSystem->GetPrimaryObject(),
+				mViewCoordSystem->GetSecondaryObject() };
+			for (Integer k = 0; k < 3; k++) {
+				if (frameObjects[k] != NULL && frameObjects[k]->IsOfType(Gmat::SPACECRAFT))
+					mDeferViewTransform = false;
+			}
+		}
+
+		FinishExport();
+		mBuffers.BuildDynamicBuffers(mObjectNameArray, mSpillDirectory, mCompressBuffers,
+			mBufferPrecision == "Single", BuildSampleKeys());
+		mBuffers.SetActive(active);
+
+		// Current shows the last pass only
+		Integer passLimit = 0;
+		if (mSolverIterOption == SI_ALL)
+			passLimit = mSolverPassLimit;
+		else if (mSolverIterOption == SI_CURRENT)
+			passLimit = 1;
+		mBuffers.BuildSolverPasses(mScCount, passLimit, mSolverPassInterval, mPointBudget);
+		mBuffers.SetEpochIndexBlock(mEpochIndexBlock);
+		mBuffers.SetTileDuration(mTileDuration);
+		mBuffers.SetLodPyramid(mLodLevels, mLodTolerance);
+		mBuffers.SetBoundsChunk(mBoundsChunk);
+		if (mCompressionLevel > 0 && !GzipStreamBuffer::IsAvailable()) {
+			MessageInterface::ShowMessage("VRInterface: CompressionLevel is "
+				"ignored, as this build has no zlib; writing plain json\n");
+			mBuffers.SetCompressionLevel(0);
+		}
+		else
+			mBuffers.SetCompressionLevel(mCompressionLevel);
+		mBuffers.SetArrowExport(mExportArrow);
+		mSolverPassOpen = false;
 
 		isInitialized = true;
 		retval = true;
@@ -543,14 +881,22 @@ bool VRInterface::TakeAction(const std::string &action,
 		// This action is usually called when GMAT function finalizes
 		// PlotInterface::DeleteGlPlot(instanceName);
 	}
+	else if (action == "ReleaseBuffers") {
+		// frees the memory kept between runs
+		FinishExport();
+		mBuffers.ReleaseDynamicBuffers();
+		return true;
+	}
 	else if (action == "PenUp") {
 		//isDataOn = false;
 		active = false;
+		mBuffers.SetActive(active);
 		return true;
 	}
 	else if (action == "PenDown") {
 		//isDataOn = true;
 		active = true;
+		mBuffers.SetActive(active);
 		return true;
 	}
 
@@ -651,7 +997,10 @@ bool VRInterface::RenameRefObject(const UnsignedInt type,
  //------------------------------------------------------------------------------
 bool VRInterface::Activate(bool state)
 {
-	return Subscriber::Activate(state);
+	bool retval = Subscriber::Activate(state);
+	// shared samples go on being buffered by another VRInterface
+	mBuffers.SetActive(active);
+	return retval;
 }
 
 
@@ -667,6 +1016,8 @@ bool VRInterface::Activate(bool state)
  //------------------------------------------------------------------------------
 bool VRInterface::Distribute(const Real *dat, Integer len)
 {
+	VRINTERFACE_PROBE3(distribute_entry, (len > 0 ? dat[0] : 0.0), len, (int)runstate);
+
 	#ifdef DEBUG_DISTRIBUTE
 		MessageInterface::ShowMessage
 		("===========================================================================\n"
@@ -678,12 +1029,7 @@ bool VRInterface::Distribute(const Real *dat, Integer len)
 
 
 	if (isEndOfRun) {	// this is called twice at end of run
-			DataManager wtj;
-			if (wtj.WriteToJson(jsonFileName, jstream, mScCount, mCbCount,
-						mScNameArray, mCbNameArray, mSpRadii,
-						mDefaultOrbitColorMap, mMaxData,
-						mExportAttitude, mExportColours, mDrawOrbitArray))
-				MessageInterface::ShowMessage("VRInterface: Mission data exported successfully.\n");
+			ExportData();
 			if (isAbsentData) {
 				MessageInterface::PopupMessage(Gmat::WARNING_, "There was absent data. Did you propagate all SC?");
 				isAbsentData = false;
@@ -692,16 +1038,13 @@ bool VRInterface::Distribute(const Real *dat, Integer len)
 	}
 
 	if (isEndOfReceive) {
-		// end of a trajectory segment
-			if ((mSolverIterOption == SI_CURRENT) &&
-			(runstate == Gmat::SOLVING || runstate == Gmat::SOLVEDPASS)) {
-			// if solver passed and still iterating
-			// PLACEHOLDER if plotting intermediate trajectories. e.g.
-				// update data in solver buffer with current solver data
-				// plot new trajectory segment to represent iteration steps 
-
-			// currently, this won't trigger as mSolverIterOption always SI_NONE
-			return true;
+		// end of a trajectory segment: keep its last row as an anchor, even if
+		// it was not due for a sample, and anchor the first row of the next
+		if (active && !mLastData.empty()) {
+			BufferLastRow(BooleanArray(mObjectCount, true));
+			mAnchorNextSample = true;
+			for (Integer i = 0; i < mScCount; i++)
+				mScPrevCount[i] = 0;
 		}
 	}
 
@@ -730,12 +1073,26 @@ bool VRInterface::Distribute(const Real *dat, Integer len)
 		return true;
 	}
 
+	// solver passes are kept apart, so that they do not mix with the
+	// mission trajectory
+	if (runstate == Gmat::SOLVING) {
+		if (len >= 7)
+			CaptureSolverRow(dat, len);
+		return true;
+	}
+	mSolverPassOpen = false;
+
 	// conditions passed, start buffering data
 
 	if (len >= 7) {	// more than 7 if multiple sc
 		// there is mission data in the stream, do main implementation here
 		
-		DataControl(dat, len);
+		if (mPerformanceLogFile != "") {
+			mPerformanceLog.StartIngest();
+			mPerformanceLog.StopIngest(DataControl(dat, len));
+		}
+		else
+			DataControl(dat, len);
 		return true;
 	}
 
@@ -809,8 +1166,6 @@ std::string VRInterface::GetParameterTypeString(const Integer id) const
 bool VRInterface::IsParameterReadOnly(const Integer id) const
 {
 	switch (id) {
-		case SOLVER_ITERATIONS:
-			return true;
 		//case COORD_SYSTEM:
 		//	return true;
 	//	case READ_ONLY_PARAMETER
@@ -830,6 +1185,18 @@ Integer VRInterface::GetIntegerParameter(const Integer id) const
 			return mDataCollectFrequency;
 		case MAX_DATA:
 			return mMaxData;
+		case SOLVER_PASS_LIMIT:
+			return mSolverPassLimit;
+		case SOLVER_PASS_INTERVAL:
+			return mSolverPassInterval;
+		case EPOCH_INDEX_BLOCK:
+			return mEpochIndexBlock;
+		case LOD_LEVELS:
+			return mLodLevels;
+		case BOUNDS_CHUNK:
+			return mBoundsChunk;
+		case COMPRESSION_LEVEL:
+			return mCompressionLevel;
 		case SC_RADII:
 			return mScRadiiMin;
 		default:
@@ -881,6 +1248,90 @@ Integer VRInterface::SetIntegerParameter(const Integer id, const Integer value)
 					"MaxPlotPoints", "Integer Number > 0");
 				throw se;
 			}
+		case SOLVER_PASS_LIMIT:
+			if (value >= 0)
+			{
+				mSolverPassLimit = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"SolverPassLimit", "Integer Number >= 0");
+				throw se;
+			}
+		case SOLVER_PASS_INTERVAL:
+			if (value > 0)
+			{
+				mSolverPassInterval = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"SolverPassInterval", "Integer Number > 0");
+				throw se;
+			}
+		case EPOCH_INDEX_BLOCK:
+			if (value >= 0)
+			{
+				mEpochIndexBlock = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"EpochIndexBlock", "Integer Number >= 0");
+				throw se;
+			}
+		case LOD_LEVELS:
+			if (value >= 0)
+			{
+				mLodLevels = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"LodLevels", "Integer Number >= 0");
+				throw se;
+			}
+		case BOUNDS_CHUNK:
+			if (value >= 0)
+			{
+				mBoundsChunk = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"BoundsChunk", "Integer Number >= 0");
+				throw se;
+			}
+		case COMPRESSION_LEVEL:
+			if (value >= 0 && value <= 9)
+			{
+				mCompressionLevel = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"CompressionLevel", "0 <= Integer Number <= 9");
+				throw se;
+			}
 		case SC_RADII:
 			if (value > 0) {
 				mScRadiiMin = value;
@@ -910,6 +1361,234 @@ Integer VRInterface::SetIntegerParameter(const std::string &label,
 }
 
 
+//------------------------------------------------------------------------------
+// virtual Integer GetIntegerParameter(const Integer id, const Integer index) const
+//------------------------------------------------------------------------------
+Integer VRInterface::GetIntegerParameter(const Integer id, const Integer index) const
+{
+	switch (id) {
+		case OBJECT_COLLECT_FREQUENCY:
+			if (index >= 0 && index < (Integer)mObjectCollectFrequencyList.size())
+				return mObjectCollectFrequencyList[index];
+			return mDataCollectFrequency;
+		default:
+			return Subscriber::GetIntegerParameter(id, index);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// virtual Integer SetIntegerParameter(const Integer id, const Integer value,
+//                                     const Integer index)
+//------------------------------------------------------------------------------
+/**
+ * Sets the collect frequency of the object at index in the Add list.
+ * 0 falls back to DataCollectFrequency.
+ */
+//------------------------------------------------------------------------------
+Integer VRInterface::SetIntegerParameter(const Integer id, const Integer value,
+	const Integer index)
+{
+	switch (id) {
+		case OBJECT_COLLECT_FREQUENCY:
+			if (value >= 0 && index >= 0)
+			{
+				if ((Integer)mObjectCollectFrequencyList.size() <= index)
+					mObjectCollectFrequencyList.resize(index + 1, 0);
+				mObjectCollectFrequencyList[index] = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 1).c_str(),
+					"ObjectCollectFrequency", "Integer Number >= 0");
+				throw se;
+			}
+		default:
+			return Subscriber::SetIntegerParameter(id, value, index);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// const IntegerArray& GetIntegerArrayParameter(const Integer id) const
+//------------------------------------------------------------------------------
+const IntegerArray& VRInterface::GetIntegerArrayParameter(const Integer id) const
+{
+	switch (id) {
+		case OBJECT_COLLECT_FREQUENCY:
+			return mObjectCollectFrequencyList;
+		default:
+			return Subscriber::GetIntegerArrayParameter(id);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// const IntegerArray& GetIntegerArrayParameter(const std::string &label) const
+//------------------------------------------------------------------------------
+const IntegerArray& VRInterface::GetIntegerArrayParameter(const std::string &label) const
+{
+	return GetIntegerArrayParameter(GetParameterID(label));
+}
+
+
+//------------------------------------------------------------------------------
+// virtual Real GetRealParameter(const Integer id) const
+//------------------------------------------------------------------------------
+Real VRInterface::GetRealParameter(const Integer id) const
+{
+	switch (id) {
+		case PERFORMANCE_MARGIN:
+			return mPerformanceMargin;
+		case ANCHOR_VELOCITY_JUMP:
+			return mAnchorVelocityJump;
+		case BUFFER_MEMORY_LIMIT:
+			return mBufferMemoryLimit;
+		case ENVELOPE_STEP:
+			return mEnvelopeStep;
+		case TILE_DURATION:
+			return mTileDuration;
+		case LOD_TOLERANCE:
+			return mLodTolerance;
+		case CLOSE_APPROACH_DISTANCE:
+			return mCloseApproachDistance;
+		default:
+			return Subscriber::GetRealParameter(id);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// virtual Real GetRealParameter(const std::string &label) const
+//------------------------------------------------------------------------------
+Real VRInterface::GetRealParameter(const std::string &label) const
+{
+	return GetRealParameter(GetParameterID(label));
+}
+
+
+//------------------------------------------------------------------------------
+// virtual Real SetRealParameter(const Integer id, const Real value)
+//------------------------------------------------------------------------------
+Real VRInterface::SetRealParameter(const Integer id, const Real value)
+{
+	switch (id) {
+		case PERFORMANCE_MARGIN:
+			if (value >= 0.0)
+			{
+				mPerformanceMargin = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"PerformanceMargin", "Real Number >= 0");
+				throw se;
+			}
+		case BUFFER_MEMORY_LIMIT:
+			if (value >= 0.0)
+			{
+				mBufferMemoryLimit = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"BufferMemoryLimit", "Real Number >= 0");
+				throw se;
+			}
+		case ANCHOR_VELOCITY_JUMP:
+			if (value >= 0.0)
+			{
+				mAnchorVelocityJump = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"AnchorVelocityJump", "Real Number >= 0");
+				throw se;
+			}
+		case ENVELOPE_STEP:
+			if (value >= 0.0)
+			{
+				mEnvelopeStep = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"EnvelopeStep", "Real Number >= 0");
+				throw se;
+			}
+		case TILE_DURATION:
+			if (value >= 0.0)
+			{
+				mTileDuration = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"TileDuration", "Real Number >= 0");
+				throw se;
+			}
+		case LOD_TOLERANCE:
+			if (value > 0.0)
+			{
+				mLodTolerance = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"LodTolerance", "Real Number > 0");
+				throw se;
+			}
+		case CLOSE_APPROACH_DISTANCE:
+			if (value >= 0.0)
+			{
+				mCloseApproachDistance = value;
+				return value;
+			}
+			else
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(),
+					GmatStringUtil::ToString(value, 16).c_str(),
+					"CloseApproachDistance", "Real Number >= 0");
+				throw se;
+			}
+		default:
+			return Subscriber::SetRealParameter(id, value);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// virtual Real SetRealParameter(const std::string &label, const Real value)
+//------------------------------------------------------------------------------
+Real VRInterface::SetRealParameter(const std::string &label, const Real value)
+{
+	return SetRealParameter(GetParameterID(label), value);
+}
+
+
 //------------------------------------------------------------------------------
 // std::string GetStringParameter(const Integer id) const
 //------------------------------------------------------------------------------
@@ -918,14 +1597,26 @@ std::string VRInterface::GetStringParameter(const Integer id) const
 
 
 	switch (id) {
-		case SOLVER_ITERATIONS:	// this is called for unknown reasons -- DOCUMENT
-			return "None";	// default to None
 		case ADD:
 			return GetObjectStringList();
 		case COORD_SYSTEM:
 			return mViewCoordSysName;
 		case JSON_FILE:
 			return jsonFileName;
+		case SPILL_DIRECTORY:
+			return mSpillDirectory;
+		case BUFFER_PRECISION:
+			return mBufferPrecision;
+		case PERFORMANCE_LOG_FILE:
+			return mPerformanceLogFile;
+		case PERFORMANCE_BASELINE_FILE:
+			return mPerformanceBaselineFile;
+		case EXPORT_START_EPOCH:
+			return GetEpochStringList(mExportStartEpochs);
+		case EXPORT_STOP_EPOCH:
+			return GetEpochStringList(mExportStopEpochs);
+		case EXPORT_EPOCH_FORMAT:
+			return mExportEpochFormat;
 		default:
 			return Subscriber::GetStringParameter(id);
 	}
@@ -996,6 +1687,69 @@ bool VRInterface::SetStringParameter(const Integer id, const std::string &value)
 			jsonFileName = value;
 		return true;
 	}
+	case BUFFER_PRECISION:
+		if (value != "Double" && value != "Single")
+		{
+			SubscriberException se;
+			se.SetDetails(errorMessageFormat.c_str(), value.c_str(),
+				"BufferPrecision", "Double or Single");
+			throw se;
+		}
+		mBufferPrecision = value;
+		return true;
+	case SPILL_DIRECTORY:
+		if (value != "" && !GmatFileUtil::DoesDirectoryExist(value, false))
+		{
+			SubscriberException se;
+			se.SetDetails(errorMessageFormat.c_str(), value.c_str(),
+				"SpillDirectory", "Existing directory, or \"\" to buffer in memory");
+			throw se;
+		}
+		mSpillDirectory = value;
+		return true;
+	case PERFORMANCE_LOG_FILE:
+	case PERFORMANCE_BASELINE_FILE: {
+		if (value != "" && !GmatFileUtil::IsValidFileName(value))
+		{
+			std::string msg = GmatFileUtil::GetInvalidFileNameMessage(1);
+			SubscriberException se;
+			se.SetDetails(errorMessageFormat.c_str(), value.c_str(),
+				GetParameterText(id).c_str(), msg.c_str());
+			throw se;
+		}
+		if (id == PERFORMANCE_LOG_FILE)
+			mPerformanceLogFile = value;
+		else
+			mPerformanceBaselineFile = value;
+		return true;
+	}
+	case OBJECT_COLLECT_FREQUENCY:
+	{
+		// also accept the {1, 1, 20} list form, one entry per Add object
+		TextParser tp;
+		StringArray freqList = tp.SeparateBrackets(value, "{}", ",");
+		mObjectCollectFrequencyList.clear();
+		for (UnsignedInt i = 0; i < freqList.size(); i++)
+		{
+			Integer freq;
+			if (!GmatStringUtil::ToInteger(freqList[i], freq))
+			{
+				SubscriberException se;
+				se.SetDetails(errorMessageFormat.c_str(), value.c_str(),
+					"ObjectCollectFrequency", "List of Integer Numbers >= 0");
+				throw se;
+			}
+			SetIntegerParameter(id, freq, i);
+		}
+		return true;
+	}
+	case EXPORT_START_EPOCH:
+		return SetEpochStringList(mExportStartEpochs, value);
+	case EXPORT_STOP_EPOCH:
+		return SetEpochStringList(mExportStopEpochs, value);
+	case EXPORT_EPOCH_FORMAT:
+		mExportEpochFormat = value;
+		return true;
 	default:
 		return Subscriber::SetStringParameter(id, value);
 	}
@@ -1052,6 +1806,10 @@ bool VRInterface::SetStringParameter(const Integer id, const std::string &value,
 		//else
 		return AddSpacePoint(value, mAllSpCount);
 	}
+	case EXPORT_START_EPOCH:
+		return SetEpochStringList(mExportStartEpochs, value, index);
+	case EXPORT_STOP_EPOCH:
+		return SetEpochStringList(mExportStopEpochs, value, index);
 	//case ORBIT_COLOR:
 	//case TARGET_COLOR:
 		//if (value[0] == '[')
@@ -1088,6 +1846,10 @@ const StringArray& VRInterface::GetStringArrayParameter(const Integer id) const
 	{
 	case ADD:
 		return mAllSpNameArray;
+	case EXPORT_START_EPOCH:
+		return mExportStartEpochs;
+	case EXPORT_STOP_EPOCH:
+		return mExportStopEpochs;
 	default:
 		return Subscriber::GetStringArrayParameter(id);
 	}
@@ -1115,6 +1877,14 @@ bool VRInterface::GetBooleanParameter(const Integer id) const
 			return mExportColours;
 		case DERIVE_RADII:
 			return mDeriveRadii;
+		case COMPRESS_BUFFERS:
+			return mCompressBuffers;
+		case RELEASE_BUFFERS_AFTER_RUN:
+			return mReleaseBuffersAfterRun;
+		case APPEND_RUNS:
+			return mAppendRuns;
+		case EXPORT_ARROW:
+			return mExportArrow;
 		default:
 			return Subscriber::GetBooleanParameter(id);
 	}
@@ -1148,6 +1918,18 @@ bool VRInterface::SetBooleanParameter(const Integer id, const bool value)
 		case DERIVE_RADII:
 			mDeriveRadii = value;
 			return mDeriveRadii;
+		case COMPRESS_BUFFERS:
+			mCompressBuffers = value;
+			return mCompressBuffers;
+		case RELEASE_BUFFERS_AFTER_RUN:
+			mReleaseBuffersAfterRun = value;
+			return mReleaseBuffersAfterRun;
+		case APPEND_RUNS:
+			mAppendRuns = value;
+			return mAppendRuns;
+		case EXPORT_ARROW:
+			mExportArrow = value;
+			return mExportArrow;
 		default:
 			return Subscriber::SetBooleanParameter(id, value);
 	
@@ -1504,8 +2286,24 @@ const StringArray& VRInterface::GetNonSpacecraftList()
 //------------------------------------------------------------------------------
 // bool DataControl(const Real *dat, Integer len)
 //------------------------------------------------------------------------------
+/**
+ * @return true if the sample was buffered, false if it was skipped
+ */
+//------------------------------------------------------------------------------
 bool VRInterface::DataControl(const Real *dat, Integer len)
 {
+	VRINTERFACE_PROBE2(datacontrol_entry, dat[0], len);
+
+	// Skip data outside the export windows before any other work is done.
+	// The last row of a window is kept, and the first row of the next one
+	// starts a new presence span, so nothing is joined across the gap.
+	if (!IsInExportWindow(dat[0])) {
+		if (!mResumeNextSample && !mLastData.empty())
+			BufferLastRow(BooleanArray(mObjectCount, true));
+		mResumeNextSample = true;
+		VRINTERFACE_PROBE2(datacontrol_return, dat[0], 0);
+		return false;
+	}
 
 	// Skip data if data publishing command such as Propagate is inside a function
 	// and this VRInterface is not a global nor a local object (i.e declared in the main script)
@@ -1539,51 +2337,569 @@ bool VRInterface::DataControl(const Real *dat, Integer len)
 
 		if (skipData)
 		{
-			return true;
+			VRINTERFACE_PROBE2(datacontrol_return, dat[0], 0);
+			return false;
 		}
 	}
 
 	mNumData++;
 
-	// Buffer data if data collect frequency is met or first data
-	if ((mNumData % mDataCollectFrequency) == 0 || (mNumData == 1))
-	{
-		bool status = (BufferSpacecraftData(dat, len) && 
-							BufferCelestialBodyData(dat, len));
+	// a solver pass begins or ends: anchor both sides of the boundary.
+	// Done before the label cache is updated, as the last row may belong
+	// to the previous provider.
+	if (runstate != mLastRunState) {
+		BufferLastRow(BooleanArray(mObjectCount, true));
+		mAnchorNextSample = true;
+		mLastRunState = runstate;
+	}
 
+	UpdateLabelIndexCache();
+
+	// a spacecraft that leaves the published rows keeps its last row as an
+	// anchor; one that returns starts a new presence span after a gap
+	BooleanArray vanished(mObjectCount, false);
+	BooleanArray resumed(mObjectCount, false);
+	bool anyVanished = false;
+	for (int i = 0; i < mScCount; i++) {
+		bool present = mLabels->present[i];
+		vanished[i] = mScPrevDataPresent[i] && !present;
+		resumed[i] = !mScPrevDataPresent[i] && present && mObjectRows[i] > 0;
+		anyVanished = anyVanished || vanished[i];
+		mScPrevDataPresent[i] = present;
+	}
+	if (anyVanished)
+		BufferLastRow(vanished);
+	if (mResumeNextSample) {
+		for (int i = 0; i < mObjectCount; i++)
+			resumed[i] = mLabels->present[i] && mObjectRows[i] > 0;
+		for (int i = 0; i < mScCount; i++)
+			mScPrevCount[i] = 0;
+		mResumeNextSample = false;
+	}
 
+	// Buffer data for each object whose collect frequency is met, or first data.
+	// Every halving of an object's buffers doubles its collect interval.
+	// Each object counts only the rows that carry it, so objects published
+	// by different providers keep their own timelines, and an object missing
+	// from a row is not sampled from it.
+	for (int i = 0; i < mObjectCount; i++) {
+		mAnchorMask[i] = false;
+		if (!mLabels->present[i]) {
+			mSampleMask[i] = false;
+			continue;
+		}
+		mObjectRows[i]++;
+		Integer interval = mBuffers.GetSampleInterval(i, mObjectCollectFrequency[i]);
+		mSampleMask[i] = ((mObjectRows[i] % interval) == 0 || (mObjectRows[i] == 1));
+	}
 
-		// if solving and plotting current iteration just return
-		if (status == false)
-			return true;
+	// first row of a segment or solver pass is kept for every object
+	if (mAnchorNextSample) {
+		for (int i = 0; i < mObjectCount; i++)
+			mSampleMask[i] = mAnchorMask[i] = mLabels->present[i];
+		mAnchorNextSample = false;
+	}
+	for (int i = 0; i < mObjectCount; i++) {
+		if (resumed[i])
+			mSampleMask[i] = mAnchorMask[i] = true;
+	}
 
-		bool solving = false;
-		if (runstate == Gmat::SOLVING)
-			solving = true;
+	DetectVelocityJumps(dat, len);
 
-		bool inFunction = false;
-		if (currentProvider && currentProvider->TakeAction("IsInFunction"))
-			inFunction = true;
+	bool anySampled = false;
+	for (int i = 0; i < mObjectCount; i++)
+		anySampled = anySampled || mSampleMask[i];
 
-		// publish final solution data to plotter/data manager
-		DataManager atb;
-		atb.AddToBuffer(dat[0],
-			mScCount, mCbCount, mScNameArray, mCbNameArray,
-			mScXArray, mScYArray, mScZArray,
-			mScVxArray, mScVyArray, mScVzArray,
-			mScQArray,
-			mCbXArray, mCbYArray, mCbZArray,
-			mCbVxArray, mCbVyArray, mCbVzArray,
-			mCbQArray,
-			solving, mSolverIterOption, isDataOn, mMaxData, inFunction);
+	bool kept = anySampled && BufferRow(dat, len);
 
+	// remember this row, in case it has to be stored later as an anchor
+	mLastData.assign(dat, dat + len);
+	mLastRowLabels = mLabels;
+	for (int i = 0; i < mObjectCount; i++) {
+		mLastRowStored[i] = kept && mSampleMask[i];
+		if (resumed[i] && mLastRowStored[i])
+			mBuffers.ResumeLastSample(i);
 	}
 
+	VRINTERFACE_PROBE2(datacontrol_return, dat[0], (kept ? 1 : 0));
+	return kept;
+}
+
+
+//------------------------------------------------------------------------------
+// bool BufferRow(const Real *dat, Integer len)
+//------------------------------------------------------------------------------
+/**
+ * Converts one published row and adds it to the buffers of the objects in
+ * mSampleMask, flagging those in mAnchorMask.
+ *
+ * @return false if solving and plotting current iteration
+ */
+//------------------------------------------------------------------------------
+bool VRInterface::BufferRow(const Real *dat, Integer len)
+{
+	// objects whose shared track another VRInterface buffers need no work
+	for (int i = 0; i < mObjectCount; i++)
+		mSampleMask[i] = mSampleMask[i] && mBuffers.BuffersObject(i);
+
+	bool status = (BufferSpacecraftData(dat, len) && 
+						BufferCelestialBodyData(dat, len));
+
+	// if solving and plotting current iteration just return
+	if (status == false)
+		return false;
+
+	bool solving = false;
+	if (runstate == Gmat::SOLVING)
+		solving = true;
+
+	bool inFunction = false;
+	if (currentProvider && currentProvider->TakeAction("IsInFunction"))
+		inFunction = true;
+
+	// publish final solution data to plotter/data manager
+	mBuffers.AddToBuffer(dat[0],
+		mScCount, mCbCount, mScNameArray, mCbNameArray,
+		mScXArray, mScYArray, mScZArray,
+		mScVxArray, mScVyArray, mScVzArray,
+		mScQArray,
+		mCbXArray, mCbYArray, mCbZArray,
+		mCbVxArray, mCbVyArray, mCbVzArray,
+		mCbQArray,
+		mSampleMask, mAnchorMask,
+		solving, mSolverIterOption, isDataOn, mPointBudget, inFunction);
 
 	return true;
 }
 
 
+//------------------------------------------------------------------------------
+// void BufferLastRow(const BooleanArray &objects)
+//------------------------------------------------------------------------------
+/**
+ * Keeps the previous row as an anchor for the given objects. Objects that
+ * already buffered it only have that sample flagged.
+ *
+ * @param <objects> per object, true if the previous row ends a segment
+ */
+//------------------------------------------------------------------------------
+void VRInterface::BufferLastRow(const BooleanArray &objects)
+{
+	if (mLastData.empty() || mLastRowLabels == NULL)
+		return;
+
+	// the previous row is read with the labels of its own provider
+	ProviderLabels *labels = mLabels;
+	mLabels = mLastRowLabels;
+
+	BooleanArray sampleMask = mSampleMask;
+	BooleanArray anchorMask = mAnchorMask;
+	bool anyMissing = false;
+
+	for (int i = 0; i < mObjectCount; i++) {
+		mSampleMask[i] = objects[i] && !mLastRowStored[i] && mLabels->present[i];
+		mAnchorMask[i] = mSampleMask[i];
+		if (objects[i] && mLastRowStored[i])
+			mBuffers.AnchorLastSample(i);
+		anyMissing = anyMissing || mSampleMask[i];
+	}
+
+	if (anyMissing && BufferRow(&mLastData[0], (Integer)mLastData.size())) {
+		for (int i = 0; i < mObjectCount; i++)
+			mLastRowStored[i] = mLastRowStored[i] || mSampleMask[i];
+	}
+
+	mSampleMask = sampleMask;
+	mAnchorMask = anchorMask;
+	mLabels = labels;
+}
+
+
+//------------------------------------------------------------------------------
+// void DetectVelocityJumps(const Real *dat, Integer len)
+//------------------------------------------------------------------------------
+/**
+ * Flags spacecraft whose change in velocity since the previous row is not
+ * explained by the acceleration over the step before, e.g. an impulsive burn
+ * inside a segment. Both rows around the jump are kept as anchors.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::DetectVelocityJumps(const Real *dat, Integer len)
+{
+	if (mAnchorVelocityJump <= 0.0)
+		return;
+
+	BooleanArray jumped(mObjectCount, false);
+	bool anyJump = false;
+
+	for (Integer i = 0; i < mScCount; i++) {
+		Integer idVx = mLabels->scIndex[6 * i + 3];
+		Integer idVy = mLabels->scIndex[6 * i + 4];
+		Integer idVz = mLabels->scIndex[6 * i + 5];
+		if (idVx == -1 || idVy == -1 || idVz == -1 ||
+			idVx >= len || idVy >= len || idVz >= len) {
+			mScPrevCount[i] = 0;
+			continue;
+		}
+
+		Real dt = dat[0] - mScPrevEpoch[i];
+		if (mScPrevCount[i] > 0 && dt != 0.0) {
+			Real dvx = dat[idVx] - mScPrevVx[i];
+			Real dvy = dat[idVy] - mScPrevVy[i];
+			Real dvz = dat[idVz] - mScPrevVz[i];
+
+			if (mScPrevCount[i] > 1) {
+				Real rx = dvx - mScPrevAx[i] * dt;
+				Real ry = dvy - mScPrevAy[i] * dt;
+				Real rz = dvz - mScPrevAz[i] * dt;
+				if (rx * rx + ry * ry + rz * rz >
+					mAnchorVelocityJump * mAnchorVelocityJump) {
+					jumped[i] = true;
+					anyJump = true;
+				}
+			}
+
+			mScPrevAx[i] = dvx / dt;
+			mScPrevAy[i] = dvy / dt;
+			mScPrevAz[i] = dvz / dt;
+			// the step over a jump says nothing about the acceleration
+			mScPrevCount[i] = jumped[i] ? 1 : 2;
+		}
+		else if (mScPrevCount[i] == 0)
+			mScPrevCount[i] = 1;
+
+		mScPrevEpoch[i] = dat[0];
+		mScPrevVx[i] = dat[idVx];
+		mScPrevVy[i] = dat[idVy];
+		mScPrevVz[i] = dat[idVz];
+	}
+
+	if (!anyJump)
+		return;
+
+	BufferLastRow(jumped);
+	for (Integer i = 0; i < mScCount; i++) {
+		if (jumped[i])
+			mSampleMask[i] = mAnchorMask[i] = true;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// void CaptureSolverRow(const Real *dat, Integer len)
+//------------------------------------------------------------------------------
+/**
+ * Stores a row published while solving in the current solver pass. A pass
+ * begins when solving begins, and whenever the epoch steps back, as each
+ * iteration propagates again from the same initial state. Spacecraft are
+ * sampled at DataCollectFrequency; bodies are the same in every pass and
+ * are not captured.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::CaptureSolverRow(const Real *dat, Integer len)
+{
+	if (!IsInExportWindow(dat[0]))
+		return;
+
+	if (!mSolverPassOpen || dat[0] < mSolverPassEpoch) {
+		mBuffers.BeginSolverPass();
+		mSolverPassOpen = true;
+		mSolverPassRows = 0;
+	}
+	mSolverPassEpoch = dat[0];
+	mSolverPassRows++;
+
+	if ((mSolverPassRows - 1) % mDataCollectFrequency != 0)
+		return;
+
+	UpdateLabelIndexCache();
+	for (Integer i = 0; i < mObjectCount; i++)
+		mSampleMask[i] = i < mScCount && mLabels->present[i];
+
+	BufferSpacecraftData(dat, len);
+	mBuffers.AddSolverRow(dat[0], mScCount, mSampleMask,
+		mScXArray, mScYArray, mScZArray, mScVxArray, mScVyArray, mScVzArray);
+}
+
+
+//------------------------------------------------------------------------------
+// void UpdateLabelIndexCache()
+//------------------------------------------------------------------------------
+/**
+ * Looks up the state labels of every spacecraft once per provider and label
+ * set, instead of six searches per spacecraft per row. Entries are keyed by
+ * provider, but checked against the labels, as the Publisher does not always
+ * assign currentProvider.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::UpdateLabelIndexCache()
+{
+	const StringArray &dataLabels = theDataLabels[0];
+	ProviderLabels &entry = mProviderLabels[currentProvider];
+	mLabels = &entry;
+	if (entry.scIndex.size() == (size_t)(6 * mScCount) && dataLabels == entry.labels)
+		return;
+
+	static const std::string suffix[6] = { ".X", ".Y", ".Z", ".Vx", ".Vy", ".Vz" };
+	entry.labels = dataLabels;
+	entry.scIndex.assign(6 * mScCount, -1);
+	// bodies are computed from their ephemerides, so every row carries them
+	entry.present.assign(mObjectCount, true);
+	for (Integer i = 0; i < mScCount; i++) {
+		for (Integer k = 0; k < 6; k++) {
+			entry.scIndex[6 * i + k] =
+				FindIndexOfElement(entry.labels, mScNameArray[i] + suffix[k]);
+			if (entry.scIndex[6 * i + k] == -1)
+				entry.present[i] = false;
+		}
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// void ExportData()
+//------------------------------------------------------------------------------
+/**
+ * Starts writing the buffered mission data to file. The file is written on
+ * a worker thread, so that several instances write their files at the same
+ * time. The worker only touches this instance's buffers and performance log.
+ * Called twice at end of run; the second call waits for the worker.
+ *
+ * States kept in the published frame are converted to the view frame as
+ * they are written. GMAT's coordinate conversions are not thread safe, so
+ * the view frame is evaluated here, once per epoch of the export, and the
+ * worker converts the samples from that table.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::ExportData()
+{
+	if (mExportRunning) {
+		FinishExport();
+		return;
+	}
+
+	if (!mBuffers.PrepareExport(mScCount, mCbCount, mScNameArray, mCbNameArray, mMaxData))
+		return;
+
+	// spacecraft that no provider published during the run
+	for (Integer i = 0; i < mScCount; i++)
+		isAbsentData = isAbsentData || mObjectRows[i] == 0;
+
+	bool frameConversion = (theDataCoordSystem != NULL && mViewCoordSystem != NULL) &&
+		(mViewCoordSystem != theDataCoordSystem);
+	mPerformanceLog.SetConfiguration(mObjectCount, mExportAttitude, frameConversion);
+	mPerformanceLog.SetBufferUsage(mBuffers.GetSampleCount(), mBuffers.GetBufferBytes());
+	mExportRunning = true;
+
+	if (frameConversion && mDeferViewTransform) {
+		BooleanArray hasAttitude(mObjectCount, false);
+		for (Integer i = 0; i < mScCount; i++)
+			hasAttitude[i] = mObjectArray[i] != NULL && mObjectArray[i]->HasAttitude();
+		for (Integer i = 0; i < mCbCount; i++)
+			hasAttitude[mScCount + i] = mCbArray[i] != NULL && mCbArray[i]->HasAttitude();
+
+		RealArray epochs;
+		mBuffers.GetSampleEpochs(epochs);
+		mExportTransform = new ViewFrameTransform(theDataCoordSystem,
+			mViewCoordSystem, hasAttitude, epochs);
+	}
+	mExportThread = std::thread(&VRInterface::WriteExport, this, mExportTransform);
+}
+
+
+//------------------------------------------------------------------------------
+// void WriteExport(SampleTransform *transform)
+//------------------------------------------------------------------------------
+/**
+ * Writes the buffers and times the export. Runs on the export worker.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::WriteExport(SampleTransform *transform)
+{
+	mPerformanceLog.StartExport();
+	size_t bytesWritten = 0;
+	mExportError = "";
+
+	// an exception must not leave the worker thread
+	try {
+		if (mEnvelopeStep > 0.0)
+			bytesWritten += mBuffers.WriteEnvelope(jsonFileName, mScCount,
+				mScNameArray, mEnvelopeStep, transform);
+		if (mCloseApproachDistance > 0.0)
+			bytesWritten += mBuffers.WriteCloseApproaches(jsonFileName, mScCount,
+				mScNameArray, mCloseApproachDistance);
+		bytesWritten += mBuffers.WriteBuffers(jsonFileName, jstream,
+			mScCount, mCbCount, mScNameArray, mCbNameArray, mSpRadii,
+			mDefaultOrbitColorMap, mExportAttitude, mExportColours,
+			mWindowStart, mWindowStop, transform, mAppendRuns);
+
+		const StringArray &failures = mBuffers.GetWriteFailures();
+		for (size_t k = 0; k < failures.size(); k++)
+			mExportError += (k > 0 ? ", " : "could not write ") + failures[k];
+		if (mExportError == "" && bytesWritten == 0)
+			mExportError = "nothing was written";
+	}
+	catch (BaseException &be) {
+		mExportError = be.GetFullMessage();
+	}
+	catch (std::exception &e) {
+		mExportError = e.what();
+	}
+
+	mExportBytes = bytesWritten;
+	mPerformanceLog.StopExport(bytesWritten);
+}
+
+
+//------------------------------------------------------------------------------
+// void FinishExport()
+//------------------------------------------------------------------------------
+/**
+ * Waits for a running export, then reports it and, if requested, logs the
+ * run's performance and compares it to the baseline. Does nothing if no
+ * export is running.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::FinishExport()
+{
+	if (!mExportRunning)
+		return;
+	if (mExportThread.joinable())
+		mExportThread.join();
+	mExportRunning = false;
+	delete mExportTransform;
+	mExportTransform = NULL;
+
+	if (mExportError != "")
+		MessageInterface::PopupMessage(Gmat::ERROR_, "VRInterface: Export to %s "
+			"failed: %s\n", jsonFileName.c_str(), mExportError.c_str());
+	else
+		MessageInterface::ShowMessage("VRInterface: Mission data exported "
+			"successfully (%lu bytes).\n", (unsigned long)mExportBytes);
+
+	if (mPerformanceLogFile != "") {
+		mPerformanceLog.Write(mPerformanceLogFile);
+		if (mPerformanceBaselineFile != "" &&
+			!mPerformanceLog.CompareToBaseline(mPerformanceBaselineFile, mPerformanceMargin))
+			MessageInterface::PopupMessage(Gmat::WARNING_, "VRInterface performance "
+				"dropped past the baseline margin. See the message window for details.");
+	}
+
+	// buffers are otherwise kept for the next run of the same objects
+	if (mReleaseBuffersAfterRun)
+		mBuffers.ReleaseDynamicBuffers();
+}
+
+
+//------------------------------------------------------------------------------
+// StringArray BuildSampleKeys() const
+//------------------------------------------------------------------------------
+/**
+ * Per object, in buffer order, the settings that decide which of its
+ * samples are stored and in which frame. VRInterface objects giving an
+ * object the same key share its buffers, and the first active one of them
+ * buffers it for all. The rows skipped inside a function depend on every
+ * SpacePoint of the plot, so only plots of the same SpacePoints share.
+ */
+//------------------------------------------------------------------------------
+StringArray VRInterface::BuildSampleKeys() const
+{
+	std::ostringstream common;
+	common << (mDeferViewTransform ? std::string("published") : "view=" + mViewCoordSysName)
+		<< "|" << IsGlobal() << "|" << mPointBudget << "|" << mSolverIterOption
+		<< "|" << std::setprecision(17) << mAnchorVelocityJump << "|" << mExportEpochFormat;
+	StringArray spaceNames(mAllSpNameArray);
+	std::sort(spaceNames.begin(), spaceNames.end());
+	for (size_t k = 0; k < spaceNames.size(); k++)
+		common << (k == 0 ? "|" : ",") << spaceNames[k];
+	for (size_t w = 0; w < mExportStartEpochs.size() && w < mExportStopEpochs.size(); w++)
+		common << "|" << mExportStartEpochs[w] << "," << mExportStopEpochs[w];
+
+	StringArray keys;
+	for (Integer i = 0; i < mObjectCount; i++) {
+		std::ostringstream key;
+		key << mObjectCollectFrequency[i] << "|" << common.str();
+		keys.push_back(key.str());
+	}
+	return keys;
+}
+
+
+//------------------------------------------------------------------------------
+// void BuildExportWindows()
+//------------------------------------------------------------------------------
+/**
+ * Converts the export window epochs from ExportEpochFormat to A1ModJulian,
+ * the time system of the published data. A missing start or stop epoch
+ * leaves that side of the window open.
+ */
+//------------------------------------------------------------------------------
+void VRInterface::BuildExportWindows()
+{
+	mWindowStart.clear();
+	mWindowStop.clear();
+
+	size_t windowCount = std::max(mExportStartEpochs.size(), mExportStopEpochs.size());
+	TimeSystemConverter *timeConverter = TimeSystemConverter::Instance();
+
+	for (size_t w = 0; w < windowCount; w++) {
+		Real start = -std::numeric_limits<Real>::max();
+		Real stop = std::numeric_limits<Real>::max();
+		std::string outStr;
+
+		try
+		{
+			if (w < mExportStartEpochs.size() && mExportStartEpochs[w] != "")
+				timeConverter->Convert(mExportEpochFormat, -999.999, mExportStartEpochs[w],
+					"A1ModJulian", start, outStr);
+			if (w < mExportStopEpochs.size() && mExportStopEpochs[w] != "")
+				timeConverter->Convert(mExportEpochFormat, -999.999, mExportStopEpochs[w],
+					"A1ModJulian", stop, outStr);
+		}
+		catch (BaseException &)
+		{
+			SubscriberException se;
+			se.SetDetails(errorMessageFormat.c_str(),
+				GetEpochStringList(mExportStartEpochs).c_str(),
+				"ExportStartEpoch/ExportStopEpoch",
+				("Valid " + mExportEpochFormat + " epoch").c_str());
+			throw se;
+		}
+
+		if (stop < start) {
+			SubscriberException se;
+			se.SetDetails(errorMessageFormat.c_str(),
+				GetEpochStringList(mExportStopEpochs).c_str(),
+				"ExportStopEpoch", "Epoch after the matching ExportStartEpoch");
+			throw se;
+		}
+
+		mWindowStart.push_back(start);
+		mWindowStop.push_back(stop);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// bool IsInExportWindow(const Real epoch) const
+//------------------------------------------------------------------------------
+/**
+ * @return true if no windows are set, or the epoch lies in any of them
+ */
+//------------------------------------------------------------------------------
+bool VRInterface::IsInExportWindow(const Real epoch) const
+{
+	if (mWindowStart.empty())
+		return true;
+
+	for (size_t w = 0; w < mWindowStart.size(); w++) {
+		if (epoch >= mWindowStart[w] && epoch <= mWindowStop[w])
+			return true;
+	}
+	return false;
+}
+
+
 //------------------------------------------------------------------------------
 // Integer BufferOrbitData(const Real *dat, Integer len)
 //------------------------------------------------------------------------------
@@ -1600,7 +2916,7 @@ bool VRInterface::BufferSpacecraftData(const Real * dat, Integer len)
 	// provider id keep incrementing if data is regisgered and
 	// published inside a GmatFunction
 
-	StringArray dataLabels = theDataLabels[0];
+	// labels are looked up through mLabels, see UpdateLabelIndexCache()
 
 	// method only applies to spacecraft 
 
@@ -1611,13 +2927,19 @@ bool VRInterface::BufferSpacecraftData(const Real * dat, Integer len)
 	for (Integer i = 0; i < mScCount; i++)
 		// iterates for all spacecraft
 	{
-		idX = FindIndexOfElement(dataLabels, mScNameArray[i] + ".X");
-		idY = FindIndexOfElement(dataLabels, mScNameArray[i] + ".Y");
-		idZ = FindIndexOfElement(dataLabels, mScNameArray[i] + ".Z");
+		// skip spacecraft not due for a sample this step
+		if (!mSampleMask[i]) {
+			scIndex++;
+			continue;
+		}
 
-		idVx = FindIndexOfElement(dataLabels, mScNameArray[i] + ".Vx");
-		idVy = FindIndexOfElement(dataLabels, mScNameArray[i] + ".Vy");
-		idVz = FindIndexOfElement(dataLabels, mScNameArray[i] + ".Vz");
+		idX = mLabels->scIndex[6 * i];
+		idY = mLabels->scIndex[6 * i + 1];
+		idZ = mLabels->scIndex[6 * i + 2];
+
+		idVx = mLabels->scIndex[6 * i + 3];
+		idVy = mLabels->scIndex[6 * i + 4];
+		idVz = mLabels->scIndex[6 * i + 5];
 
 		//append quat to this
 
@@ -1628,11 +2950,11 @@ bool VRInterface::BufferSpacecraftData(const Real * dat, Integer len)
 		// this assumes that first 'half' of this array
 		Spacecraft *sc = (Spacecraft*)mObjectArray[i];	
 		// If any of index not found, handle absent data and continue with the next spacecraft
+		// nothing is stored for it, rather than its stale state
 		if (idX == -1 || idY == -1 || idZ == -1 ||
 			idVx == -1 || idVy == -1 || idVz == -1)
 		{
-			isAbsentData = true;
-			mScPrevDataPresent[scIndex] = false;
+			mSampleMask[i] = false;
 			continue;
 		}
 
@@ -1642,7 +2964,9 @@ bool VRInterface::BufferSpacecraftData(const Real * dat, Integer len)
 		// If we convert after current epoch, it will not give correct
 		// results, if origin is spacecraft,
 		// ie, sat->GetMJ2000State(epoch) will not give correct results.
-		if ((theDataCoordSystem != NULL && mViewCoordSystem != NULL) &&
+		// Other frames are converted at export, see ExportData().
+		if (!mDeferViewTransform &&
+			(theDataCoordSystem != NULL && mViewCoordSystem != NULL) &&
 			(mViewCoordSystem != theDataCoordSystem))
 		{
 
@@ -1687,7 +3011,7 @@ bool VRInterface::BufferSpacecraftData(const Real * dat, Integer len)
 			
 			if (sc->HasAttitude()) {
 				Rmatrix33 cosMat = sc->GetAttitude(dat[0]);
-				Rvector quat = AttitudeConversionUtility::ToQuaternion(cosMat);
+				quat = AttitudeConversionUtility::ToQuaternion(cosMat);
 			}
 			else
 				quat = Rvector(4, 0.0, 0.0, 0.0, 1.0);
@@ -1699,23 +3023,7 @@ bool VRInterface::BufferSpacecraftData(const Real * dat, Integer len)
 		mScQArray[Q3][i] = quat[Q3];
 		mScQArray[Q4][i] = quat[Q4];
 
-		mScPrevDataPresent[scIndex] = true;	// consider removing obselete code
-
-	}
-
-	// solver data control for future use -- consider removing
-	if (mSolverIterOption == SI_CURRENT)
-	{
-		// save data when targeting or last iteration
-		if (runstate == Gmat::SOLVING || runstate == Gmat::SOLVEDPASS)
-		{
-			return true; // careful having this here
-		}
 
-		if (runstate == Gmat::SOLVING)
-		{
-			return false;	// solving 
-		}
 	}
 
 	return true;
@@ -1737,6 +3045,10 @@ bool VRInterface::BufferCelestialBodyData(const Real *dat, Integer len)
 	{
 		cbIndex++;
 
+		// skip bodies not due for a sample this step
+		if (!mSampleMask[mScCount + i])
+			continue;
+
 		SpacePoint *cb = mCbArray[i];	// can also try with mObjectArray
 		//SpacePoint *cb = mObjectArray[i + mScCount];
 		Rvector quat;
@@ -1761,7 +3073,8 @@ bool VRInterface::BufferCelestialBodyData(const Real *dat, Integer len)
 		// results, if origin is spacecraft,
 		// ie, cb->GetMJ2000State(epoch) will not give correct results.
 
-		if ((theDataCoordSystem != NULL && mViewCoordSystem != NULL) &&
+		if (!mDeferViewTransform &&
+			(theDataCoordSystem != NULL && mViewCoordSystem != NULL) &&
 			(mViewCoordSystem != theDataCoordSystem)) {
 			CoordinateConverter coordConverter;
 			Rvector6 outState;
@@ -1816,18 +3129,6 @@ bool VRInterface::BufferCelestialBodyData(const Real *dat, Integer len)
 
 	// skipped out Current trajecotry implementation
 
-	// this data control potentially doesn't have to happen as the same check is performed in BufferOrbitData
-
-	if (mSolverIterOption == SI_CURRENT) {
-		// save data when targeting or last iteration
-		if (runstate == Gmat::SOLVING || runstate == Gmat::SOLVEDPASS) {
-			return true; // careful having this here
-		}
-		if (runstate == Gmat::SOLVING) {
-			return false;	// solving 
-		}
-	}
-
 	return true;
 }
 
@@ -1861,6 +3162,67 @@ std::string VRInterface::GetObjectStringList() const
 }
 
 
+//------------------------------------------------------------------------------
+// std::string GetEpochStringList(const StringArray &epochs) const
+//------------------------------------------------------------------------------
+/**
+ * Formats epoch strings into {}, quoted as they may contain blanks.
+ */
+ //------------------------------------------------------------------------------
+std::string VRInterface::GetEpochStringList(const StringArray &epochs) const
+{
+	std::string epochList = "{ ";
+	for (size_t i = 0; i < epochs.size(); i++)
+	{
+		epochList += "'" + epochs[i] + "'";
+		if (i != epochs.size() - 1)
+			epochList += ", ";
+	}
+	epochList += " }";
+	return epochList;
+}
+
+
+//------------------------------------------------------------------------------
+// bool SetEpochStringList(StringArray &epochs, const std::string &value,
+//                         const Integer index = -1)
+//------------------------------------------------------------------------------
+/**
+ * Sets export window epochs from a {} list, or a single epoch at index.
+ * An index of -1 appends the epoch.
+ */
+ //------------------------------------------------------------------------------
+bool VRInterface::SetEpochStringList(StringArray &epochs,
+	const std::string &value, const Integer index)
+{
+	StringArray epochList;
+	if (value != "" && value[0] == '{')
+	{
+		TextParser tp;
+		epochList = tp.SeparateBrackets(value, "{}", ",");
+		epochs.clear();
+	}
+	else
+		epochList.push_back(value);
+
+	for (size_t i = 0; i < epochList.size(); i++)
+	{
+		std::string epoch = GmatStringUtil::Trim(epochList[i]);
+		epoch = GmatStringUtil::RemoveAll(epoch, '\'');
+
+		if (value[0] != '{' && index >= 0)
+		{
+			if ((Integer)epochs.size() <= index)
+				epochs.resize(index + 1);
+			epochs[index] = epoch;
+		}
+		else
+			epochs.push_back(epoch);
+	}
+	return true;
+}
+
+
 //------------------------------------------------------------------------------
 // bool AddSpacePoint(const std::string &name, Integer index, bool show = true)
 //------------------------------------------------------------------------------
@@ -1923,6 +3285,11 @@ bool VRInterface::ClearSpacePointList()
 	mCbArray.clear();
 
 	mSpRadii.clear();
+	mObjectCollectFrequency.clear();
+	mSampleMask.clear();
+	mObjectRows.clear();
+	mAnchorMask.clear();
+	mLastRowStored.clear();
 
 	mScXArray.clear();
 	mScYArray.clear();
@@ -2170,6 +3537,13 @@ Real VRInterface::DeriveScRadius(const Real &scMass, const Real &scaler) {
 //------------------------------------------------------------------------------
 void VRInterface::BuildDynamicArrays()
 {
+	// per-object collect frequencies are given in Add order; key them by
+	// name before FixSpacePointArray can shift that order
+	std::map<std::string, Integer> frequencyMap;
+	for (UnsignedInt i = 0; i < mAllSpNameArray.size() &&
+		i < mObjectCollectFrequencyList.size(); i++)
+		frequencyMap[mAllSpNameArray[i]] = mObjectCollectFrequencyList[i];
+
 	FixSpacePointArray();
 
 	// Build Quaternion arrays
@@ -2204,6 +3578,14 @@ void VRInterface::BuildDynamicArrays()
 				mScQArray[Q4].push_back(0.0);
 
 				mScPrevDataPresent.push_back(false);
+				mScPrevCount.push_back(0);
+				mScPrevEpoch.push_back(0.0);
+				mScPrevVx.push_back(0.0);
+				mScPrevVy.push_back(0.0);
+				mScPrevVz.push_back(0.0);
+				mScPrevAx.push_back(0.0);
+				mScPrevAy.push_back(0.0);
+				mScPrevAz.push_back(0.0);
 
 				// Add to all object list
 				mObjectNameArray.push_back(mAllSpNameArray[i]);
@@ -2282,6 +3664,19 @@ void VRInterface::BuildDynamicArrays()
 	mObjectCount = mObjectNameArray.size();
 	mCbCount = mCbNameArray.size();
 
+	for (int i = 0; i < mObjectCount; i++) {
+		std::map<std::string, Integer>::iterator freq =
+			frequencyMap.find(mObjectNameArray[i]);
+		if (freq != frequencyMap.end() && freq->second > 0)
+			mObjectCollectFrequency.push_back(freq->second);
+		else
+			mObjectCollectFrequency.push_back(mDataCollectFrequency);
+		mSampleMask.push_back(false);
+		mObjectRows.push_back(0);
+		mAnchorMask.push_back(false);
+		mLastRowStored.push_back(false);
+	}
+
 }
 
 
@@ -2300,6 +3695,11 @@ void VRInterface::ClearDynamicArrays()
 	mCbNameArray.clear();
 
 	mSpRadii.clear();
+	mObjectCollectFrequency.clear();
+	mSampleMask.clear();
+	mObjectRows.clear();
+	mAnchorMask.clear();
+	mLastRowStored.clear();
 
 	mScXArray.clear();
 	mScYArray.clear();
@@ -2309,13 +3709,17 @@ void VRInterface::ClearDynamicArrays()
 	mScVzArray.clear();
 	mScQArray.clear();
 	mScPrevDataPresent.clear();
-	//mScPrevEpoch.clear();
+	mScPrevCount.clear();
+	mScPrevEpoch.clear();
 	//mScPrevX.clear();
 	//mScPrevY.clear();
 	//mScPrevZ.clear();
-	//mScPrevVx.clear();
-	//mScPrevVy.clear();
-	//mScPrevVz.clear();
+	mScPrevVx.clear();
+	mScPrevVy.clear();
+	mScPrevVz.clear();
+	mScPrevAx.clear();
+	mScPrevAy.clear();
+	mScPrevAz.clear();
 	//mScPrevQArray.clear();
 
 	mCbXArray.clear();
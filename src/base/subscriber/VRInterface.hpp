@@ -18,12 +18,13 @@
 #include <iomanip>			// for ostringstream
 #include <iostream>			// unsure what for -- check
 #include <string>				// for string::npos
+#include <thread>				// for the export worker
 
 //#include "PlotInterface.hpp"
 #include "CoordinateConverter.hpp"
 //#include "CoordinateSystem.hpp"
-
-// class DataManager;
+#include "PerformanceLog.hpp"
+#include "DataManager.hpp"
 
 class VRInterface_API VRInterface : public Subscriber
 {
@@ -72,6 +73,20 @@ public:
 	virtual Integer      GetIntegerParameter(const std::string &label) const;
 	virtual Integer      SetIntegerParameter(const std::string &label,
 		const Integer value);
+	virtual Integer      GetIntegerParameter(const Integer id,
+		const Integer index) const;
+	virtual Integer      SetIntegerParameter(const Integer id, const Integer value,
+		const Integer index);
+	virtual const IntegerArray&
+		GetIntegerArrayParameter(const Integer id) const;
+	virtual const IntegerArray&
+		GetIntegerArrayParameter(const std::string &label) const;
+
+	virtual Real         GetRealParameter(const Integer id) const;
+	virtual Real         SetRealParameter(const Integer id, const Real value);
+	virtual Real         GetRealParameter(const std::string &label) const;
+	virtual Real         SetRealParameter(const std::string &label,
+		const Real value);
 
 	virtual std::string  GetStringParameter(const Integer id) const;
 	virtual std::string  GetStringParameter(const std::string &label) const;
@@ -135,6 +150,18 @@ public:
 protected:
 	/// Calls PlotInterface for plotting non-solver data  
 	bool         DataControl(const Real *dat, Integer len);
+	/// Writes buffered data at end of run, on a worker thread
+	void         ExportData();
+	/// Waits for the export worker and reports its result
+	void         FinishExport();
+	/// Writes the buffers and times the export
+	void         WriteExport(SampleTransform *transform);
+	/// Per object, the settings under which its buffers can be shared
+	StringArray  BuildSampleKeys() const;
+	/// Converts the export window epochs to A1ModJulian
+	void         BuildExportWindows();
+	/// Checks an epoch against the export windows
+	bool         IsInExportWindow(const Real epoch) const;
 	
 	/// Buffers published spacecraft orbit data
 	virtual bool      BufferSpacecraftData(const Real *dat, Integer len);
@@ -143,6 +170,11 @@ protected:
 
 	/// Returns object string list
 	virtual std::string  GetObjectStringList() const;
+	/// Formats a list of epoch strings into {}
+	std::string          GetEpochStringList(const StringArray &epochs) const;
+	/// Sets export window epoch strings from a {} list or a single value
+	bool                 SetEpochStringList(StringArray &epochs,
+		const std::string &value, const Integer index = -1);
 
 	/// Adds Spacecraft and other objects to object arrays
 	bool                 AddSpacePoint(const std::string &name, Integer index,
@@ -151,6 +183,17 @@ protected:
 	bool                 ClearSpacePointList();
 	/// Removes SpacePoint object from the object called from TakeAction("Remove")
 	bool                 RemoveSpacePoint(const std::string &name);
+	/// Buffers one published row for the objects in the sample mask
+	bool                 BufferRow(const Real *dat, Integer len);
+	/// Stores the previous row as an anchor for the given objects
+	void                 BufferLastRow(const BooleanArray &objects);
+	/// Anchors spacecraft whose velocity jumps between two rows
+	void                 DetectVelocityJumps(const Real *dat, Integer len);
+	/// Stores a row of a solver pass
+	void                 CaptureSolverRow(const Real *dat, Integer len);
+	/// Selects the label indices of the current provider, rebuilding them
+	/// if its data labels changed
+	void                 UpdateLabelIndexCache();
 	/// Finds the index of the element label from the element label array.
 	Integer              FindIndexOfElement(StringArray &labelArray,
 		const std::string &label);
@@ -204,10 +247,20 @@ protected:
 
 	// for data control
 	Integer mDataCollectFrequency;
+	IntegerArray mObjectCollectFrequencyList;	// per object, in Add order
+	IntegerArray mObjectCollectFrequency;		// per object, in buffer order
+	BooleanArray mSampleMask;						// objects sampled this step
+	IntegerArray mObjectRows;						// per object, rows that carried it
 	Integer mNumPointsToRedraw;
 	Integer mNumData;
 	Integer mDataAbsentWarningCount;
 	Integer mMaxData;
+	Real mBufferMemoryLimit;	// MB over all objects, 0 for no limit
+	Integer mPointBudget;		// per object, from MaxDataPoints and memory limit
+	std::string mSpillDirectory;	// memory-mapped buffers go here, "" for memory only
+	bool mCompressBuffers;			// seal samples into compressed blocks
+	std::string mBufferPrecision;	// "Double" or "Single"
+	bool mReleaseBuffersAfterRun;	// otherwise kept for the next run of the same objects
 	bool isAbsentData;
 
 	// arrays for holding distributed data
@@ -227,11 +280,48 @@ protected:
 	RealArray mCbVzArray;
 	RealArray2D mCbQArray;
 
-	// arrays for holding previous distributed data
+	// per spacecraft, whether the previous row carried it
 	BooleanArray mScPrevDataPresent;
 
 	BooleanArray mCbPrevDataPresent;
 
+	// discontinuity anchors: segment ends, velocity jumps, solver passes
+	Real mAnchorVelocityJump;		// km/s not explained by the last acceleration, 0 to disable
+	RealArray mLastData;				// last row passed to DataControl
+	BooleanArray mLastRowStored;	// per object, whether mLastData was buffered
+	BooleanArray mAnchorMask;		// objects whose sample this step is an anchor
+	bool mAnchorNextSample;			// first row of a new segment or solver pass
+	bool mResumeNextSample;			// first row back in an export window
+	Gmat::RunState mLastRunState;
+	IntegerArray mScPrevCount;		// 0 none, 1 velocity, 2 velocity and acceleration
+	RealArray mScPrevEpoch;
+	RealArray mScPrevVx;
+	RealArray mScPrevVy;
+	RealArray mScPrevVz;
+	RealArray mScPrevAx;
+	RealArray mScPrevAy;
+	RealArray mScPrevAz;
+
+	// solver passes, captured apart from the mission trajectory unless
+	// SolverIterations is None
+	Integer mSolverPassLimit;		// passes kept with All; Current keeps one
+	Integer mSolverPassInterval;	// capture every Nth pass
+	bool mSolverPassOpen;			// a pass is being received
+	Real mSolverPassEpoch;			// epoch of its last row
+	Integer mSolverPassRows;		// rows received in it
+
+	// label indices of one publishing provider. Spacecraft propagated by
+	// separate commands or propagators arrive in rows of their own.
+	struct ProviderLabels
+	{
+		StringArray labels;		// label set the indices were found in
+		IntegerArray scIndex;	// X, Y, Z, Vx, Vy, Vz per spacecraft, -1 if absent
+		BooleanArray present;	// per object, whether the provider's rows carry it
+	};
+	std::map<const GmatBase*, ProviderLabels> mProviderLabels;
+	ProviderLabels *mLabels;			// provider of the row being buffered
+	ProviderLabels *mLastRowLabels;	// provider of mLastData
+
 	// maps for object and color
 	// std::map<std::string, UnsignedInt> mCurrentOrbitColorMap;
 	ColorMap mDefaultOrbitColorMap;
@@ -241,14 +331,46 @@ protected:
 	std::map<std::string, bool> mShowObjectMap;
 	std::map<std::string, Real> mScInitialEpochMap;
 
+	// buffered samples of this instance, and the thread writing them out
+	DataManager mBuffers;
+	std::thread mExportThread;
+	bool mExportRunning;			// until FinishExport has reported it
+	size_t mExportBytes;			// written by the last export
+	std::string mExportError;	// why the last export failed, empty if it did not
+	SampleTransform *mExportTransform;	// view frame of the running export, or NULL
+	bool mDeferViewTransform;	// states kept in the published frame until export
+
 	// file management
 	// std::string jsonOutputPath;			// name of output path
 	std::string jsonFileName;				// name of json file
+	bool mAppendRuns;							// runs collect in one container
+	Real mEnvelopeStep;						// seconds; 0 writes no dispersion envelope
+	Integer mEpochIndexBlock;				// samples per epoch index block; 0 for none
+	Real mTileDuration;						// days per tile; 0 writes single files
+	Integer mLodLevels;						// coarser levels per object; 0 for none
+	Real mLodTolerance;						// km, error of the first level
+	Integer mBoundsChunk;					// samples per spatial index chunk; 0 for none
+	Real mCloseApproachDistance;			// km; 0 looks for no close approaches
+	Integer mCompressionLevel;				// zlib level of gzipped output; 0 for plain json
+	bool mExportArrow;						// also write an Arrow IPC file per export
 	// std::string jsonFullPathFileName;	// name and path of file
 	std::ofstream jstream;					// output data stream
 		// this is currently passed to DataManager and not used in this class
 		// consider declaring there instead if optimising 
 
+	// export windows, as given in script and converted to A1ModJulian
+	StringArray mExportStartEpochs;
+	StringArray mExportStopEpochs;
+	std::string mExportEpochFormat;
+	RealArray mWindowStart;
+	RealArray mWindowStop;
+
+	// performance logging, off unless a log file is given
+	PerformanceLog mPerformanceLog;
+	std::string mPerformanceLogFile;
+	std::string mPerformanceBaselineFile;
+	Real mPerformanceMargin;			// allowed relative regression vs baseline
+
 
 
 	/// Enable drawing label for each added spacepoint (for output only)
@@ -268,8 +390,33 @@ protected:
 		SC_RADII,							 ///< Sets the radii of a spacecraft if spherical representation used
 		//MODEL_FILE,							 ///< Sets the model file override for OpenFrames
 		DATA_COLLECT_FREQUENCY,
+		OBJECT_COLLECT_FREQUENCY,		///< Per-object override of DataCollectFrequency
 		MAX_DATA,
+		BUFFER_MEMORY_LIMIT,				///< Memory budget for buffered samples, in MB
+		SPILL_DIRECTORY,					///< Scratch directory for buffers that outgrow memory
+		COMPRESS_BUFFERS,					///< Lossless block compression of buffered samples
+		BUFFER_PRECISION,					///< Double, or Single for float32 storage
+		RELEASE_BUFFERS_AFTER_RUN,		///< Free buffer memory at the end of each run
 		JSON_FILE,							///< Path of JSON file
+		APPEND_RUNS,						///< Add each run to a container at JSON_FILE
+		ENVELOPE_STEP,						///< Epoch step of the dispersion envelope over runs
+		EPOCH_INDEX_BLOCK,				///< Samples per block of the epoch index
+		TILE_DURATION,						///< Days per tile of a tiled export
+		LOD_LEVELS,							///< Coarser levels of detail written per object
+		LOD_TOLERANCE,						///< Position error of the first level, doubling per level
+		BOUNDS_CHUNK,						///< Samples per chunk of the spatial index
+		CLOSE_APPROACH_DISTANCE,		///< Spacecraft closer than this are reported
+		COMPRESSION_LEVEL,				///< zlib level of gzipped output, 0 for plain json
+		EXPORT_ARROW,						///< Also write the samples as an Arrow IPC file
+		PERFORMANCE_LOG_FILE,			///< Appends timing and memory results per run
+		PERFORMANCE_BASELINE_FILE,		///< Earlier log to compare results against
+		PERFORMANCE_MARGIN,				///< Allowed regression before warning
+		EXPORT_START_EPOCH,				///< Start epochs of the export windows
+		EXPORT_STOP_EPOCH,				///< Stop epochs of the export windows
+		EXPORT_EPOCH_FORMAT,				///< Time format of the window epochs
+		ANCHOR_VELOCITY_JUMP,			///< Velocity change that marks a discontinuity
+		SOLVER_PASS_LIMIT,				///< Solver passes kept when SolverIterations is All
+		SOLVER_PASS_INTERVAL,			///< Capture every Nth solver pass
 		VRInterfaceParamCount,			 ///< Count of the parameters for this class
 	};
 
@@ -0,0 +1,27 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  MessageInterface
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements the stand-in MessageInterface
+
+#include "MessageInterface.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+void MessageInterface::ShowMessage(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+void MessageInterface::PopupMessage(Gmat::MessageType /*msgType*/,
+	const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
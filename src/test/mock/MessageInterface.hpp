@@ -0,0 +1,21 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  MessageInterface
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Stand-in for the GMAT header of the same name, for the test suites.
+// Messages go to standard output.
+
+#ifndef MessageInterface_hpp
+#define MessageInterface_hpp
+
+#include "gmatdefs.hpp"
+
+namespace MessageInterface
+{
+	void ShowMessage(const char *format, ...);
+	void PopupMessage(Gmat::MessageType msgType, const char *format, ...);
+}
+
+#endif
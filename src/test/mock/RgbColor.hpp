@@ -0,0 +1,30 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  RgbColor
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Stand-in for the GMAT header of the same name, for the test suites.
+// Colours are packed as in GMAT, red in the low byte.
+
+#ifndef RgbColor_hpp
+#define RgbColor_hpp
+
+#include "gmatdefs.hpp"
+
+class RgbColor
+{
+public:
+	RgbColor(const UnsignedInt intColor = 0) : mIntColor(intColor) {}
+
+	Byte Red() const { return (Byte)(mIntColor & 0xFF); }
+	Byte Green() const { return (Byte)((mIntColor >> 8) & 0xFF); }
+	Byte Blue() const { return (Byte)((mIntColor >> 16) & 0xFF); }
+	Byte Alpha() const { return (Byte)((mIntColor >> 24) & 0xFF); }
+	UnsignedInt GetIntColor() const { return mIntColor; }
+
+protected:
+	UnsignedInt mIntColor;
+};
+
+#endif
@@ -0,0 +1,43 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  gmatdefs
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Stand-in for the GMAT header of the same name, for the test suites.
+// Only the types the buffering and export code uses are declared, with
+// GMAT's definitions.
+
+#ifndef gmatdefs_hpp
+#define gmatdefs_hpp
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+typedef double Real;
+typedef int Integer;
+typedef unsigned char Byte;
+typedef unsigned int UnsignedInt;
+
+typedef std::vector<Real> RealArray;
+typedef std::vector<Integer> IntegerArray;
+typedef std::vector<UnsignedInt> UnsignedIntArray;
+typedef std::vector<std::string> StringArray;
+typedef std::vector<bool> BooleanArray;
+typedef std::map<std::string, UnsignedInt> ColorMap;
+
+namespace Gmat
+{
+	enum MessageType
+	{
+		ERROR_ = 10,
+		WARNING_,
+		INFO_,
+		DEBUG_,
+		GENERAL_
+	};
+}
+
+#endif
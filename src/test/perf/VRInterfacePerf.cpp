@@ -0,0 +1,208 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  VRInterfacePerf
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Performance suite for the buffering and export paths, built on stand-in
+// GMAT types. One run buffers a synthetic mission row by row and writes it,
+// as VRInterface does at the end of a run. It then appends its
+// PerformanceLog line to a results file and compares it with a baseline:
+//
+//    VRInterfacePerf objects samples attitude frame results [baseline margin]
+//
+// samples is the count per object. attitude and frame are 0 or 1; frame
+// converts every sample to a rotating frame as it is written, as
+// VRInterface maps samples into its view frame. Short runs are repeated for
+// at least MIN_SECONDS, and the fastest one is logged, so that they are not
+// lost in timer noise. The exit code is 1 when the run regressed past the
+// margin, and 2 on bad arguments.
+
+#include "DataManager.hpp"
+#include "PerformanceLog.hpp"
+#include "MessageInterface.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>			// for remove()
+#include <cstdlib>			// for atoi(), atof()
+
+namespace
+{
+	const Real STEP_DAYS = 60.0 / 86400.0;
+	const Real START_EPOCH = 25000.0;
+	const Real EARTH_MU = 398600.4418;
+	// repeats of a short run: at least this long, and at most this many
+	const Real MIN_SECONDS = 0.5;
+	const Integer MAX_REPEATS = 20;
+
+	// stands in for a CoordinateConverter: rotates states and attitudes
+	// about z, at a rate that grows with the epoch
+	class RotatingFrame : public SampleTransform
+	{
+	public:
+		virtual void Apply(const Integer /*spIndex*/, const Real epoch,
+			Real *state, Real *quat) {
+			Real angle = 0.5 * (epoch - START_EPOCH);
+			Real c = std::cos(angle), s = std::sin(angle);
+			for (Integer k = 0; k < 6; k += 3) {
+				Real x = state[k], y = state[k + 1];
+				state[k] = c * x + s * y;
+				state[k + 1] = -s * x + c * y;
+			}
+
+			// composed with the frame's rotation, scalar last
+			Real hc = std::cos(0.5 * angle), hs = -std::sin(0.5 * angle);
+			Real q1 = quat[Q1], q2 = quat[Q2], q3 = quat[Q3], q4 = quat[Q4];
+			quat[Q1] = hc * q1 - hs * q2;
+			quat[Q2] = hc * q2 + hs * q1;
+			quat[Q3] = hc * q3 + hs * q4;
+			quat[Q4] = hc * q4 - hs * q3;
+		}
+	};
+
+	// spacecraft on circular orbits of their own radius and phase
+	struct Mission
+	{
+		StringArray names;
+		RealArray radius, rate, phase;
+		RealArray spRadii;
+		ColorMap orbitColourMap;
+		Integer rowCount;
+	};
+
+	// buffers and writes the mission once
+	// Returns the seconds taken, and sets written false if the export failed
+	Real RunMission(const Mission &mission, const bool exportAttitude,
+		const bool frameConversion, const std::string &jsonPath,
+		PerformanceLog &log, bool &written) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const Integer objectCount = (Integer)mission.names.size();
+		DataManager buffers;
+		buffers.BuildDynamicBuffers(mission.names);
+		log.Reset();
+		log.SetConfiguration(objectCount, exportAttitude, frameConversion);
+
+		// each row is built ahead of the timed call, as the published data is
+		RealArray x(objectCount), y(objectCount), z(objectCount);
+		RealArray vx(objectCount), vy(objectCount), vz(objectCount);
+		RealArray2D q(4, RealArray(objectCount));
+		RealArray none;
+		RealArray2D noQuat(4);
+		StringArray noNames;
+		BooleanArray sampled(objectCount, true), anchor(objectCount, false);
+		const Integer maxData = mission.rowCount + 1;
+
+		for (Integer n = 0; n < mission.rowCount; n++) {
+			Real seconds = n * STEP_DAYS * 86400.0;
+			for (Integer i = 0; i < objectCount; i++) {
+				Real u = mission.rate[i] * seconds + mission.phase[i];
+				Real c = std::cos(u), s = std::sin(u);
+				x[i] = mission.radius[i] * c;
+				y[i] = mission.radius[i] * s;
+				z[i] = 0.0;
+				vx[i] = -mission.radius[i] * mission.rate[i] * s;
+				vy[i] = mission.radius[i] * mission.rate[i] * c;
+				vz[i] = 0.0;
+				q[Q1][i] = 0.0;
+				q[Q2][i] = 0.0;
+				q[Q3][i] = std::sin(0.5 * u);
+				q[Q4][i] = std::cos(0.5 * u);
+			}
+
+			log.StartIngest();
+			buffers.AddToBuffer(START_EPOCH + n * STEP_DAYS, objectCount, 0,
+				mission.names, noNames, x, y, z, vx, vy, vz, q,
+				none, none, none, none, none, none, noQuat,
+				sampled, anchor, false, 0, true, maxData);
+			log.StopIngest(true);
+		}
+		log.SetBufferUsage(buffers.GetSampleCount(), buffers.GetBufferBytes());
+
+		// the export as VRInterface writes it; the file itself is not kept
+		RotatingFrame frame;
+		std::ofstream jstream;
+		RealArray windowStart, windowStop;
+		log.StartExport();
+		size_t bytesWritten = 0;
+		if (buffers.PrepareExport(objectCount, 0, mission.names, noNames, maxData))
+			bytesWritten = buffers.WriteBuffers(jsonPath, jstream, objectCount, 0,
+				mission.names, noNames, mission.spRadii, mission.orbitColourMap,
+				exportAttitude, true, windowStart, windowStop,
+				frameConversion ? &frame : NULL);
+		log.StopExport(bytesWritten);
+		remove(jsonPath.c_str());
+		buffers.ReleaseDynamicBuffers();
+
+		written = bytesWritten > 0 && buffers.GetWriteFailures().empty();
+		std::chrono::duration<Real> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main(int argc, char *argv[]) {
+	if (argc != 6 && argc != 8) {
+		MessageInterface::ShowMessage("Usage: VRInterfacePerf objects samples "
+			"attitude frame results [baseline margin]\n");
+		return 2;
+	}
+
+	const Integer objectCount = atoi(argv[1]);
+	const Integer sampleCount = atoi(argv[2]);
+	const bool exportAttitude = atoi(argv[3]) != 0;
+	const bool frameConversion = atoi(argv[4]) != 0;
+	const std::string resultsFileName = argv[5];
+
+	Mission mission;
+	mission.rowCount = sampleCount;
+	if (objectCount < 1 || mission.rowCount < 2) {
+		MessageInterface::ShowMessage("VRInterfacePerf: needs at least one "
+			"object and two samples each\n");
+		return 2;
+	}
+	for (Integer i = 0; i < objectCount; i++) {
+		char name[32];
+		sprintf(name, "Sat%d", i + 1);
+		mission.names.push_back(name);
+		mission.orbitColourMap[name] = 0x00FF8000 + i;
+		Real radius = 7000.0 + 10.0 * i;
+		mission.radius.push_back(radius);
+		mission.rate.push_back(std::sqrt(EARTH_MU / (radius * radius * radius)));
+		mission.phase.push_back(0.01 * i);
+		mission.spRadii.push_back(1.0);
+	}
+
+	char jsonFileName[64];
+	sprintf(jsonFileName, "perf_%d_%d_%d_%d.json", objectCount, sampleCount,
+		exportAttitude ? 1 : 0, frameConversion ? 1 : 0);
+	const std::string jsonPath = resultsFileName.substr(0,
+		resultsFileName.find_last_of("/\\") + 1) + jsonFileName;
+
+	PerformanceLog log, fastest;
+	Real total = 0.0, best = 0.0;
+	for (Integer repeat = 0; repeat == 0 ||
+		(total < MIN_SECONDS && repeat < MAX_REPEATS); repeat++) {
+		bool written;
+		Real seconds = RunMission(mission, exportAttitude, frameConversion,
+			jsonPath, log, written);
+		if (!written) {
+			MessageInterface::ShowMessage("VRInterfacePerf: the export to %s "
+				"failed\n", jsonPath.c_str());
+			return 1;
+		}
+		if (repeat == 0 || seconds < best) {
+			best = seconds;
+			fastest = log;
+		}
+		total += seconds;
+	}
+
+	fastest.Write(resultsFileName);
+	if (argc == 8 && !fastest.CompareToBaseline(argv[6], atof(argv[7])))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,281 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ArrowTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// The Arrow export must be a readable IPC file: the magic at both ends, a
+// footer whose schema names the columns with their types, a dictionary of
+// the objects, and one record batch per object whose row count, indices
+// and Float64 values are the samples. The file is read here from the
+// format's own description, with a small flatbuffer reader, both as
+// buffered and through a transform spanning several write stretches.
+
+#include "TestMission.hpp"
+#include "UnitTest.hpp"
+
+#include <cstdio>			// for remove(), sprintf()
+#include <cstring>			// for memcpy()
+
+namespace
+{
+	// Type and MessageHeader union members, and Precision, of the format
+	enum { TYPE_FLOATING_POINT = 3, TYPE_UTF8 = 5 };
+	enum { HEADER_DICTIONARY_BATCH = 2, HEADER_RECORD_BATCH = 3 };
+	const Integer PRECISION_DOUBLE = 2;
+
+	// reads little endian flatbuffer tables out of a file held whole
+	class FlatReader
+	{
+	public:
+		FlatReader(const std::string &data) : mData(data) {}
+
+		long long Get(const size_t position, const size_t size) const {
+			if (position + size > mData.size())
+				return 0;
+			long long value = 0;
+			for (size_t k = size; k > 0; k--)
+				value = (value << 8) | (unsigned char)mData[position + k - 1];
+			return value;
+		}
+
+		// position of a field of the table at table, or 0 when absent
+		size_t Field(const size_t table, const Integer id) const {
+			size_t vtable = table - (int)Get(table, 4);
+			size_t slot = 4 + 2 * id;
+			if (slot >= (size_t)Get(vtable, 2))
+				return 0;
+			size_t offset = (size_t)Get(vtable + slot, 2);
+			return offset == 0 ? 0 : table + offset;
+		}
+
+		long long Scalar(const size_t table, const Integer id, const size_t size) const {
+			size_t field = Field(table, id);
+			return field == 0 ? 0 : Get(field, size);
+		}
+
+		// table, vector or string an offset field refers to, or 0
+		size_t Target(const size_t table, const Integer id) const {
+			size_t field = Field(table, id);
+			return field == 0 ? 0 : field + (size_t)Get(field, 4);
+		}
+
+		std::string String(const size_t position) const {
+			return mData.substr(position + 4, (size_t)Get(position, 4));
+		}
+
+		// element k of a vector of offsets
+		size_t Element(const size_t vector, const size_t k) const {
+			size_t at = vector + 4 + 4 * k;
+			return at + (size_t)Get(at, 4);
+		}
+
+	protected:
+		const std::string &mData;
+	};
+
+	// a message framed in the file: its flatbuffer and its body
+	struct Message
+	{
+		size_t header;
+		Integer headerType;
+		size_t body;
+		size_t bodyLength;
+	};
+
+	// @block the footer's Block struct of the message
+	bool ReadMessage(const FlatReader &reader, const size_t block, Message &message) {
+		size_t offset = (size_t)reader.Get(block, 8);
+		size_t metaDataLength = (size_t)reader.Get(block + 8, 4);
+		message.bodyLength = (size_t)reader.Get(block + 16, 8);
+		if (reader.Get(offset, 4) != 0xFFFFFFFF || metaDataLength % 8 != 0)
+			return false;
+		size_t root = offset + 8;
+		size_t table = root + (size_t)reader.Get(root, 4);
+		message.headerType = (Integer)reader.Scalar(table, 1, 1);
+		message.header = reader.Target(table, 2);
+		message.body = offset + metaDataLength;
+		return reader.Scalar(table, 3, 8) == (long long)message.bodyLength &&
+			message.header != 0;
+	}
+
+	// the data of buffer k of a record batch
+	bool BufferAt(const FlatReader &reader, const size_t batch,
+		const Message &message, const size_t k, size_t &data, size_t &length) {
+		size_t buffers = reader.Target(batch, 2);
+		if (buffers == 0 || k >= (size_t)reader.Get(buffers, 4))
+			return false;
+		size_t offset = (size_t)reader.Get(buffers + 4 + 16 * k, 8);
+		length = (size_t)reader.Get(buffers + 12 + 16 * k, 8);
+		data = message.body + offset;
+		return offset % 8 == 0 && offset + length <= message.bodyLength;
+	}
+
+	Real ValueAt(const std::string &file, const size_t position) {
+		Real value;
+		std::memcpy(&value, &file[position], sizeof(value));
+		return value;
+	}
+
+	// a transform that moves every column it may, by known amounts
+	class ShiftTransform : public SampleTransform
+	{
+	public:
+		virtual void Apply(const Integer spIndex, const Real epoch,
+			Real *state, Real *quat) {
+			state[0] += 100.0 * (spIndex + 1);
+			state[4] = -state[4];
+			quat[0] = state[1];
+		}
+	};
+
+	// what column c of the sample of object on row should hold
+	Real Expected(const size_t c, const Integer object, const Integer row,
+		const bool shifted) {
+		Real values[] = { TestMission::Epoch(row),
+			TestMission::PositionX(object, row), (Real)row, (Real)object,
+			1.0, 2.0, 3.0, 0.0, 0.0, 0.0, 1.0 };
+		if (shifted) {
+			values[1] += 100.0 * (object + 1);
+			values[5] = -values[5];
+			values[7] = row;
+		}
+		return values[c];
+	}
+
+	void CheckFile(const std::string &fileName, const TestMission::Mission &mission,
+		const bool shifted) {
+		const std::string label = shifted ? "transformed file" : "file";
+		const std::string file = TestMission::ReadFile(fileName);
+		const char *columnNames[] = { "object", "epoch", "x", "y", "z", "vx",
+			"vy", "vz", "q1", "q2", "q3", "q4" };
+		const size_t columnCount = sizeof(columnNames) / sizeof(columnNames[0]);
+		if (!UnitTest::Check(file.size() > 24 && file.compare(0, 8,
+			std::string("ARROW1\0\0", 8)) == 0 && file.compare(file.size() - 6, 6,
+			"ARROW1") == 0, label + ": no magic at the ends"))
+			return;
+
+		FlatReader reader(file);
+		size_t footerLength = (size_t)reader.Get(file.size() - 10, 4);
+		if (!UnitTest::Check(footerLength + 18 < file.size(),
+			label + ": footer length past the file"))
+			return;
+		size_t root = file.size() - 10 - footerLength;
+		size_t footer = root + (size_t)reader.Get(root, 4);
+
+		// the schema
+		size_t fields = reader.Target(reader.Target(footer, 1), 1);
+		if (!UnitTest::Check(fields != 0 && reader.Get(fields, 4) == (long long)columnCount,
+			label + ": schema has another column count"))
+			return;
+		for (size_t c = 0; c < columnCount; c++) {
+			size_t field = reader.Element(fields, c);
+			Integer typeType = (Integer)reader.Scalar(field, 2, 1);
+			UnitTest::Check(reader.String(reader.Target(field, 0)) == columnNames[c],
+				label + ": column " + columnNames[c] + " misnamed");
+			if (c == 0)
+				UnitTest::Check(typeType == TYPE_UTF8 && reader.Target(field, 4) != 0,
+					label + ": object column not a dictionary of strings");
+			else
+				UnitTest::Check(typeType == TYPE_FLOATING_POINT && reader.Scalar(
+					reader.Target(field, 3), 0, 2) == PRECISION_DOUBLE,
+					label + ": column " + columnNames[c] + " not Float64");
+		}
+
+		// the dictionary of objects
+		size_t dictionaries = reader.Target(footer, 2);
+		Message message;
+		if (!UnitTest::Check(reader.Get(dictionaries, 4) == 1 &&
+			ReadMessage(reader, dictionaries + 4, message) &&
+			message.headerType == HEADER_DICTIONARY_BATCH,
+			label + ": no dictionary batch"))
+			return;
+		size_t batch = reader.Target(message.header, 1);
+		size_t offsets, offsetsLength, text, textLength;
+		if (UnitTest::Check(BufferAt(reader, batch, message, 1, offsets, offsetsLength) &&
+			BufferAt(reader, batch, message, 2, text, textLength) &&
+			reader.Scalar(batch, 0, 8) == (long long)mission.names.size(),
+			label + ": dictionary buffers unreadable")) {
+			for (size_t i = 0; i < mission.names.size(); i++) {
+				size_t from = (size_t)reader.Get(offsets + 4 * i, 4);
+				size_t to = (size_t)reader.Get(offsets + 4 * i + 4, 4);
+				UnitTest::Check(file.substr(text + from, to - from) == mission.names[i],
+					label + ": dictionary misnames " + mission.names[i]);
+			}
+		}
+
+		// a record batch per object, holding its samples
+		size_t batches = reader.Target(footer, 3);
+		if (!UnitTest::Check(batches != 0 &&
+			reader.Get(batches, 4) == (long long)mission.names.size(),
+			label + ": another record batch count"))
+			return;
+		for (size_t i = 0; i < mission.names.size(); i++) {
+			const std::string object = label + ", " + mission.names[i];
+			const IntegerArray &rows = mission.rows[i];
+			if (!UnitTest::Check(ReadMessage(reader, batches + 4 + 24 * i, message) &&
+				message.headerType == HEADER_RECORD_BATCH,
+				object + ": record batch unreadable"))
+				continue;
+			batch = message.header;
+			if (!UnitTest::Check(reader.Scalar(batch, 0, 8) == (long long)rows.size(),
+				object + ": batch has another row count"))
+				continue;
+
+			size_t data, length;
+			bool indexed = BufferAt(reader, batch, message, 1, data, length) &&
+				length == 4 * rows.size();
+			for (size_t j = 0; j < rows.size() && indexed; j++)
+				indexed = reader.Get(data + 4 * j, 4) == (long long)i;
+			UnitTest::Check(indexed, object + ": rows indexed to another object");
+
+			for (size_t c = 1; c < columnCount; c++) {
+				if (!UnitTest::Check(BufferAt(reader, batch, message, 2 * c + 1,
+					data, length) && length == sizeof(Real) * rows.size(),
+					object + ": column " + columnNames[c] + " of another length"))
+					continue;
+				for (size_t j = 0; j < rows.size(); j++) {
+					Real expected = Expected(c - 1, (Integer)i, rows[j], shifted);
+					if (ValueAt(file, data + sizeof(Real) * j) != expected) {
+						char what[160];
+						sprintf(what, "%s: %s of row %d is %.17g, not %.17g",
+							object.c_str(), columnNames[c], rows[j],
+							ValueAt(file, data + sizeof(Real) * j), expected);
+						UnitTest::Check(false, what);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	void TestExport() {
+		// past the 4096 samples WriteArrow streams at a time
+		TestMission::Mission mission = TestMission::Build(2, 9000);
+		DataManager buffers;
+		buffers.SetArrowExport(true);
+		TestMission::Export(buffers, mission, "ArrowTest.json");
+		CheckFile("ArrowTest.arrow", mission, false);
+
+		ShiftTransform transform;
+		DataManager transformed;
+		transformed.SetArrowExport(true);
+		TestMission::Export(transformed, mission, "ArrowTestShifted.json", false,
+			&transform);
+		CheckFile("ArrowTestShifted.arrow", mission, true);
+
+		remove("ArrowTest.json");
+		remove("ArrowTest.arrow");
+		remove("ArrowTestShifted.json");
+		remove("ArrowTestShifted.arrow");
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestExport();
+	return UnitTest::Result("ArrowTest");
+}
@@ -0,0 +1,225 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ColumnCodecTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Compressed buffers must be lossless: every value that goes through
+// ColumnCodec, alone or inside a compressed SampleColumn, must come back
+// with the same bit pattern. Values are compared with memcmp, so NaN
+// payloads and the sign of zero count.
+
+#include "ColumnCodec.hpp"
+#include "SampleColumn.hpp"
+#include "UnitTest.hpp"
+
+#include <cstdio>			// for sprintf()
+#include <cstring>			// for memcpy(), memcmp()
+#include <limits>
+
+namespace
+{
+	typedef unsigned long long Bits;
+
+	Real FromBits(const Bits bits) {
+		Real value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	bool SameBits(const Real *a, const Real *b, const size_t count) {
+		return count == 0 || std::memcmp(a, b, count * sizeof(Real)) == 0;
+	}
+
+	// xorshift, so that runs repeat on every platform
+	class BitSource
+	{
+	public:
+		BitSource() : mState(0x9E3779B97F4A7C15ULL) {}
+		Bits Next() {
+			mState ^= mState << 13;
+			mState ^= mState >> 7;
+			mState ^= mState << 17;
+			return mState;
+		}
+	private:
+		Bits mState;
+	};
+
+	// encodes and decodes one block
+	// Returns the predictor order chosen, or -1 when a value changed
+	Integer RoundTrip(const RealArray &values, const std::string &label) {
+		std::vector<unsigned char> encoded;
+		ColumnCodec::EncodeBlock(values.data(), values.size(), encoded);
+		RealArray decoded(values.size());
+		if (!values.empty())
+			ColumnCodec::DecodeBlock(encoded.data(), values.size(), decoded.data());
+		if (!UnitTest::Check(SameBits(values.data(), decoded.data(), values.size()),
+			label + ": block changed in the round trip"))
+			return -1;
+		return encoded.empty() ? 0 : encoded[0];
+	}
+
+	// bit patterns that are polynomials in the sample number, each coded
+	// exactly by one predictor order, and for order 0 zeros between noisy
+	// denormals, which no prediction helps
+	RealArray OrderInput(const Integer order, const size_t count) {
+		const Bits base = 0x40BB580000000000ULL;	// 7000.0
+		BitSource source;
+		RealArray values(count);
+		for (size_t k = 0; k < count; k++) {
+			Bits n = k;
+			switch (order) {
+				case 0: values[k] = FromBits(k % 2 == 0 ? 0 : source.Next() >> 24); break;
+				case 1: values[k] = FromBits(base); break;
+				case 2: values[k] = FromBits(base + 977 * n); break;
+				case 3: values[k] = FromBits(base + 31 * n * n); break;
+				default: values[k] = FromBits(base + 3 * n * n * n); break;
+			}
+		}
+		return values;
+	}
+
+	void TestOrders() {
+		for (Integer order = 0; order <= 4; order++) {
+			char label[64];
+			sprintf(label, "order %d", order);
+			Integer chosen = RoundTrip(OrderInput(order, ColumnCodec::BLOCK_SIZE),
+				label);
+			sprintf(label, "order %d: coded with order %d", order, chosen);
+			UnitTest::Check(chosen == order, label);
+		}
+	}
+
+	void TestSpecialValues() {
+		const Real nan = std::numeric_limits<Real>::quiet_NaN();
+		const Real inf = std::numeric_limits<Real>::infinity();
+		const Real denorm = std::numeric_limits<Real>::denorm_min();
+		RealArray special;
+		special.push_back(0.0);
+		special.push_back(-0.0);
+		special.push_back(nan);
+		special.push_back(-nan);
+		special.push_back(FromBits(0x7FF0000000000001ULL));	// signalling NaN
+		special.push_back(FromBits(0x7FF8DEADBEEF0001ULL));	// NaN with payload
+		special.push_back(inf);
+		special.push_back(-inf);
+		special.push_back(denorm);
+		special.push_back(-denorm);
+		special.push_back(FromBits(0x000FFFFFFFFFFFFFULL));	// largest denormal
+		special.push_back(std::numeric_limits<Real>::min());
+		special.push_back(std::numeric_limits<Real>::max());
+		special.push_back(-std::numeric_limits<Real>::max());
+		RoundTrip(special, "special values");
+
+		// the same values inside smooth runs, where high orders are chosen
+		for (Integer order = 1; order <= 4; order++) {
+			RealArray values = OrderInput(order, 300);
+			for (size_t k = 0; k < special.size(); k++)
+				values[20 * k + 7] = special[k];
+			char label[64];
+			sprintf(label, "special values in order %d input", order);
+			RoundTrip(values, label);
+		}
+	}
+
+	// blocks shorter than the predictor order, and partial last blocks
+	void TestShortBlocks() {
+		const size_t counts[] = { 0, 1, 2, 3, 4, 5, 7, 1000, 1023 };
+		for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+			for (Integer order = 0; order <= 4; order++) {
+				char label[64];
+				sprintf(label, "%lu samples of order %d input",
+					(unsigned long)counts[c], order);
+				RoundTrip(OrderInput(order, counts[c]), label);
+			}
+		}
+
+		// blocks appended one after another decode from their own offsets
+		RealArray first = OrderInput(3, ColumnCodec::BLOCK_SIZE);
+		RealArray last = OrderInput(0, 37);
+		std::vector<unsigned char> encoded;
+		ColumnCodec::EncodeBlock(first.data(), first.size(), encoded);
+		size_t offset = encoded.size();
+		ColumnCodec::EncodeBlock(last.data(), last.size(), encoded);
+		RealArray decoded(last.size());
+		ColumnCodec::DecodeBlock(&encoded[offset], last.size(), decoded.data());
+		UnitTest::Check(SameBits(last.data(), decoded.data(), last.size()),
+			"second block changed in the round trip");
+	}
+
+	// a compressed column spanning sealed blocks and an open one
+	void CheckColumn(const SampleColumn &column, const RealArray &expected,
+		const std::string &label) {
+		if (!UnitTest::Check(column.size() == expected.size(),
+			label + ": wrong size"))
+			return;
+		RealArray stored(column.size());
+		for (size_t k = 0; k < column.size(); k++)
+			stored[k] = column[k];
+		UnitTest::Check(SameBits(stored.data(), expected.data(), expected.size()),
+			label + ": values changed");
+	}
+
+	void TestCompressedColumn() {
+		// smooth states with the special values scattered through them
+		RealArray values = OrderInput(4, 2 * ColumnCodec::BLOCK_SIZE + 500);
+		RealArray noise(values.size());
+		BitSource source;
+		for (size_t k = 0; k < noise.size(); k++)
+			noise[k] = FromBits(source.Next());
+		for (size_t k = 0; k < values.size(); k += 97)
+			values[k] = noise[k];
+		values[5] = -0.0;
+		values[1500] = std::numeric_limits<Real>::denorm_min();
+		values[2047] = std::numeric_limits<Real>::quiet_NaN();
+
+		SampleColumn column;
+		column.SetCompressed(true);
+		for (size_t k = 0; k < values.size(); k++)
+			column.push_back(values[k]);
+		UnitTest::Check(column.IsCompressed(), "column not compressed");
+		CheckColumn(column, values, "compressed column");
+
+		// halving as DecimateBuffer does, with the last sample kept
+		std::vector<size_t> keep;
+		RealArray kept;
+		for (size_t k = 0; k < values.size(); k++) {
+			if (k % 2 == 0 || k % 97 == 0 || k == values.size() - 1) {
+				keep.push_back(k);
+				kept.push_back(values[k]);
+			}
+		}
+		column.Compact(keep);
+		CheckColumn(column, kept, "compacted column");
+
+		// samples appended after the compaction go on from there
+		for (size_t k = 0; k < 1500; k++) {
+			column.push_back(noise[k]);
+			kept.push_back(noise[k]);
+		}
+		CheckColumn(column, kept, "column refilled after compaction");
+
+		// a reordering, as OrderBuffer does
+		keep.clear();
+		RealArray reversed;
+		for (size_t k = kept.size(); k > 0; k--) {
+			keep.push_back(k - 1);
+			reversed.push_back(kept[k - 1]);
+		}
+		column.Compact(keep);
+		CheckColumn(column, reversed, "reordered column");
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestOrders();
+	TestSpecialValues();
+	TestShortBlocks();
+	TestCompressedColumn();
+	return UnitTest::Result("ColumnCodecTest");
+}
@@ -0,0 +1,171 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  DecimationTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Progressive decimation keeps every anchor: an elliptical orbit is buffered
+// far past its point budget, and each anchor epoch must still be in the
+// track, flagged, after the repeated halvings. Anchors sparse enough for the
+// budget keep the track within it; anchors that alone fill it let the track
+// grow past it.
+
+#include "DataManager.hpp"
+#include "UnitTest.hpp"
+
+#include <cmath>
+#include <cstdio>			// for sprintf()
+#include <set>
+
+namespace
+{
+	const Real START_EPOCH = 25000.0;
+	const Real STEP_DAYS = 60.0 / 86400.0;
+
+	// gives the tests the tracks behind the buffers
+	class TrackedBuffers : public DataManager
+	{
+	public:
+		const SampleTrack& Track(const Integer spIndex) const {
+			return *storedSpTrack[spIndex];
+		}
+	};
+
+	// position and velocity on an ellipse, so that the radius has extremes
+	void OrbitState(const Integer n, Real *state) {
+		Real u = 0.01 * n;
+		state[0] = 9000.0 * std::cos(u) - 2000.0;
+		state[1] = 8000.0 * std::sin(u);
+		state[2] = 0.0;
+		state[3] = -90.0 * std::sin(u);
+		state[4] = 80.0 * std::cos(u);
+		state[5] = 0.0;
+	}
+
+	Real Epoch(const Integer n) {
+		return START_EPOCH + n * STEP_DAYS;
+	}
+
+	// every epoch of anchors must be in the track, flagged, and in order
+	void CheckAnchors(const SampleTrack &track, const std::set<Real> &anchors,
+		const std::string &label) {
+		std::set<Real> found;
+		bool ordered = true;
+		for (size_t j = 0; j < track.time.size(); j++) {
+			if (track.anchor[j])
+				found.insert(track.time[j]);
+			if (j > 0 && track.time[j] < track.time[j - 1])
+				ordered = false;
+		}
+		Integer missing = 0;
+		for (std::set<Real>::const_iterator it = anchors.begin();
+			it != anchors.end(); ++it)
+			if (found.count(*it) == 0)
+				missing++;
+
+		char what[128];
+		sprintf(what, "%s: %d of %d anchors dropped", label.c_str(), missing,
+			(Integer)anchors.size());
+		UnitTest::Check(missing == 0, what);
+		UnitTest::Check(ordered, label + ": samples out of epoch order");
+	}
+
+	// anchors few enough for the budget, sampled and buffered row by row as
+	// VRInterface does: every interval rows, and every anchor
+	void TestSparseAnchors() {
+		const Integer maxData = 128;
+		const Integer rowCount = 200000;
+		StringArray names(1, "Sat1"), noNames;
+		TrackedBuffers buffers;
+		buffers.BuildDynamicBuffers(names);
+
+		RealArray x(1), y(1), z(1), vx(1), vy(1), vz(1), none;
+		RealArray2D q(4, RealArray(1, 0.0)), noQuat(4);
+		q[Q4][0] = 1.0;
+		BooleanArray sampled(1, true), anchor(1, false);
+		std::set<Real> anchors;
+		Real state[6];
+		for (Integer n = 0; n < rowCount; n++) {
+			OrbitState(n, state);
+			x[0] = state[0];
+			y[0] = state[1];
+			z[0] = state[2];
+			vx[0] = state[3];
+			vy[0] = state[4];
+			vz[0] = state[5];
+			anchor[0] = n % 5003 == 2500;
+			sampled[0] = anchor[0] || n % buffers.GetSampleInterval(0, 1) == 0;
+			if (anchor[0])
+				anchors.insert(Epoch(n));
+			buffers.AddToBuffer(Epoch(n), 1, 0, names, noNames,
+				x, y, z, vx, vy, vz, q,
+				none, none, none, none, none, none, noQuat,
+				sampled, anchor, false, 0, true, maxData);
+		}
+
+		const SampleTrack &track = buffers.Track(0);
+		CheckAnchors(track, anchors, "sparse anchors");
+		UnitTest::Check(track.level >= 10, "sparse anchors: too few halvings");
+		UnitTest::Check((Integer)track.time.size() <= maxData,
+			"sparse anchors: track grew past its budget");
+		UnitTest::Check(track.anchorLimit == 0,
+			"sparse anchors: budget lifted");
+		UnitTest::Check(track.time.size() == buffers.GetSampleCount(),
+			"sparse anchors: sample count differs from the track");
+	}
+
+	// anchors that alone fill the budget, loaded in blocks as VRConvert does
+	void TestDenseAnchors() {
+		const Integer maxData = 64;
+		const Integer sampleCount = 20000;
+		const Integer blockSize = 1000;
+		StringArray names(1, "Sat1");
+		TrackedBuffers buffers;
+		buffers.BuildDynamicBuffers(names);
+
+		std::set<Real> anchors;
+		for (Integer first = 0; first < sampleCount; first += blockSize) {
+			RealArray time(blockSize), state(6 * blockSize), quat(4 * blockSize, 0.0);
+			BooleanArray anchor(blockSize), resumed(blockSize, false);
+			for (Integer j = 0; j < blockSize; j++) {
+				Integer n = first + j;
+				time[j] = Epoch(n);
+				OrbitState(n, &state[6 * j]);
+				quat[4 * j + Q4] = 1.0;
+				// every third sample, and a resumed one now and then
+				anchor[j] = n % 3 == 0;
+				resumed[j] = n % 1000 == 1;
+				if (anchor[j] || resumed[j])
+					anchors.insert(time[j]);
+			}
+			buffers.AddObjectSamples(0, time, state, quat, anchor, resumed, maxData);
+		}
+
+		const SampleTrack &track = buffers.Track(0);
+		CheckAnchors(track, anchors, "dense anchors");
+		for (size_t j = 0; j < track.time.size(); j++) {
+			Integer n = (Integer)std::floor((track.time[j] - START_EPOCH) /
+				STEP_DAYS + 0.5);
+			if (n % 1000 == 1 && !track.resumed[j]) {
+				UnitTest::Check(false, "dense anchors: resumed flag lost");
+				break;
+			}
+		}
+		UnitTest::Check(track.anchorLimit > 0,
+			"dense anchors: budget not lifted");
+		// each halving waits for the track to double, and halves the samples
+		// between anchors, so little more than twice the anchors are held
+		UnitTest::Check(track.time.size() <= 2 * anchors.size() + 2,
+			"dense anchors: track not halved");
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestSparseAnchors();
+	TestDenseAnchors();
+	return UnitTest::Result("DecimationTest");
+}
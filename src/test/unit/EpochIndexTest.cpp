@@ -0,0 +1,187 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  EpochIndexTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// The epoch index must let a client seek: every block's eph, att and time
+// byte ranges must hold exactly its samples, from the indexed first sample
+// on, and its epochs must be those of its first and last samples. Checked
+// for a plain file and for runs appended to a container.
+
+#include "TestMission.hpp"
+#include "UnitTest.hpp"
+
+#include <cmath>
+#include <cstdio>			// for remove(), sprintf()
+#include <cstdlib>			// for atoi(), strtod()
+
+namespace
+{
+	const Integer BLOCK_SIZE = 50;
+
+	// one object of the index, its blocks as the numbers were written
+	struct IndexEntry
+	{
+		Integer run;
+		std::string name;
+		std::vector<StringArray> blocks;
+	};
+
+	std::vector<IndexEntry> ReadIndex(const std::string &text) {
+		std::vector<IndexEntry> entries;
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line)) {
+			size_t blocks = line.find("\"blocks\": [");
+			if (blocks == std::string::npos)
+				continue;
+			IndexEntry entry;
+			size_t run = line.find("\"run\": ");
+			entry.run = run == std::string::npos ? 0 : atoi(line.c_str() + run + 7);
+			size_t name = line.find("\"name\": \"") + 9;
+			entry.name = line.substr(name, line.find('"', name) - name);
+
+			for (size_t open = line.find('[', blocks + 11); open != std::string::npos;
+				open = line.find('[', open + 1)) {
+				size_t close = line.find(']', open);
+				std::istringstream numbers(line.substr(open + 1, close - open - 1));
+				StringArray block;
+				std::string number;
+				while (std::getline(numbers, number, ','))
+					block.push_back(number);
+				entry.blocks.push_back(block);
+			}
+			entries.push_back(entry);
+		}
+		return entries;
+	}
+
+	StringArray Split(const std::string &text, const char separator) {
+		StringArray parts;
+		std::istringstream stream(text);
+		std::string part;
+		while (std::getline(stream, part, separator))
+			if (part.find_first_not_of(" \t") != std::string::npos)
+				parts.push_back(part);
+		return parts;
+	}
+
+	// the blocks of one object against the samples it was given
+	void CheckObject(const std::string &document, const IndexEntry &entry,
+		const Integer object, const IntegerArray &rows) {
+		const std::string label = entry.name + (entry.run > 0 ? " of run " +
+			std::to_string(entry.run) : std::string(""));
+		size_t next = 0;
+		for (size_t k = 0; k < entry.blocks.size(); k++) {
+			const StringArray &block = entry.blocks[k];
+			if (!UnitTest::Check(block.size() == 10, label + ": block with wrong fields"))
+				return;
+			size_t first = atoi(block[2].c_str());
+			size_t count = atoi(block[3].c_str());
+			UnitTest::Check(first == next, label + ": blocks not contiguous");
+			UnitTest::Check(count > 0 && count <= (size_t)BLOCK_SIZE,
+				label + ": block size out of range");
+			next = first + count;
+			if (first + count > rows.size())
+				break;
+
+			std::string part[3];
+			for (Integer p = 0; p < 3; p++) {
+				size_t offset = atoi(block[4 + 2 * p].c_str());
+				size_t length = atoi(block[5 + 2 * p].c_str());
+				UnitTest::Check(offset > 0 && offset + length <= document.size(),
+					label + ": byte range outside the document");
+				part[p] = document.substr(offset, length);
+			}
+
+			StringArray eph = Split(part[0], '\n');
+			StringArray att = Split(part[1], '\n');
+			StringArray time = Split(part[2], ',');
+			if (!UnitTest::Check(eph.size() == count && att.size() == count &&
+				time.size() == count, label + ": range holds another sample count"))
+				continue;
+			for (size_t m = 0; m < count; m++) {
+				Integer row = rows[first + m];
+				Real x = strtod(eph[m].c_str() + eph[m].find('[') + 1, NULL);
+				char what[128];
+				sprintf(what, "%s: sample %lu of the index is not at x = %.0f",
+					label.c_str(), (unsigned long)(first + m),
+					TestMission::PositionX(object, row));
+				if (!UnitTest::Check(x == TestMission::PositionX(object, row), what))
+					break;
+				UnitTest::Check(att[m].find('[') != std::string::npos &&
+					std::fabs(strtod(time[m].c_str(), NULL) - TestMission::Epoch(row)) < 1.0e-5,
+					label + ": att or time entry of another sample");
+			}
+			UnitTest::Check(time.front() == block[0] && time.back() == block[1],
+				label + ": block epochs differ from its samples");
+		}
+		UnitTest::Check(next == rows.size(), label + ": index misses samples");
+	}
+
+	void TestPlainFile() {
+		const std::string fileName = "EpochIndexTest.json";
+		TestMission::Mission mission = TestMission::Build(3, 437);
+		DataManager buffers;
+		buffers.SetEpochIndexBlock(BLOCK_SIZE);
+		UnitTest::Check(TestMission::Export(buffers, mission, fileName) > 0,
+			"plain file not written");
+
+		std::string document = TestMission::ReadFile(fileName);
+		std::vector<IndexEntry> entries =
+			ReadIndex(TestMission::ReadFile("EpochIndexTest_epochs.json"));
+		if (UnitTest::Check(entries.size() == mission.names.size(),
+			"plain file: index lists another object count")) {
+			for (size_t i = 0; i < entries.size(); i++) {
+				UnitTest::Check(entries[i].name == mission.names[i],
+					"plain file: objects out of order");
+				CheckObject(document, entries[i], (Integer)i, mission.rows[i]);
+			}
+		}
+		remove(fileName.c_str());
+		remove("EpochIndexTest_epochs.json");
+	}
+
+	void TestContainer() {
+		const std::string fileName = "EpochIndexTestRuns.json";
+		const std::string indexName = "EpochIndexTestRuns_epochs.json";
+		remove(fileName.c_str());
+		remove(indexName.c_str());
+		TestMission::Mission mission = TestMission::Build(2, 180);
+		DataManager buffers;
+		buffers.SetEpochIndexBlock(BLOCK_SIZE);
+		for (Integer run = 0; run < 3; run++)
+			TestMission::Export(buffers, mission, fileName, true);
+
+		// each run's samples come after those of the run before
+		std::string container = TestMission::ReadFile(fileName);
+		std::vector<IndexEntry> entries = ReadIndex(TestMission::ReadFile(indexName));
+		if (UnitTest::Check(entries.size() == 3 * mission.names.size(),
+			"container: index lists another object count")) {
+			for (size_t k = 0; k < entries.size(); k++) {
+				size_t i = k % mission.names.size();
+				UnitTest::Check(entries[k].run == (Integer)(k / mission.names.size()) + 1,
+					"container: runs out of order");
+				CheckObject(container, entries[k], (Integer)i, mission.rows[i]);
+				if (k >= mission.names.size() && !entries[k].blocks.empty())
+					UnitTest::Check(atoi(entries[k].blocks[0][4].c_str()) >
+						atoi(entries[k - mission.names.size()].blocks.back()[8].c_str()),
+						"container: run indexed at the offsets of an earlier run");
+			}
+		}
+		remove(fileName.c_str());
+		remove(indexName.c_str());
+		remove("EpochIndexTestRuns_index.json");
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestPlainFile();
+	TestContainer();
+	return UnitTest::Result("EpochIndexTest");
+}
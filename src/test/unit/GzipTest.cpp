@@ -0,0 +1,165 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  GzipTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// A compressed export must unpack to the plain export, byte for byte:
+// read whole through zlib, member by member using the length each member
+// records, and for tiles. Its epoch index must differ from the plain one
+// only in naming the compressed file. Built only where zlib is found.
+
+#include "TestMission.hpp"
+#include "UnitTest.hpp"
+
+#include <cstdio>			// for remove(), sprintf()
+#include <zlib.h>
+
+namespace
+{
+	const Integer LEVEL = 6;
+
+	// the whole file through zlib, which reads concatenated members
+	std::string Gunzip(const std::string &fileName) {
+		std::string text;
+		gzFile file = gzopen(fileName.c_str(), "rb");
+		if (file == NULL)
+			return text;
+		char chunk[65536];
+		int read;
+		while ((read = gzread(file, chunk, sizeof(chunk))) > 0)
+			text.append(chunk, read);
+		gzclose(file);
+		return text;
+	}
+
+	// one member inflated on its own
+	bool InflateMember(const std::string &member, std::string &text) {
+		z_stream stream;
+		stream.zalloc = Z_NULL;
+		stream.zfree = Z_NULL;
+		stream.opaque = Z_NULL;
+		stream.next_in = Z_NULL;
+		stream.avail_in = 0;
+		if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+			return false;
+		stream.next_in = (Bytef*)member.data();
+		stream.avail_in = (uInt)member.size();
+		char chunk[65536];
+		int status = Z_OK;
+		while (status == Z_OK) {
+			stream.next_out = (Bytef*)chunk;
+			stream.avail_out = sizeof(chunk);
+			status = inflate(&stream, Z_NO_FLUSH);
+			text.append(chunk, sizeof(chunk) - stream.avail_out);
+		}
+		bool whole = status == Z_STREAM_END && stream.avail_in == 0;
+		inflateEnd(&stream);
+		return whole;
+	}
+
+	// steps through the members by the length in their 'VR' subfield
+	// Returns the number of members, or 0 when one is malformed
+	Integer ReadMembers(const std::string &file, std::string &text) {
+		Integer members = 0;
+		size_t offset = 0;
+		while (offset < file.size()) {
+			if (offset + 20 > file.size() || file.compare(offset, 2, "\x1f\x8b") != 0 ||
+				file[offset + 3] != 4 || file.compare(offset + 12, 2, "VR") != 0)
+				return 0;
+			const unsigned char *length = (const unsigned char*)&file[offset + 16];
+			size_t memberSize = length[0] | (length[1] << 8) | (length[2] << 16) |
+				((size_t)length[3] << 24);
+			if (offset + memberSize > file.size() ||
+				!InflateMember(file.substr(offset, memberSize), text))
+				return 0;
+			offset += memberSize;
+			members++;
+		}
+		return members;
+	}
+
+	void TestDocument() {
+		// several megabytes, so the text spans several members
+		TestMission::Mission mission = TestMission::Build(3, 12000);
+		DataManager plainBuffers, gzipBuffers;
+		plainBuffers.SetEpochIndexBlock(500);
+		gzipBuffers.SetEpochIndexBlock(500);
+		gzipBuffers.SetCompressionLevel(LEVEL);
+		TestMission::Export(plainBuffers, mission, "GzipTestPlain.json");
+		size_t written = TestMission::Export(gzipBuffers, mission, "GzipTest.json");
+
+		const std::string plain = TestMission::ReadFile("GzipTestPlain.json");
+		const std::string file = TestMission::ReadFile("GzipTest.json.gz");
+		const std::string plainIndex = TestMission::ReadFile("GzipTestPlain_epochs.json");
+		const std::string gzipIndex = TestMission::ReadFile("GzipTest_epochs.json");
+		UnitTest::Check(!file.empty() && file.size() < plain.size() / 4,
+			"document not compressed");
+		UnitTest::Check(written == file.size(), "bytes written differ from the file size");
+		UnitTest::Check(Gunzip("GzipTest.json.gz") == plain,
+			"document unpacks to another text");
+
+		std::string members;
+		Integer memberCount = ReadMembers(file, members);
+		char what[96];
+		sprintf(what, "%d members in %lu bytes of text", memberCount,
+			(unsigned long)plain.size());
+		UnitTest::Check(memberCount > 1, what);
+		UnitTest::Check(members == plain, "members unpack to another text");
+
+		// the index names the compressed file, with offsets into its text
+		std::string expectedIndex = plainIndex;
+		expectedIndex.replace(expectedIndex.find("GzipTestPlain.json"), 18,
+			"GzipTest.json.gz\",\n\t\"offsets\": \"decompressed");
+		UnitTest::Check(gzipIndex == expectedIndex,
+			"index differs from that of the plain document");
+
+		remove("GzipTestPlain.json");
+		remove("GzipTestPlain_epochs.json");
+		remove("GzipTest.json.gz");
+		remove("GzipTest_epochs.json");
+	}
+
+	void TestTiles() {
+		TestMission::Mission mission = TestMission::Build(2, 600);
+		DataManager plainBuffers, gzipBuffers;
+		plainBuffers.SetTileDuration(0.1);
+		gzipBuffers.SetTileDuration(0.1);
+		gzipBuffers.SetCompressionLevel(LEVEL);
+		TestMission::Export(plainBuffers, mission, "GzipTestPlain.json");
+		TestMission::Export(gzipBuffers, mission, "GzipTest.json");
+
+		const std::string manifest = TestMission::ReadFile("GzipTest_tiles.json");
+		Integer tileCount = 0;
+		char what[96];
+		for (Integer k = 1; ; k++) {
+			char plainName[64], gzipName[64];
+			sprintf(plainName, "GzipTestPlain_tile%d.json", k);
+			sprintf(gzipName, "GzipTest_tile%d.json.gz", k);
+			const std::string plain = TestMission::ReadFile(plainName);
+			if (plain.empty())
+				break;
+			tileCount++;
+			sprintf(what, "tile %d unpacks to another text", k);
+			UnitTest::Check(Gunzip(gzipName) == plain, what);
+			sprintf(what, "\"file\": \"GzipTest_tile%d.json.gz\", ", k);
+			UnitTest::Check(manifest.find(what) != std::string::npos,
+				"manifest misses a compressed tile");
+			remove(plainName);
+			remove(gzipName);
+		}
+		UnitTest::Check(tileCount > 1, "mission not tiled");
+		remove("GzipTestPlain_tiles.json");
+		remove("GzipTest_tiles.json");
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestDocument();
+	TestTiles();
+	return UnitTest::Result("GzipTest");
+}
@@ -0,0 +1,196 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SinglePrecisionTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Single precision buffers round each sample to float32 and report the
+// largest error they stored. Positions far from the origin must come back
+// within that bound, which itself must stay below the bound of the origin
+// range, also after compaction, reordering and decimation have moved the
+// samples between origin runs.
+
+#include "DataManager.hpp"
+#include "UnitTest.hpp"
+
+#include <cmath>
+#include <cstdio>			// for sprintf()
+#include <map>
+
+namespace
+{
+	// as in DataManager: offsets of at most 8192 km round to within 2^-24
+	// of that
+	const Real ORIGIN_RANGE = 8192.0;
+	const Real POSITION_BOUND = ORIGIN_RANGE / 16777216.0;
+
+	// gives the tests the tracks and error bounds behind the buffers
+	class TrackedBuffers : public DataManager
+	{
+	public:
+		const SampleTrack& Track(const Integer spIndex) const {
+			return *storedSpTrack[spIndex];
+		}
+		Real PositionError() const {
+			return MaxError(SampleTrack::POS_X, SampleTrack::POS_Z);
+		}
+		Real VelocityError() const {
+			return MaxError(SampleTrack::VEL_X, SampleTrack::VEL_Z);
+		}
+	};
+
+	// a heliocentric orbit out at Neptune, swept fast enough to cross many
+	// origin ranges, with a few jumps back to earlier positions
+	Real FarPosition(const Integer n) {
+		Real angle = 1.0e-4 * n;
+		if (n % 1000 == 999)
+			angle -= 0.05;
+		return 4.5e9 * std::cos(angle) + 0.37 * n;
+	}
+
+	// every sample of column must be within its reported bound of expected
+	void CheckBound(const SampleColumn &column, const RealArray &expected,
+		const Real bound, const std::string &label) {
+		if (!UnitTest::Check(column.size() == expected.size(),
+			label + ": wrong size"))
+			return;
+		Real worst = 0.0;
+		for (size_t k = 0; k < expected.size(); k++)
+			worst = std::max(worst, std::fabs(column[k] - expected[k]));
+
+		char what[160];
+		sprintf(what, "%s: error %.3g km past the reported %.3g km", label.c_str(),
+			worst, column.GetMaxError());
+		UnitTest::Check(worst <= column.GetMaxError(), what);
+		sprintf(what, "%s: reported error %.3g km past the bound %.3g km",
+			label.c_str(), column.GetMaxError(), bound);
+		UnitTest::Check(column.GetMaxError() <= bound, what);
+	}
+
+	void TestColumn() {
+		SampleColumn column;
+		column.SetSinglePrecision(true, ORIGIN_RANGE);
+		RealArray values;
+		for (Integer n = 0; n < 200000; n++) {
+			values.push_back(FarPosition(n));
+			column.push_back(values.back());
+		}
+		UnitTest::Check(column.GetMaxError() > 0.0,
+			"far positions: no rounding error reported");
+		CheckBound(column, values, POSITION_BOUND, "far positions");
+
+		// a halving, so that runs lose their first samples
+		std::vector<size_t> keep;
+		RealArray kept;
+		for (size_t k = 0; k < values.size(); k++) {
+			if (k % 2 == 1 || k % 1000 == 999 || k == values.size() - 1) {
+				keep.push_back(k);
+				kept.push_back(values[k]);
+			}
+		}
+		column.Compact(keep);
+		CheckBound(column, kept, POSITION_BOUND, "compacted far positions");
+
+		// samples appended after the compaction start from the last origin
+		for (Integer n = 200000; n < 230000; n++) {
+			kept.push_back(FarPosition(n));
+			column.push_back(kept.back());
+		}
+		CheckBound(column, kept, POSITION_BOUND, "refilled far positions");
+
+		// a reordering, as OrderBuffer does, which interleaves origin runs
+		keep.clear();
+		RealArray shuffled;
+		for (size_t k = 0; k < kept.size(); k++) {
+			size_t from = (k % 2 == 0) ? k / 2 : kept.size() - 1 - k / 2;
+			keep.push_back(from);
+			shuffled.push_back(kept[from]);
+		}
+		column.Compact(keep);
+		CheckBound(column, shuffled, POSITION_BOUND, "reordered far positions");
+
+		// without origins, the bound is relative to each value
+		SampleColumn velocity;
+		velocity.SetSinglePrecision(true);
+		RealArray speeds;
+		for (Integer n = 0; n < 10000; n++) {
+			speeds.push_back(30.0 * std::sin(1.0e-3 * n) + 1.0e-6 * n);
+			velocity.push_back(speeds.back());
+		}
+		CheckBound(velocity, speeds, 30.0 / 16777216.0, "velocities");
+	}
+
+	// the same through the buffers, decimated and ordered as they are at
+	// export, loaded partly out of epoch order
+	void TestBuffers() {
+		const Integer maxData = 5000;
+		const Integer blockSize = 2000;
+		const Integer blockCount = 40;
+		StringArray names(1, "Sat1");
+		TrackedBuffers buffers;
+		buffers.BuildDynamicBuffers(names, "", false, true);
+
+		std::map<Real, RealArray> states;
+		for (Integer b = 0; b < blockCount; b++) {
+			// every fifth block comes in a block early
+			Integer block = (b % 5 == 3) ? b + 1 : (b % 5 == 4) ? b - 1 : b;
+			RealArray time(blockSize), state(6 * blockSize), quat(4 * blockSize, 0.0);
+			BooleanArray anchor(blockSize, false), resumed(blockSize, false);
+			for (Integer j = 0; j < blockSize; j++) {
+				Integer n = block * blockSize + j;
+				time[j] = 25000.0 + n / 1440.0;
+				state[6 * j] = FarPosition(n);
+				state[6 * j + 1] = -0.8 * FarPosition(n + 7);
+				state[6 * j + 2] = 1.0e8 + 3.0 * n;
+				state[6 * j + 3] = 5.4 * std::sin(1.0e-4 * n);
+				state[6 * j + 4] = -5.4 * std::cos(1.0e-4 * n);
+				state[6 * j + 5] = 1.0e-3;
+				quat[4 * j + Q4] = 1.0;
+				states[time[j]] = RealArray(state.begin() + 6 * j,
+					state.begin() + 6 * j + 6);
+			}
+			buffers.AddObjectSamples(0, time, state, quat, anchor, resumed, maxData);
+		}
+		buffers.PrepareExport(1, 0, names, StringArray(), maxData);
+
+		const SampleTrack &track = buffers.Track(0);
+		UnitTest::Check(track.level > 0, "buffers: never decimated");
+		Real positionWorst = 0.0, velocityWorst = 0.0;
+		Integer unknown = 0;
+		for (size_t j = 0; j < track.time.size(); j++) {
+			std::map<Real, RealArray>::const_iterator it = states.find(track.time[j]);
+			if (it == states.end()) {
+				unknown++;
+				continue;
+			}
+			for (size_t c = SampleTrack::POS_X; c <= SampleTrack::POS_Z; c++)
+				positionWorst = std::max(positionWorst,
+					std::fabs(track.Channel(c)[j] - it->second[c]));
+			for (size_t c = SampleTrack::VEL_X; c <= SampleTrack::VEL_Z; c++)
+				velocityWorst = std::max(velocityWorst,
+					std::fabs(track.Channel(c)[j] - it->second[c]));
+		}
+
+		char what[160];
+		sprintf(what, "buffers: %d samples at epochs never added", unknown);
+		UnitTest::Check(unknown == 0, what);
+		sprintf(what, "buffers: position error %.3g km past the reported %.3g km",
+			positionWorst, buffers.PositionError());
+		UnitTest::Check(positionWorst <= buffers.PositionError(), what);
+		UnitTest::Check(buffers.PositionError() <= POSITION_BOUND,
+			"buffers: reported position error past the origin range bound");
+		sprintf(what, "buffers: velocity error %.3g km/s past the reported %.3g km/s",
+			velocityWorst, buffers.VelocityError());
+		UnitTest::Check(velocityWorst <= buffers.VelocityError(), what);
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestColumn();
+	TestBuffers();
+	return UnitTest::Result("SinglePrecisionTest");
+}
@@ -0,0 +1,75 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  SolverPassTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Solver passes are halved like the main buffers: a pass far longer than
+// its point limit must stay within it, and keep samples spread evenly over
+// the whole pass, rather than the rows since its last halving.
+
+#include "SolverPassStore.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <cstdio>			// for sprintf()
+
+namespace
+{
+	void TestLongPass() {
+		const Integer pointLimit = 100;
+		const Integer rowCount = 100000;
+		SolverPassStore passes;
+		passes.Configure(2, 3, 1, pointLimit);
+
+		for (Integer iteration = 0; iteration < 4; iteration++) {
+			UnitTest::Check(passes.BeginPass(), "pass not captured");
+			for (Integer n = 0; n < rowCount; n++) {
+				Real state[6] = { 7000.0 + n, 0.0, 0.0, 0.0, 7.5, 0.0 };
+				passes.Add(0, n, state);
+				// the second spacecraft is only in the first rows
+				if (n < pointLimit / 2)
+					passes.Add(1, n, state);
+			}
+		}
+		UnitTest::Check(passes.GetPassCount() == 3, "wrong number of passes kept");
+
+		const SolverPassStore::Pass &pass = passes.GetPass(passes.GetPassCount() - 1);
+		const RealArray &time = passes.Channel(pass, 0, SolverPassStore::EPOCH);
+		const RealArray &x = passes.Channel(pass, 0, SolverPassStore::POS_X);
+		UnitTest::Check(pass.number == 4, "last pass misnumbered");
+		UnitTest::Check(time.size() <= (size_t)pointLimit && time.size() > 0,
+			"pass outgrew its point limit");
+		if (time.empty())
+			return;
+
+		Real smallestGap = rowCount;
+		bool matching = true;
+		for (size_t j = 0; j < time.size(); j++) {
+			if (j > 0)
+				smallestGap = std::min(smallestGap, time[j] - time[j - 1]);
+			matching = matching && x[j] == 7000.0 + time[j];
+		}
+		char what[128];
+		sprintf(what, "samples %.0f rows apart, at a limit of %d in %d rows",
+			smallestGap, pointLimit, rowCount);
+		UnitTest::Check(smallestGap >= rowCount / (4.0 * pointLimit), what);
+		UnitTest::Check(time.front() == 0.0, "first row of the pass dropped");
+		UnitTest::Check(time.back() >= rowCount * 0.9, "end of the pass dropped");
+		UnitTest::Check(matching, "states out of step with their epochs");
+
+		// a spacecraft that never filled the pass keeps every row
+		const RealArray &shortTime = passes.Channel(pass, 1, SolverPassStore::EPOCH);
+		UnitTest::Check(shortTime.size() == (size_t)pointLimit / 2,
+			"short spacecraft thinned");
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestLongPass();
+	return UnitTest::Result("SolverPassTest");
+}
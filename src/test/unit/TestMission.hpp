@@ -0,0 +1,114 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  TestMission
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// A small mission for the export tests, buffered row by row as VRInterface
+// does. Every state is a whole number, so it is written exactly: sample n
+// of object i is at x = 7000 + 1000 i + n, y = n, z = i. Object i is
+// sampled on the rows that are not a multiple of i + 2, so the objects hold
+// different samples.
+
+#ifndef TestMission_hpp
+#define TestMission_hpp
+
+#include "DataManager.hpp"
+
+#include <fstream>
+#include <sstream>
+
+namespace TestMission
+{
+	const Real START_EPOCH = 25000.0;
+	const Real STEP_DAYS = 60.0 / 86400.0;
+
+	struct Mission
+	{
+		StringArray names;
+		RealArray radii;
+		ColorMap colours;
+		Integer rowCount;
+		std::vector<IntegerArray> rows;	// [object] rows it was sampled on
+	};
+
+	inline Real Epoch(const Integer row) {
+		return START_EPOCH + row * STEP_DAYS;
+	}
+
+	inline Real PositionX(const Integer object, const Integer row) {
+		return 7000.0 + 1000.0 * object + row;
+	}
+
+	inline Mission Build(const Integer objectCount, const Integer rowCount) {
+		Mission mission;
+		mission.rowCount = rowCount;
+		mission.rows.resize(objectCount);
+		for (Integer i = 0; i < objectCount; i++) {
+			std::ostringstream name;
+			name << "Sat" << i + 1;
+			mission.names.push_back(name.str());
+			mission.radii.push_back(1.0);
+			mission.colours[name.str()] = 0x00FF8000 + i;
+			for (Integer n = 0; n < rowCount; n++)
+				if (n % (i + 2) != 0 || n == 0)
+					mission.rows[i].push_back(n);
+		}
+		return mission;
+	}
+
+	// buffers every row of the mission
+	inline void Buffer(DataManager &buffers, const Mission &mission,
+		const Integer maxData) {
+		const Integer objectCount = (Integer)mission.names.size();
+		RealArray x(objectCount), y(objectCount), z(objectCount);
+		RealArray vx(objectCount, 1.0), vy(objectCount, 2.0), vz(objectCount, 3.0);
+		RealArray2D q(4, RealArray(objectCount, 0.0));
+		q[Q4].assign(objectCount, 1.0);
+		RealArray none;
+		RealArray2D noQuat(4);
+		StringArray noNames;
+		BooleanArray sampled(objectCount), anchor(objectCount, false);
+
+		for (Integer n = 0; n < mission.rowCount; n++) {
+			for (Integer i = 0; i < objectCount; i++) {
+				sampled[i] = n % (i + 2) != 0 || n == 0;
+				x[i] = PositionX(i, n);
+				y[i] = n;
+				z[i] = i;
+			}
+			buffers.AddToBuffer(Epoch(n), objectCount, 0, mission.names, noNames,
+				x, y, z, vx, vy, vz, q, none, none, none, none, none, none, noQuat,
+				sampled, anchor, false, 0, true, maxData);
+		}
+	}
+
+	// buffers the mission and writes it, with attitude
+	// Returns the bytes written
+	inline size_t Export(DataManager &buffers, const Mission &mission,
+		const std::string &fileName, const bool appendRun = false,
+		SampleTransform *transform = NULL) {
+		const Integer objectCount = (Integer)mission.names.size();
+		const Integer maxData = mission.rowCount + 1;
+		buffers.BuildDynamicBuffers(mission.names);
+		Buffer(buffers, mission, maxData);
+
+		StringArray noNames;
+		RealArray windowStart, windowStop;
+		std::ofstream jstream;
+		if (!buffers.PrepareExport(objectCount, 0, mission.names, noNames, maxData))
+			return 0;
+		return buffers.WriteBuffers(fileName, jstream, objectCount, 0,
+			mission.names, noNames, mission.radii, mission.colours, true, true,
+			windowStart, windowStop, transform, appendRun);
+	}
+
+	inline std::string ReadFile(const std::string &fileName) {
+		std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+		std::ostringstream text;
+		text << stream.rdbuf();
+		return text.str();
+	}
+}
+
+#endif
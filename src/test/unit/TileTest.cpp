@@ -0,0 +1,167 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  TileTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Tiles must split an export without losing or moving samples: the
+// manifest lists every tile in time order with the size of its file, each
+// tile holds exactly the samples of its epochs, a sample on a boundary is
+// in both tiles, and together the tiles hold every sample.
+
+#include "TestMission.hpp"
+#include "UnitTest.hpp"
+
+#include <cmath>
+#include <cstdio>			// for remove(), sprintf()
+#include <cstdlib>			// for atoi(), strtod()
+#include <set>
+
+namespace
+{
+	// one tile of the manifest
+	struct TileEntry
+	{
+		std::string file;
+		Real start;
+		Real stop;
+		size_t bytes;
+	};
+
+	std::vector<TileEntry> ReadManifest(const std::string &text) {
+		std::vector<TileEntry> tiles;
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line)) {
+			size_t file = line.find("\"file\": \"");
+			if (file == std::string::npos)
+				continue;
+			TileEntry tile;
+			file += 9;
+			tile.file = line.substr(file, line.find('"', file) - file);
+			tile.start = strtod(line.c_str() + line.find("\"start\": ") + 9, NULL);
+			tile.stop = strtod(line.c_str() + line.find("\"stop\": ") + 8, NULL);
+			tile.bytes = atoi(line.c_str() + line.find("\"bytes\": ") + 9);
+			tiles.push_back(tile);
+		}
+		return tiles;
+	}
+
+	// the x position of every eph entry of each object in a tile, and the
+	// epochs of its time entries
+	void ReadTile(const std::string &document, const StringArray &names,
+		std::vector<RealArray> &x, std::vector<RealArray> &epochs) {
+		x.assign(names.size(), RealArray());
+		epochs.assign(names.size(), RealArray());
+		for (size_t i = 0; i < names.size(); i++) {
+			size_t object = document.find("\"name\": \"" + names[i] + "\"");
+			if (object == std::string::npos)
+				continue;
+			size_t eph = document.find("\"eph\": [", object);
+			size_t ephEnd = document.find("\n\t\t\t],", eph);
+			for (size_t open = document.find("\n", eph); open < ephEnd;
+				open = document.find("\n", open + 1)) {
+				size_t bracket = document.find('[', open);
+				if (bracket < document.find("\n", open + 1))
+					x[i].push_back(strtod(document.c_str() + bracket + 1, NULL));
+			}
+			size_t time = document.find("\"time\": [", object) + 9;
+			std::istringstream values(document.substr(time,
+				document.find(']', time) - time));
+			std::string value;
+			while (std::getline(values, value, ','))
+				epochs[i].push_back(strtod(value.c_str(), NULL));
+		}
+	}
+
+	void TestTiles() {
+		const std::string fileName = "TileTest.json";
+		const std::string manifestName = "TileTest_tiles.json";
+		// boundaries fall on rows 145, 290, 435 and 580, which some objects
+		// were sampled on and others not
+		const Real tileDuration = 145 * TestMission::STEP_DAYS;
+		TestMission::Mission mission = TestMission::Build(3, 600);
+		DataManager buffers;
+		buffers.SetTileDuration(tileDuration);
+		UnitTest::Check(TestMission::Export(buffers, mission, fileName) > 0,
+			"tiles not written");
+
+		// the tiles as WriteTiles lays them out, from the first sample on
+		const Real firstEpoch = TestMission::Epoch(0);
+		const Integer tileCount = (Integer)std::floor(
+			(TestMission::Epoch(mission.rowCount - 1) - firstEpoch) / tileDuration) + 1;
+		std::vector<TileEntry> tiles = ReadManifest(TestMission::ReadFile(manifestName));
+		if (!UnitTest::Check((Integer)tiles.size() == tileCount,
+			"manifest lists another tile count"))
+			return;
+
+		std::vector<std::multiset<Integer> > found(mission.names.size());
+		Integer shared = 0;
+		for (Integer k = 0; k < tileCount; k++) {
+			const TileEntry &tile = tiles[k];
+			char label[64];
+			sprintf(label, "tile %d", k + 1);
+			const std::string document = TestMission::ReadFile(tile.file);
+			UnitTest::Check(!document.empty(), std::string(label) + ": file missing");
+			UnitTest::Check(document.size() == tile.bytes,
+				std::string(label) + ": size differs from the manifest");
+			UnitTest::Check(tile.start < tile.stop && (k == 0 ||
+				std::fabs(tile.start - tiles[k - 1].stop) < 1.0e-5),
+				std::string(label) + ": out of time order");
+
+			const Real start = firstEpoch + k * tileDuration;
+			const Real stop = firstEpoch + (k + 1) * tileDuration;
+			std::vector<RealArray> x, epochs;
+			ReadTile(document, mission.names, x, epochs);
+			for (size_t i = 0; i < mission.names.size(); i++) {
+				const std::string object = std::string(label) + ", " + mission.names[i];
+				IntegerArray expected;
+				for (size_t j = 0; j < mission.rows[i].size(); j++) {
+					Integer row = mission.rows[i][j];
+					if (TestMission::Epoch(row) >= start && TestMission::Epoch(row) <= stop)
+						expected.push_back(row);
+				}
+				if (!UnitTest::Check(x[i].size() == expected.size() &&
+					epochs[i].size() == expected.size(),
+					object + ": holds another sample count"))
+					continue;
+				for (size_t j = 0; j < expected.size(); j++) {
+					if (!UnitTest::Check(x[i][j] == TestMission::PositionX((Integer)i,
+						expected[j]) && std::fabs(epochs[i][j] -
+						TestMission::Epoch(expected[j])) < 1.0e-5,
+						object + ": sample of another epoch"))
+						break;
+					UnitTest::Check(epochs[i][j] > tile.start - 1.0e-5 &&
+						epochs[i][j] < tile.stop + 1.0e-5,
+						object + ": sample outside the manifest epochs");
+					found[i].insert(expected[j]);
+					if (found[i].count(expected[j]) > 1)
+						shared++;
+				}
+			}
+			remove(tile.file.c_str());
+		}
+
+		// boundary samples are the only ones in two tiles
+		UnitTest::Check(shared > 0, "no boundary sample in two tiles");
+		for (size_t i = 0; i < mission.names.size(); i++) {
+			std::set<Integer> rows(found[i].begin(), found[i].end());
+			UnitTest::Check(rows == std::set<Integer>(mission.rows[i].begin(),
+				mission.rows[i].end()), mission.names[i] + ": tiles miss samples");
+			for (std::set<Integer>::const_iterator it = rows.begin(); it != rows.end(); ++it)
+				if (found[i].count(*it) > 1)
+					UnitTest::Check(*it % 145 == 0, mission.names[i] +
+						": sample off a boundary in two tiles");
+		}
+		remove(manifestName.c_str());
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main() {
+	TestTiles();
+	return UnitTest::Result("TileTest");
+}
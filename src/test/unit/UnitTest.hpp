@@ -0,0 +1,44 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  UnitTest
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Checks shared by the unit tests. Each test is a program of its own that
+// reports every failed check and exits with the number of failures, so
+// that ctest runs it without a test framework.
+
+#ifndef UnitTest_hpp
+#define UnitTest_hpp
+
+#include "gmatdefs.hpp"
+#include "MessageInterface.hpp"
+
+namespace UnitTest
+{
+	inline Integer& Failures() {
+		static Integer failures = 0;
+		return failures;
+	}
+
+	// @what names the check in the report
+	inline bool Check(const bool passed, const std::string &what) {
+		if (!passed) {
+			MessageInterface::ShowMessage("FAILED: %s\n", what.c_str());
+			Failures()++;
+		}
+		return passed;
+	}
+
+	// exit code of a test program
+	inline int Result(const char *testName) {
+		if (Failures() == 0)
+			MessageInterface::ShowMessage("%s: all checks passed\n", testName);
+		else
+			MessageInterface::ShowMessage("%s: %d checks failed\n", testName,
+				Failures());
+		return Failures() == 0 ? 0 : 1;
+	}
+}
+
+#endif
@@ -0,0 +1,246 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ExportReader
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Implements ExportReader class
+//
+// The scan follows strings and brackets only, so numbers are skipped at
+// the speed of the disk. Objects are the members of the "orbits" array;
+// their keys are one level deeper:
+//    depth 1   document       "info", "orbits", "passes"
+//    depth 2   "orbits"
+//    depth 3   object         "name", "radius", "color", "eph", "att",
+//                             "anchors", "gaps", "lod", "bounds", "time"
+
+#include "ExportReader.hpp"
+#include "SubscriberException.hpp"
+
+#include <cstdlib>		// for strtod()
+
+namespace
+{
+	const size_t SCAN_BLOCK_SIZE = 1 << 20;
+	const size_t CURSOR_BLOCK_SIZE = 1 << 16;
+
+	const char *SECTION_KEYS[ExportReader::Object::SECTION_COUNT] =
+		{ "eph", "att", "anchors", "gaps", "time" };
+
+	bool IsSpace(const char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+}
+
+
+//------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------
+ExportReader::ExportReader(const std::string &fileName) :
+	mFileName(fileName) {
+}
+
+//------------------------------------------------------------
+// Find the objects of the first document
+//------------------------------------------------------------
+/*
+* Reads up to the end of the "orbits" array; what follows, such as the
+* solver passes, is not read
+*/
+void ExportReader::Scan(std::vector<Object> &objects) const {
+	std::ifstream file(mFileName.c_str(), std::ifstream::in | std::ifstream::binary);
+	if (!file.is_open()) {
+		SubscriberException se;
+		se.SetDetails("ExportReader: cannot open \"%s\"\n", mFileName.c_str());
+		throw se;
+	}
+
+	objects.clear();
+	std::vector<char> buffer(SCAN_BLOCK_SIZE);
+	size_t blockStart = 0;
+	Integer depth = 0;
+	bool inString = false, escaped = false;
+	bool stringDone = false;		// not yet known to be a key or a value
+	bool inOrbits = false;
+	std::string text, key;
+
+	while (file) {
+		file.read(&buffer[0], buffer.size());
+		size_t count = (size_t)file.gcount();
+
+		for (size_t k = 0; k < count; k++) {
+			const char c = buffer[k];
+			if (inString) {
+				if (escaped)
+					escaped = false;
+				else if (c == '\\')
+					escaped = true;
+				else if (c == '"') {
+					inString = false;
+					stringDone = true;
+					continue;
+				}
+				text.push_back(c);
+				continue;
+			}
+			if (IsSpace(c))
+				continue;
+
+			const size_t offset = blockStart + k;
+			const bool inObject = inOrbits && depth == 3 && !objects.empty();
+			if (stringDone) {
+				stringDone = false;
+				if (c == ':') {
+					key = text;
+					if (inObject && key == "radius")
+						objects.back().radius = offset + 1;
+					continue;
+				}
+				if (inObject && key == "name")
+					objects.back().name = text;
+				else if (inObject && key == "color")
+					objects.back().color = text;
+			}
+
+			switch (c) {
+			case '"':
+				inString = true;
+				text.clear();
+				break;
+			case '{':
+				if (inOrbits && depth == 2) {
+					Object object;
+					object.radius = 0;
+					for (size_t s = 0; s < Object::SECTION_COUNT; s++)
+						object.section[s] = 0;
+					objects.push_back(object);
+				}
+				depth++;
+				break;
+			case '[':
+				if (depth == 1 && key == "orbits")
+					inOrbits = true;
+				if (inObject) {
+					for (size_t s = 0; s < Object::SECTION_COUNT; s++) {
+						if (key == SECTION_KEYS[s])
+							objects.back().section[s] = offset + 1;
+					}
+				}
+				depth++;
+				break;
+			case '}':
+			case ']':
+				depth--;
+				if ((inOrbits && depth == 1) || depth <= 0)
+					return;
+				break;
+			default:
+				break;
+			}
+		}
+		blockStart += count;
+	}
+
+	// a file cut short, e.g. by an export that did not finish
+	SubscriberException se;
+	if (!inOrbits)
+		se.SetDetails("ExportReader: \"%s\" holds no orbits\n", mFileName.c_str());
+	else
+		se.SetDetails("ExportReader: \"%s\" ends inside its orbits\n",
+			mFileName.c_str());
+	throw se;
+}
+
+//------------------------------------------------------------
+// Cursor
+//------------------------------------------------------------
+ExportReader::Cursor::Cursor() :
+	mBuffer(CURSOR_BLOCK_SIZE),
+	mBegin(0),
+	mEnd(0),
+	mDepth(0),
+	mClosed(true) {
+}
+
+void ExportReader::Cursor::Open(const std::string &fileName) {
+	mFileName = fileName;
+	mFile.open(fileName.c_str(), std::ifstream::in | std::ifstream::binary);
+	if (!mFile.is_open()) {
+		SubscriberException se;
+		se.SetDetails("ExportReader: cannot open \"%s\"\n", fileName.c_str());
+		throw se;
+	}
+}
+
+void ExportReader::Cursor::Seek(const size_t offset) {
+	mFile.clear();
+	mFile.seekg((std::streamoff)offset);
+	mBegin = mEnd = 0;
+	mDepth = 0;
+	mClosed = false;
+}
+
+/*
+* Separators and the brackets of rows are skipped, so rows of any width
+* read as one run of numbers
+*/
+bool ExportReader::Cursor::Next(Real &value) {
+	while (!mClosed) {
+		if (mBegin == mEnd && !Fill()) {
+			SubscriberException se;
+			se.SetDetails("ExportReader: \"%s\" ends inside an array\n",
+				mFileName.c_str());
+			throw se;
+		}
+
+		const char c = mBuffer[mBegin];
+		if (c == '[') {
+			mDepth++;
+			mBegin++;
+			continue;
+		}
+		if (c == ']') {
+			mBegin++;
+			if (mDepth == 0)
+				mClosed = true;
+			else
+				mDepth--;
+			continue;
+		}
+		if (c == ',' || IsSpace(c)) {
+			mBegin++;
+			continue;
+		}
+
+		// a number, which may run over the end of the buffer
+		char token[64];
+		size_t length = 0;
+		while (mBegin < mEnd || Fill()) {
+			const char d = mBuffer[mBegin];
+			if (d == ',' || d == '[' || d == ']' || IsSpace(d))
+				break;
+			if (length < sizeof(token) - 1)
+				token[length++] = d;
+			mBegin++;
+		}
+		token[length] = '\0';
+
+		char *end;
+		value = strtod(token, &end);
+		if (end != token + length) {
+			SubscriberException se;
+			se.SetDetails("ExportReader: \"%s\" is not a number in \"%s\"\n",
+				token, mFileName.c_str());
+			throw se;
+		}
+		return true;
+	}
+	return false;
+}
+
+bool ExportReader::Cursor::Fill() {
+	mFile.read(&mBuffer[0], mBuffer.size());
+	mBegin = 0;
+	mEnd = (size_t)mFile.gcount();
+	return mEnd > 0;
+}
@@ -0,0 +1,75 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  ExportReader
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Declares ExportReader class, which reads json documents written by
+// VRInterface without parsing them whole. Scan() passes over the document
+// once and records, for each object, where its sections start. A Cursor
+// then reads the numbers of one section front to back through a small
+// buffer, so an object's eph, att and time entries can be read in step,
+// with as many cursors open on the file as there are threads.
+//
+// Only the first document of a file is read, so an AppendRuns container
+// gives its first member.
+
+#ifndef ExportReader_hpp
+#define ExportReader_hpp
+
+#include "VRInterfaceDefs.hpp"
+
+#include <fstream>
+#include <vector>
+
+class ExportReader
+{
+public:
+	// one object of the document. Sections are byte offsets of the first
+	// character inside their array, 0 for a section not written.
+	struct Object
+	{
+		enum { EPH, ATT, ANCHORS, GAPS, TIME, SECTION_COUNT };
+
+		std::string name;
+		std::string color;			// "r,g,b", empty when not written
+		size_t radius;					// offset of the value
+		size_t section[SECTION_COUNT];
+	};
+
+	// reads the numbers of one array
+	class Cursor
+	{
+	public:
+		Cursor();
+
+		void Open(const std::string &fileName);
+		// starts reading at an offset found by Scan()
+		void Seek(const size_t offset);
+		// next number of the array, at any depth of its rows; false once
+		// the array is closed
+		bool Next(Real &value);
+
+	protected:
+		bool Fill();
+
+		std::ifstream mFile;
+		std::string mFileName;
+		std::vector<char> mBuffer;
+		size_t mBegin, mEnd;		// unread part of the buffer
+		Integer mDepth;			// rows open inside the array
+		bool mClosed;
+	};
+
+	explicit ExportReader(const std::string &fileName);
+
+	// finds the objects of the first document, in file order
+	void Scan(std::vector<Object> &objects) const;
+
+	const std::string& GetFileName() const { return mFileName; }
+
+protected:
+	std::string mFileName;
+};
+
+#endif
@@ -0,0 +1,373 @@
+//$Id$
+//------------------------------------------------------------------------------
+//                                  VRConvert
+//------------------------------------------------------------------------------
+// GMAT: General Mission Analysis Tool
+//
+// Command line converter for json files already written by VRInterface.
+// The objects of the file are loaded into a DataManager on separate
+// threads, each read through cursors over its own sections, and are then
+// written again by the plugin's own writers. Old exports can so be
+// decimated, gzipped, tiled, indexed or written as Arrow without running
+// the mission again.
+//
+// Usage: VRConvert [options] <input.json> <output.json>
+
+#include "ExportReader.hpp"
+#include "DataManager.hpp"
+#include "GzipStreamBuffer.hpp"
+#include "RgbColor.hpp"
+#include "SubscriberException.hpp"
+
+#include <algorithm>		// for min(), max()
+#include <cstdio>			// for sscanf()
+#include <cstdlib>		// for atoi(), atof()
+#include <limits>
+#include <thread>
+
+namespace
+{
+	// samples handed to the DataManager at a time
+	const size_t LOAD_BATCH_SIZE = 1024;
+
+	const char *USAGE =
+		"Usage: VRConvert [options] <input.json> <output.json>\n"
+		"\n"
+		"Reads a json file written by VRInterface and writes it again with\n"
+		"the options below, which work as the VRInterface fields named.\n"
+		"\n"
+		"  --max-points N      samples kept per object (MaxDataPoints)\n"
+		"  --every N           keep every Nth sample (collect frequency)\n"
+		"  --compress LEVEL    write <output.json>.gz (CompressionLevel)\n"
+		"  --tile DAYS         split into tiles (TileDuration)\n"
+		"  --epoch-index N     write the epoch index (EpochIndexBlock)\n"
+		"  --lod LEVELS        write a level of detail pyramid (LodLevels)\n"
+		"  --lod-tolerance KM  error of its first level (LodTolerance)\n"
+		"  --bounds N          write the spatial index (BoundsChunk)\n"
+		"  --arrow             also write <output>.arrow (ExportArrow)\n"
+		"  --spill DIR         keep samples in scratch files (SpillDirectory)\n"
+		"  --compress-buffers  keep samples compressed (CompressBuffers)\n"
+		"  --single            keep samples as float32 (BufferPrecision)\n"
+		"  --threads N         objects loaded at once; one per core by default\n";
+
+	// objects of one file, shared by the threads loading them
+	struct LoadJob
+	{
+		const std::string *fileName;
+		const std::vector<ExportReader::Object> *objects;
+		DataManager *buffers;
+		Integer maxData, every;
+		StringArray errors;				// per object, empty when loaded
+	};
+
+	//------------------------------------------------------------
+	// Load one object
+	//------------------------------------------------------------
+	/*
+	* Its eph, att, anchors, gaps and time sections are read in step, each
+	* through a cursor of its own. Samples are kept as VRInterface keeps
+	* rows: every Nth, with the interval doubled by each halving, and always
+	* the first, the anchors and the samples that end a gap. The last sample
+	* is kept too, so the object's time span is unchanged.
+	*/
+	void LoadObject(LoadJob *job, const Integer i) {
+		typedef ExportReader::Object Object;
+		const Object &object = (*job->objects)[i];
+		if (object.section[Object::EPH] == 0 || object.section[Object::TIME] == 0)
+			return;
+
+		ExportReader::Cursor cursor[Object::SECTION_COUNT];
+		for (size_t s = 0; s < Object::SECTION_COUNT; s++) {
+			if (object.section[s] == 0)
+				continue;
+			cursor[s].Open(*job->fileName);
+			cursor[s].Seek(object.section[s]);
+		}
+
+		Real anchorEpoch = 0.0, gapStart = 0.0, gapStop = 0.0;
+		bool haveAnchor = object.section[Object::ANCHORS] != 0 &&
+			cursor[Object::ANCHORS].Next(anchorEpoch);
+		bool haveGap = object.section[Object::GAPS] != 0 &&
+			cursor[Object::GAPS].Next(gapStart) && cursor[Object::GAPS].Next(gapStop);
+
+		RealArray time, state, quat;
+		BooleanArray anchor, resumed;
+		time.reserve(LOAD_BATCH_SIZE);
+		state.reserve(6 * LOAD_BATCH_SIZE);
+		quat.reserve(4 * LOAD_BATCH_SIZE);
+
+		Real epoch, lastEpoch = 0.0;
+		Real rowState[6], rowQuat[4] = { 0.0, 0.0, 0.0, 0.0 };
+		Integer rows = 0;
+		bool lastKept = true;
+		while (cursor[Object::TIME].Next(epoch)) {
+			for (size_t k = 0; k < 6; k++) {
+				if (!cursor[Object::EPH].Next(rowState[k])) {
+					SubscriberException se;
+					se.SetDetails("VRConvert: %s has fewer eph rows than epochs\n",
+						object.name.c_str());
+					throw se;
+				}
+			}
+			for (size_t k = 0; k < 4 && object.section[Object::ATT] != 0; k++) {
+				if (!cursor[Object::ATT].Next(rowQuat[k])) {
+					SubscriberException se;
+					se.SetDetails("VRConvert: %s has fewer att rows than epochs\n",
+						object.name.c_str());
+					throw se;
+				}
+			}
+
+			// anchors and gaps are listed in sample order
+			bool isAnchor = false, isResumed = false;
+			while (haveAnchor && anchorEpoch < epoch)
+				haveAnchor = cursor[Object::ANCHORS].Next(anchorEpoch);
+			if (haveAnchor && anchorEpoch == epoch) {
+				isAnchor = true;
+				haveAnchor = cursor[Object::ANCHORS].Next(anchorEpoch);
+			}
+			while (haveGap && gapStop < epoch)
+				haveGap = cursor[Object::GAPS].Next(gapStart) &&
+					cursor[Object::GAPS].Next(gapStop);
+			if (haveGap && gapStop == epoch && rows > 0 && lastEpoch == gapStart) {
+				isResumed = true;
+				haveGap = cursor[Object::GAPS].Next(gapStart) &&
+					cursor[Object::GAPS].Next(gapStop);
+			}
+
+			rows++;
+			Integer interval = job->buffers->GetSampleInterval(i, job->every);
+			lastKept = (rows % interval) == 0 || rows == 1 || isAnchor || isResumed;
+			lastEpoch = epoch;
+
+			if (lastKept) {
+				time.push_back(epoch);
+				state.insert(state.end(), rowState, rowState + 6);
+				quat.insert(quat.end(), rowQuat, rowQuat + 4);
+				anchor.push_back(isAnchor);
+				resumed.push_back(isResumed);
+			}
+			if (time.size() >= LOAD_BATCH_SIZE) {
+				job->buffers->AddObjectSamples(i, time, state, quat, anchor,
+					resumed, job->maxData);
+				time.clear();
+				state.clear();
+				quat.clear();
+				anchor.clear();
+				resumed.clear();
+			}
+		}
+
+		// the last row is still in rowState and rowQuat
+		if (!lastKept) {
+			time.push_back(lastEpoch);
+			state.insert(state.end(), rowState, rowState + 6);
+			quat.insert(quat.end(), rowQuat, rowQuat + 4);
+			anchor.push_back(false);
+			resumed.push_back(false);
+		}
+		job->buffers->AddObjectSamples(i, time, state, quat, anchor, resumed,
+			job->maxData);
+	}
+
+	//------------------------------------------------------------
+	// Load some of the objects, on one thread
+	//------------------------------------------------------------
+	/*
+	* @firstObject, @objectStride objects loaded by this call
+	*/
+	void LoadObjects(LoadJob *job, const Integer firstObject,
+		const Integer objectStride) {
+		for (Integer i = firstObject; i < (Integer)job->objects->size();
+			i += objectStride) {
+			try {
+				LoadObject(job, i);
+			}
+			catch (BaseException &be) {
+				job->errors[i] = be.GetFullMessage();
+			}
+		}
+	}
+
+	// value of an option, or NULL with a message if it is missing
+	const char* OptionValue(const int argc, char *argv[], int &a) {
+		if (a + 1 >= argc) {
+			fprintf(stderr, "VRConvert: %s needs a value\n", argv[a]);
+			return NULL;
+		}
+		return argv[++a];
+	}
+}
+
+
+//------------------------------------------------------------
+// main
+//------------------------------------------------------------
+int main(int argc, char *argv[]) {
+	Integer maxData = std::numeric_limits<Integer>::max();
+	Integer every = 1;
+	Integer compressionLevel = 0;
+	Real tileDays = 0.0;
+	Integer indexBlock = 0;
+	Integer lodLevels = 0;
+	Real lodTolerance = 1.0;
+	Integer boundsChunk = 0;
+	bool arrow = false;
+	std::string spillDirectory;
+	bool compressBuffers = false, singlePrecision = false;
+	Integer threadCount = std::max(1, (Integer)std::thread::hardware_concurrency());
+	StringArray files;
+
+	for (int a = 1; a < argc; a++) {
+		const std::string option = argv[a];
+		const char *value = "";
+		if (option == "--max-points" || option == "--every" ||
+			option == "--compress" || option == "--tile" ||
+			option == "--epoch-index" || option == "--lod" ||
+			option == "--lod-tolerance" || option == "--bounds" ||
+			option == "--spill" || option == "--threads") {
+			if ((value = OptionValue(argc, argv, a)) == NULL)
+				return 2;
+		}
+
+		if (option == "--max-points")
+			maxData = std::max(4, atoi(value));
+		else if (option == "--every")
+			every = std::max(1, atoi(value));
+		else if (option == "--compress")
+			compressionLevel = atoi(value);
+		else if (option == "--tile")
+			tileDays = atof(value);
+		else if (option == "--epoch-index")
+			indexBlock = atoi(value);
+		else if (option == "--lod")
+			lodLevels = atoi(value);
+		else if (option == "--lod-tolerance")
+			lodTolerance = atof(value);
+		else if (option == "--bounds")
+			boundsChunk = atoi(value);
+		else if (option == "--spill")
+			spillDirectory = value;
+		else if (option == "--threads")
+			threadCount = std::max(1, atoi(value));
+		else if (option == "--arrow")
+			arrow = true;
+		else if (option == "--compress-buffers")
+			compressBuffers = true;
+		else if (option == "--single")
+			singlePrecision = true;
+		else if (option.compare(0, 2, "--") == 0) {
+			fprintf(stderr, "VRConvert: unknown option %s\n\n%s", option.c_str(), USAGE);
+			return 2;
+		}
+		else
+			files.push_back(option);
+	}
+	if (files.size() != 2) {
+		fprintf(stderr, "%s", USAGE);
+		return 2;
+	}
+	const std::string &inputFile = files[0];
+	const std::string &outputFile = files[1];
+
+	if (compressionLevel > 0 && !GzipStreamBuffer::IsAvailable()) {
+		fprintf(stderr, "VRConvert: built without zlib; writing plain json\n");
+		compressionLevel = 0;
+	}
+
+	try {
+		ExportReader reader(inputFile);
+		std::vector<ExportReader::Object> objects;
+		reader.Scan(objects);
+		if (objects.empty()) {
+			fprintf(stderr, "VRConvert: %s holds no objects\n", inputFile.c_str());
+			return 1;
+		}
+
+		// every object is written as a spacecraft; the file does not say
+		// which were celestial bodies
+		const Integer objectCount = (Integer)objects.size();
+		StringArray names;
+		RealArray radii;
+		ColorMap colours;
+		bool exportAttitude = false, exportColours = false;
+		ExportReader::Cursor radius;
+		radius.Open(inputFile);
+		for (Integer i = 0; i < objectCount; i++) {
+			const ExportReader::Object &object = objects[i];
+			names.push_back(object.name);
+
+			Real value = 0.0;
+			if (object.radius != 0) {
+				radius.Seek(object.radius);
+				radius.Next(value);
+			}
+			radii.push_back(value);
+
+			int red = 255, green = 255, blue = 255;
+			if (object.color != "") {
+				sscanf(object.color.c_str(), "%d,%d,%d", &red, &green, &blue);
+				exportColours = true;
+			}
+			colours[object.name] = RgbColor((Byte)red, (Byte)green, (Byte)blue).GetIntColor();
+			exportAttitude = exportAttitude ||
+				object.section[ExportReader::Object::ATT] != 0;
+		}
+
+		DataManager buffers;
+		buffers.BuildDynamicBuffers(names, spillDirectory, compressBuffers,
+			singlePrecision);
+		buffers.SetEpochIndexBlock(indexBlock);
+		buffers.SetTileDuration(tileDays);
+		buffers.SetLodPyramid(lodLevels, lodTolerance);
+		buffers.SetBoundsChunk(boundsChunk);
+		buffers.SetCompressionLevel(compressionLevel);
+		buffers.SetArrowExport(arrow);
+
+		LoadJob job;
+		job.fileName = &inputFile;
+		job.objects = &objects;
+		job.buffers = &buffers;
+		job.maxData = maxData;
+		job.every = every;
+		job.errors.assign(objects.size(), "");
+
+		Integer workerCount = std::min(threadCount, objectCount);
+		std::vector<std::thread> workers;
+		for (Integer w = 1; w < workerCount; w++)
+			workers.push_back(std::thread(LoadObjects, &job, w, workerCount));
+		LoadObjects(&job, 0, workerCount);
+		for (size_t w = 0; w < workers.size(); w++)
+			workers[w].join();
+
+		bool failed = false;
+		for (Integer i = 0; i < objectCount; i++) {
+			if (job.errors[i] != "") {
+				fprintf(stderr, "%s", job.errors[i].c_str());
+				failed = true;
+			}
+			else if (buffers.GetDecimationLevel(i) > 0)
+				printf("VRConvert: %s was decimated %d time(s) to stay within "
+					"%d samples\n", names[i].c_str(), buffers.GetDecimationLevel(i),
+					maxData);
+		}
+		if (failed)
+			return 1;
+
+		const size_t sampleCount = buffers.GetSampleCount();
+		if (!buffers.PrepareExport(objectCount, 0, names, StringArray(), maxData))
+			return 1;
+		std::ofstream jstream;
+		size_t bytesWritten = buffers.WriteBuffers(outputFile, jstream,
+			objectCount, 0, names, StringArray(), radii, colours, exportAttitude,
+			exportColours, RealArray(), RealArray());
+
+		printf("VRConvert: %d objects, %lu samples, %lu bytes written\n",
+			objectCount, (unsigned long)sampleCount, (unsigned long)bytesWritten);
+	}
+	catch (BaseException &be) {
+		fprintf(stderr, "%s", be.GetFullMessage().c_str());
+		return 1;
+	}
+	return 0;
+}